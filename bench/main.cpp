@@ -0,0 +1,1004 @@
+// Copyright 2017 Tommy Hinks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+// Benchmarks for computing arrival times, reporting accuracy together with
+// speed and memory use.
+//
+// Usage:
+//   fast-marching-method-bench [--filter <regex>] [--json <file>] [options]
+//
+// Each benchmark runs one solver with one precision on one boundary shape
+// and grid size, and is named
+// <solver>/<precision>/<boundary>/<dimension>d/<size>. The point boundary
+// is marched as a single front using GeodesicArrivalTime, the closed
+// boundaries (sphere, box and checkerboard) using SignedArrivalTime. The
+// point boundary is also marched towards a single target cell using
+// TargetArrivalTime and HeuristicTargetArrivalTime, with /target and
+// /heuristic-target appended to the name respectively.
+// Errors are measured against exact arrival times at unit speed, which are
+// known for all boundaries except the checkerboard. Results are printed as
+// a table and optionally written to a JSON file, so that runs can be
+// compared over time.
+//
+// New solvers or precisions are added to SolverNames/WithSolver or
+// PrecisionNames/RunWithPrecision respectively.
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "../include/thinks/fast_marching_method/fast_marching_method.hpp"
+#include "../test/util.hpp"
+
+namespace {
+
+//! Largest number of cells in a benchmark grid, 512^3.
+constexpr auto kMaxCellCount = std::size_t{512} * 512 * 512;
+
+//! Smallest grid size along each axis.
+constexpr auto kMinGridSize = std::size_t{32};
+
+//! Weight of the DistanceHeuristic in heuristic-target benchmarks.
+constexpr auto kHeuristicWeight = 0.5;
+
+
+//! Options given on the command line.
+struct Options
+{
+  std::string filter;
+  std::string json_path;
+  std::vector<std::string> precisions;
+  std::vector<std::size_t> dimensions;
+  std::size_t max_cell_count;
+  std::size_t repetitions;
+};
+
+
+//! Timings, memory use and errors of one benchmark. Errors are absolute
+//! differences to the exact arrival times, in units of the grid spacing,
+//! and are only valid if has_errors is true.
+struct Result
+{
+  std::string name;
+  std::string method;
+  std::string solver;
+  std::string precision;
+  std::string boundary;
+  std::size_t dimension;
+  std::size_t grid_size;
+  std::size_t cell_count;
+  std::size_t boundary_cell_count;
+  std::size_t repetitions;
+  std::chrono::nanoseconds min_time;
+  std::chrono::nanoseconds mean_time;
+  std::size_t peak_rss_bytes;
+  thinks::fast_marching_method::ArrivalTimeStats stats;
+  bool has_errors;
+  double max_abs_error;
+  double mean_abs_error;
+};
+
+
+void PrintUsage(std::ostream& os)
+{
+  os << "usage: fast-marching-method-bench [options]\n"
+     << "\n"
+     << "options:\n"
+     << "  --filter <regex>     only run benchmarks with matching names\n"
+     << "  --json <file>        write results to a JSON file\n"
+     << "  --precision <p[,..]> float and/or double (default double)\n"
+     << "  --dims <d[,...]>     grid dimensions, 2, 3 or 4 (default 2,3,4)\n"
+     << "  --max-cells <n>      largest number of grid cells, at most 512^3"
+     << "\n"
+     << "                       (default 128^3)\n"
+     << "  --repetitions <n>    runs per benchmark, the fastest run is"
+     << " reported\n"
+     << "                       (default 1)\n"
+     << "  --list               print benchmark names without running them\n";
+}
+
+
+//! Returns the comma-separated values in @a text.
+//!
+//! Throws std::invalid_argument if a value cannot be parsed.
+std::vector<std::size_t> ParseList(
+  std::string const& option,
+  std::string const& text)
+{
+  using namespace std;
+
+  auto values = vector<size_t>();
+  auto ss = stringstream(text);
+  auto item = string();
+  while (getline(ss, item, ',')) {
+    auto item_ss = stringstream(item);
+    auto value = size_t{0};
+    if (!(item_ss >> value) || !(item_ss >> ws).eof()) {
+      throw invalid_argument("invalid value for " + option + ": " + text);
+    }
+    values.push_back(value);
+  }
+  if (values.empty()) {
+    throw invalid_argument("invalid value for " + option + ": " + text);
+  }
+  return values;
+}
+
+
+//! Returns the names of the precisions that are benchmarked.
+std::vector<std::string> PrecisionNames()
+{
+  return std::vector<std::string>{"float", "double"};
+}
+
+
+//! Returns the options given by @a argc and @a argv. Sets @a list to true
+//! if only benchmark names should be printed.
+//!
+//! Throws std::invalid_argument if the options are invalid.
+Options ParseOptions(int const argc, char* argv[], bool* const list)
+{
+  using namespace std;
+
+  auto options = Options();
+  options.precisions = vector<string>{"double"};
+  options.dimensions = vector<size_t>{2, 3, 4};
+  options.max_cell_count = size_t{128} * 128 * 128;
+  options.repetitions = size_t{1};
+  *list = false;
+
+  for (auto i = 1; i < argc; ++i) {
+    auto const option = string(argv[i]);
+    auto const value = [&]() {
+      if (i + 1 == argc) {
+        throw invalid_argument("missing value for " + option);
+      }
+      return string(argv[++i]);
+    };
+
+    if (option == "--filter") {
+      options.filter = value();
+    }
+    else if (option == "--json") {
+      options.json_path = value();
+    }
+    else if (option == "--precision") {
+      options.precisions.clear();
+      auto ss = stringstream(value());
+      auto precision = string();
+      while (getline(ss, precision, ',')) {
+        options.precisions.push_back(precision);
+      }
+    }
+    else if (option == "--dims") {
+      options.dimensions = ParseList(option, value());
+    }
+    else if (option == "--max-cells") {
+      options.max_cell_count = ParseList(option, value()).front();
+    }
+    else if (option == "--repetitions") {
+      options.repetitions = ParseList(option, value()).front();
+    }
+    else if (option == "--list") {
+      *list = true;
+    }
+    else {
+      throw invalid_argument("unknown option: " + option);
+    }
+  }
+
+  auto const precision_names = PrecisionNames();
+  if (options.precisions.empty()) {
+    throw invalid_argument("missing value for --precision");
+  }
+  for (auto const& precision : options.precisions) {
+    if (find(begin(precision_names), end(precision_names), precision) ==
+        end(precision_names)) {
+      throw invalid_argument("unknown precision: " + precision);
+    }
+  }
+  for (auto const dimension : options.dimensions) {
+    if (dimension < 2 || dimension > 4) {
+      throw invalid_argument("unsupported dimension: " + to_string(dimension));
+    }
+  }
+  if (options.max_cell_count > kMaxCellCount) {
+    throw invalid_argument("--max-cells must be at most 512^3");
+  }
+  if (options.repetitions == 0) {
+    throw invalid_argument("--repetitions must be at least 1");
+  }
+  return options;
+}
+
+
+//! Returns the names of the solvers that are benchmarked.
+std::vector<std::string> SolverNames()
+{
+  return std::vector<std::string>{
+    "UniformSpeed",
+    "HighAccuracyUniformSpeed",
+    "VaryingSpeed",
+    "HighAccuracyVaryingSpeed",
+    "Distance"
+  };
+}
+
+
+//! Returns the names of the boundary shapes that are benchmarked.
+std::vector<std::string> BoundaryNames()
+{
+  return std::vector<std::string>{"point", "sphere", "box", "checkerboard"};
+}
+
+
+//! Returns the names of the methods that the shape named @a boundary is
+//! marched with.
+std::vector<std::string> MethodNames(std::string const& boundary)
+{
+  return boundary == "point" ?
+    std::vector<std::string>{"geodesic", "target", "heuristic-target"} :
+    std::vector<std::string>{"signed"};
+}
+
+
+//! Returns true if the method named @a method only computes the arrival
+//! time at a single target cell, see TargetIndex.
+bool IsTargetMethod(std::string const& method)
+{
+  return method == "target" || method == "heuristic-target";
+}
+
+
+//! Returns the grid sizes along each axis for an N-dimensional grid, powers
+//! of two such that the number of cells is at most @a max_cell_count.
+template<std::size_t N>
+std::vector<std::size_t> GridSizes(std::size_t const max_cell_count)
+{
+  using namespace std;
+
+  auto grid_sizes = vector<size_t>();
+  for (auto grid_size = kMinGridSize;
+       util::LinearSize(util::FilledArray<N>(grid_size)) <= max_cell_count;
+       grid_size *= 2) {
+    grid_sizes.push_back(grid_size);
+  }
+  return grid_sizes;
+}
+
+
+//! Returns the peak resident set size of the process in bytes, or zero if
+//! it is not available on this platform.
+std::size_t PeakRssBytes()
+{
+  using namespace std;
+
+#if defined(__linux__)
+  auto status = ifstream("/proc/self/status");
+  auto line = string();
+  while (getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      auto ss = stringstream(line.substr(6));
+      auto kilobytes = size_t{0};
+      ss >> kilobytes;
+      return kilobytes * 1024;
+    }
+  }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+  auto usage = rusage();
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+  }
+#endif
+  return size_t{0};
+}
+
+
+//! Resets the peak resident set size of the process to the current resident
+//! set size, so that the peak of each benchmark is measured separately.
+//! Only supported on Linux, elsewhere the peak is that of the process.
+void ResetPeakRss()
+{
+#if defined(__linux__)
+  auto clear_refs = std::ofstream("/proc/self/clear_refs");
+  clear_refs << "5";
+#endif
+}
+
+
+//! Returns the index of the cell that the boundary shapes are centered on.
+template<std::size_t N>
+std::array<std::int32_t, N> CenterIndex(
+  std::array<std::size_t, N> const& grid_size)
+{
+  auto center_index = std::array<std::int32_t, N>();
+  for (auto i = std::size_t{0}; i < N; ++i) {
+    center_index[i] = static_cast<std::int32_t>(grid_size[i] / 2);
+  }
+  return center_index;
+}
+
+
+//! Returns the index of the target cell of the target methods, between the
+//! center and a corner of the grid and not on a diagonal.
+template<std::size_t N>
+std::array<std::int32_t, N> TargetIndex(
+  std::array<std::size_t, N> const& grid_size)
+{
+  auto target_index = CenterIndex(grid_size);
+  target_index[0] += static_cast<std::int32_t>(grid_size[0] / 4);
+  for (auto i = std::size_t{1}; i < N; ++i) {
+    target_index[i] += static_cast<std::int32_t>(grid_size[i] / 8);
+  }
+  return target_index;
+}
+
+
+//! Returns the radius of the sphere boundary.
+template<typename T, std::size_t N>
+T SphereRadius(
+  std::array<std::size_t, N> const& grid_size,
+  std::array<T, N> const& grid_spacing)
+{
+  auto radius = std::numeric_limits<T>::max();
+  for (auto i = std::size_t{0}; i < N; ++i) {
+    radius = std::min(radius, T(0.25) * grid_size[i] * grid_spacing[i]);
+  }
+  return radius;
+}
+
+
+//! Returns the min and max cell indices of the box boundary, which covers
+//! the middle half of the grid along each axis.
+template<std::size_t N>
+std::pair<std::array<std::int32_t, N>, std::array<std::int32_t, N>>
+BoxMinMax(std::array<std::size_t, N> const& grid_size)
+{
+  auto box_min = std::array<std::int32_t, N>();
+  auto box_max = std::array<std::int32_t, N>();
+  for (auto i = std::size_t{0}; i < N; ++i) {
+    box_min[i] = static_cast<std::int32_t>(grid_size[i] / 4);
+    box_max[i] = box_min[i] + static_cast<std::int32_t>(grid_size[i] / 2);
+  }
+  return {box_min, box_max};
+}
+
+
+//! Computes boundary cells of the shape named @a boundary, centered in a
+//! grid of size @a grid_size.
+template<typename T, std::size_t N>
+void BoundaryCells(
+  std::string const& boundary,
+  std::array<std::size_t, N> const& grid_size,
+  std::array<T, N> const& grid_spacing,
+  std::vector<std::array<std::int32_t, N>>* const boundary_indices,
+  std::vector<T>* const boundary_times)
+{
+  using namespace std;
+
+  auto const center_index = CenterIndex(grid_size);
+  auto const center = util::CellCenter(center_index, grid_spacing);
+
+  if (boundary == "point") {
+    // The center cell and its vertex neighbors, so that the high accuracy
+    // solvers have enough frozen cells to start from.
+    boundary_indices->push_back(center_index);
+    boundary_times->push_back(T{0});
+    for (auto const& offset : util::VertexNeighborOffsets<N>()) {
+      auto index = center_index;
+      for (auto i = size_t{0}; i < N; ++i) {
+        index[i] += offset[i];
+      }
+      boundary_indices->push_back(index);
+      boundary_times->push_back(
+        util::Distance(center, util::CellCenter(index, grid_spacing)));
+    }
+  }
+  else if (boundary == "sphere") {
+    util::HyperSphereBoundaryCells(
+      center,
+      SphereRadius(grid_size, grid_spacing),
+      grid_size,
+      grid_spacing,
+      [](T const d) { return d; },
+      size_t{0}, // Dilation pass count.
+      boundary_indices,
+      boundary_times);
+  }
+  else if (boundary == "box") {
+    auto const box_min_max = BoxMinMax(grid_size);
+    auto box_size = array<size_t, N>();
+    for (auto i = size_t{0}; i < N; ++i) {
+      box_size[i] =
+        static_cast<size_t>(box_min_max.second[i] - box_min_max.first[i]);
+    }
+    util::BoxBoundaryCells(
+      box_min_max.first,
+      box_size,
+      grid_size,
+      boundary_indices,
+      boundary_times);
+  }
+  else {
+    assert(boundary == "checkerboard");
+    auto const is_even = [](auto const i) { return i % 2 == 0; };
+    auto index_iter = util::IndexIterator<N>(grid_size);
+    while (index_iter.has_next()) {
+      auto const index = index_iter.index();
+      if (all_of(begin(index), end(index), is_even) ||
+          none_of(begin(index), end(index), is_even)) {
+        boundary_indices->push_back(index);
+      }
+      index_iter.Next();
+    }
+    *boundary_times = vector<T>(boundary_indices->size(), T{0});
+  }
+}
+
+
+//! Returns true if exact arrival times are known for the shape named
+//! @a boundary, see ExactArrivalTime.
+bool HasExactArrivalTimes(std::string const& boundary)
+{
+  return boundary != "checkerboard";
+}
+
+
+//! Returns the exact arrival time at unit speed of the cell at @a index,
+//! for the shape named @a boundary (see BoundaryCells), with the sign used
+//! by SignedArrivalTime for the closed shapes. Times are measured between
+//! cell centers, the same as the boundary times.
+//!
+//! Preconditions:
+//! - HasExactArrivalTimes(boundary) is true.
+template<std::size_t N>
+double ExactArrivalTime(
+  std::string const& boundary,
+  std::array<std::int32_t, N> const& index,
+  std::array<std::size_t, N> const& grid_size,
+  std::array<double, N> const& grid_spacing)
+{
+  using namespace std;
+
+  assert(HasExactArrivalTimes(boundary) && "Precondition");
+
+  auto const cell_center = util::CellCenter(index, grid_spacing);
+  auto const center = util::CellCenter(CenterIndex(grid_size), grid_spacing);
+  if (boundary == "point") {
+    return util::Distance(center, cell_center);
+  }
+  if (boundary == "sphere") {
+    return util::Distance(center, cell_center) -
+      SphereRadius(grid_size, grid_spacing);
+  }
+
+  // Box, with the surface through the boundary cell centers. Outside,
+  // the distance to the closest point on the box. Inside, the negated
+  // distance to the closest face.
+  assert(boundary == "box");
+  auto const box_min_max = BoxMinMax(grid_size);
+  auto outside_distance_squared = 0.0;
+  auto inside_distance = numeric_limits<double>::max();
+  for (auto i = size_t{0}; i < N; ++i) {
+    auto const below = box_min_max.first[i] - index[i];
+    auto const above = index[i] - box_min_max.second[i];
+    auto const outside = max(max(below, above), int32_t{0}) * grid_spacing[i];
+    outside_distance_squared += outside * outside;
+    inside_distance =
+      min(inside_distance, -max(below, above) * grid_spacing[i]);
+  }
+  return outside_distance_squared > 0.0 ?
+    sqrt(outside_distance_squared) : -inside_distance;
+}
+
+
+//! Sets the max and mean absolute errors of @a arrival_times in
+//! @a result, in units of the grid spacing, like ErrorStatistics in
+//! dump/main.cpp. For the target methods @a arrival_times only holds the
+//! time at the target cell. Errors are not set if exact arrival times are
+//! not known.
+template<typename T, std::size_t N>
+void SetErrors(
+  std::vector<T> const& arrival_times,
+  std::array<std::size_t, N> const& grid_size,
+  std::array<T, N> const& grid_spacing,
+  Result* const result)
+{
+  using namespace std;
+
+  result->has_errors = HasExactArrivalTimes(result->boundary);
+  if (!result->has_errors) {
+    return;
+  }
+
+  auto exact_grid_spacing = array<double, N>();
+  copy(begin(grid_spacing), end(grid_spacing), begin(exact_grid_spacing));
+  auto const min_grid_spacing =
+    *min_element(begin(exact_grid_spacing), end(exact_grid_spacing));
+
+  if (IsTargetMethod(result->method)) {
+    assert(arrival_times.size() == 1);
+    auto const exact_time = ExactArrivalTime(
+      result->boundary,
+      TargetIndex(grid_size),
+      grid_size,
+      exact_grid_spacing);
+    result->max_abs_error =
+      fabs(arrival_times.front() - exact_time) / min_grid_spacing;
+    result->mean_abs_error = result->max_abs_error;
+    return;
+  }
+
+  auto max_abs_error = 0.0;
+  auto sum_abs_error = 0.0;
+  auto index_iter = util::IndexIterator<N>(grid_size);
+  auto linear_index = size_t{0};
+  while (index_iter.has_next()) {
+    auto const exact_time = ExactArrivalTime(
+      result->boundary,
+      index_iter.index(),
+      grid_size,
+      exact_grid_spacing);
+    auto const abs_error =
+      fabs(arrival_times[linear_index] - exact_time) / min_grid_spacing;
+    max_abs_error = max(max_abs_error, abs_error);
+    sum_abs_error += abs_error;
+    ++linear_index;
+    index_iter.Next();
+  }
+  result->max_abs_error = max_abs_error;
+  result->mean_abs_error = sum_abs_error / arrival_times.size();
+}
+
+
+//! Calls @a func with a distance solver.
+template<typename T, std::size_t N, typename F>
+void WithDistanceSolver(
+  std::array<T, N> const& grid_spacing,
+  F const func,
+  std::true_type)
+{
+  func(thinks::fast_marching_method::DistanceSolver<T, N>(grid_spacing[0]));
+}
+
+
+//! DistanceSolver supports at most three dimensions, such benchmarks are
+//! never created.
+template<typename T, std::size_t N, typename F>
+void WithDistanceSolver(
+  std::array<T, N> const&,
+  F const,
+  std::false_type)
+{
+  assert(false && "Precondition");
+}
+
+
+//! Calls @a func with the solver named @a solver. The speed buffer of the
+//! varying speed solvers is only allocated when needed, since it is as
+//! large as the arrival time grid.
+template<typename T, std::size_t N, typename F>
+void WithSolver(
+  std::string const& solver,
+  std::array<std::size_t, N> const& grid_size,
+  std::array<T, N> const& grid_spacing,
+  F const func)
+{
+  using namespace std;
+  namespace fmm = thinks::fast_marching_method;
+
+  auto const speed = T{1};
+  if (solver == "UniformSpeed") {
+    func(fmm::UniformSpeedEikonalSolver<T, N>(grid_spacing, speed));
+  }
+  else if (solver == "HighAccuracyUniformSpeed") {
+    func(fmm::HighAccuracyUniformSpeedEikonalSolver<T, N>(
+      grid_spacing, speed));
+  }
+  else if (solver == "VaryingSpeed") {
+    auto const speed_buffer = vector<T>(util::LinearSize(grid_size), speed);
+    func(fmm::VaryingSpeedEikonalSolver<T, N>(
+      grid_spacing, grid_size, speed_buffer));
+  }
+  else if (solver == "HighAccuracyVaryingSpeed") {
+    auto const speed_buffer = vector<T>(util::LinearSize(grid_size), speed);
+    func(fmm::HighAccuracyVaryingSpeedEikonalSolver<T, N>(
+      grid_spacing, grid_size, speed_buffer));
+  }
+  else {
+    assert(solver == "Distance");
+    WithDistanceSolver(
+      grid_spacing, func, integral_constant<bool, (N <= 3)>());
+  }
+}
+
+
+//! Runs @a result->repetitions repetitions of the benchmark described by
+//! @a result on an N-dimensional grid and fills in the timings, memory use
+//! and errors.
+template<typename T, std::size_t N>
+void RunBenchmark(Result* const result)
+{
+  using namespace std;
+  using namespace std::chrono;
+  namespace fmm = thinks::fast_marching_method;
+
+  auto const grid_size = util::FilledArray<N>(result->grid_size);
+  auto const grid_spacing = util::FilledArray<N>(T{1});
+
+  auto boundary_indices = vector<array<int32_t, N>>();
+  auto boundary_times = vector<T>();
+  BoundaryCells(
+    result->boundary,
+    grid_size,
+    grid_spacing,
+    &boundary_indices,
+    &boundary_times);
+  result->boundary_cell_count = boundary_indices.size();
+  result->cell_count = util::LinearSize(grid_size);
+  auto const target_index = TargetIndex(grid_size);
+
+  ResetPeakRss();
+
+  auto total_time = nanoseconds::zero();
+  auto arrival_times = vector<T>();
+  result->min_time = nanoseconds::max();
+  for (auto i = size_t{0}; i < result->repetitions; ++i) {
+    // Free the times of the previous repetition, so that they do not add
+    // to the peak memory use.
+    arrival_times = vector<T>();
+    WithSolver<T, N>(result->solver, grid_size, grid_spacing,
+      [&](auto const& eikonal_solver) {
+        // The target methods do not report stats.
+        auto stats = fmm::ArrivalTimeStats();
+        auto const start = steady_clock::now();
+        if (result->method == "geodesic") {
+          arrival_times = fmm::GeodesicArrivalTime(
+            grid_size,
+            boundary_indices,
+            boundary_times,
+            eikonal_solver,
+            &stats);
+        }
+        else if (result->method == "signed") {
+          arrival_times = fmm::SignedArrivalTime(
+            grid_size,
+            boundary_indices,
+            boundary_times,
+            eikonal_solver,
+            &stats);
+        }
+        else if (result->method == "target") {
+          arrival_times = fmm::TargetArrivalTime(
+            grid_size,
+            boundary_indices,
+            boundary_times,
+            eikonal_solver,
+            vector<array<int32_t, N>>(1, target_index));
+        }
+        else {
+          assert(result->method == "heuristic-target");
+          arrival_times = vector<T>(1, fmm::HeuristicTargetArrivalTime(
+            grid_size,
+            boundary_indices,
+            boundary_times,
+            eikonal_solver,
+            target_index,
+            fmm::DistanceHeuristic<T, N>(
+              target_index,
+              grid_spacing,
+              T{1}, // Max speed.
+              T(kHeuristicWeight))));
+        }
+        auto const time =
+          duration_cast<nanoseconds>(steady_clock::now() - start);
+        assert(arrival_times.size() ==
+          (IsTargetMethod(result->method) ? 1 : result->cell_count));
+
+        total_time += time;
+        if (time < result->min_time) {
+          result->min_time = time;
+          result->stats = stats;
+        }
+      });
+  }
+  result->mean_time = total_time / result->repetitions;
+  result->peak_rss_bytes = PeakRssBytes();
+
+  SetErrors(arrival_times, grid_size, grid_spacing, result);
+}
+
+
+//! Runs the benchmark described by @a result with the precision given by
+//! @a result->precision.
+template<std::size_t N>
+void RunWithPrecision(Result* const result)
+{
+  if (result->precision == "float") {
+    RunBenchmark<float, N>(result);
+  }
+  else {
+    assert(result->precision == "double");
+    RunBenchmark<double, N>(result);
+  }
+}
+
+
+//! Returns the benchmarks selected by @a options, in order of increasing
+//! grid size within each dimension.
+std::vector<Result> Benchmarks(Options const& options)
+{
+  using namespace std;
+
+  auto regex_filter = regex(options.filter);
+  auto benchmarks = vector<Result>();
+  for (auto const dimension : options.dimensions) {
+    auto const grid_sizes =
+      dimension == 2 ? GridSizes<2>(options.max_cell_count) :
+      dimension == 3 ? GridSizes<3>(options.max_cell_count) :
+                       GridSizes<4>(options.max_cell_count);
+    for (auto const grid_size : grid_sizes) {
+      for (auto const& boundary : BoundaryNames()) {
+        for (auto const& solver : SolverNames()) {
+          if (solver == "Distance" && dimension > 3) {
+            // DistanceSolver supports at most three dimensions.
+            continue;
+          }
+
+          for (auto const& method : MethodNames(boundary)) {
+            for (auto const& precision : options.precisions) {
+              auto result = Result();
+              result.name = solver + "/" + precision + "/" + boundary + "/" +
+                to_string(dimension) + "d/" + to_string(grid_size);
+              if (IsTargetMethod(method)) {
+                result.name += "/" + method;
+              }
+              result.method = method;
+              result.solver = solver;
+              result.precision = precision;
+              result.boundary = boundary;
+              result.dimension = dimension;
+              result.grid_size = grid_size;
+              result.cell_count = size_t{0};
+              result.boundary_cell_count = size_t{0};
+              result.repetitions = options.repetitions;
+              result.min_time = chrono::nanoseconds::zero();
+              result.mean_time = chrono::nanoseconds::zero();
+              result.peak_rss_bytes = size_t{0};
+              result.stats = thinks::fast_marching_method::ArrivalTimeStats();
+              result.has_errors = false;
+              result.max_abs_error = 0.0;
+              result.mean_abs_error = 0.0;
+              if (options.filter.empty() ||
+                  regex_search(result.name, regex_filter)) {
+                benchmarks.push_back(result);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  return benchmarks;
+}
+
+
+//! Returns the number of cells marched per second in @a result.
+double CellsPerSecond(Result const& result)
+{
+  return result.cell_count /
+    std::chrono::duration<double>(result.min_time).count();
+}
+
+
+void PrintHeader()
+{
+  using namespace std;
+
+  cout << left << setw(64) << "Benchmark" << right
+       << setw(14) << "Time" << setw(14) << "Cells/s"
+       << setw(12) << "Peak RSS" << setw(10) << "Max err"
+       << setw(10) << "Mean err" << endl
+       << string(124, '-') << endl;
+}
+
+
+void PrintResult(Result const& result)
+{
+  using namespace std;
+
+  cout << left << setw(64) << result.name << right << fixed
+       << setprecision(3) << setw(11) << result.min_time.count() * 1e-6
+       << " ms" << setprecision(0) << setw(14) << CellsPerSecond(result)
+       << setw(9) << result.peak_rss_bytes / (1024 * 1024) << " MB";
+  if (result.has_errors) {
+    cout << setprecision(4) << setw(10) << result.max_abs_error
+         << setw(10) << result.mean_abs_error;
+  }
+  else {
+    cout << setw(10) << "-" << setw(10) << "-";
+  }
+  cout << endl;
+}
+
+
+//! Writes @a results to the file at @a path as JSON.
+//!
+//! Throws std::runtime_error if the file cannot be written.
+void WriteJson(std::string const& path, std::vector<Result> const& results)
+{
+  using namespace std;
+
+  auto file = ofstream(path);
+  if (!file) {
+    throw runtime_error("failed to open JSON file '" + path + "'");
+  }
+
+  auto const now = chrono::system_clock::to_time_t(chrono::system_clock::now());
+  auto date = array<char, 32>();
+  strftime(date.data(), date.size(), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  file << "{\n"
+       << "  \"context\": {\n"
+       << "    \"date\": \"" << date.data() << "\",\n"
+       << "    \"num_cpus\": " << thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+       << "    \"library_build_type\": \"release\"\n"
+#else
+       << "    \"library_build_type\": \"debug\"\n"
+#endif
+       << "  },\n"
+       << "  \"benchmarks\": [";
+  for (auto i = size_t{0}; i < results.size(); ++i) {
+    auto const& result = results[i];
+    file << (i == 0 ? "\n" : ",\n")
+         << "    {\n"
+         << "      \"name\": \"" << result.name << "\",\n"
+         << "      \"method\": \"" << result.method << "\",\n"
+         << "      \"solver\": \"" << result.solver << "\",\n"
+         << "      \"precision\": \"" << result.precision << "\",\n"
+         << "      \"boundary\": \"" << result.boundary << "\",\n"
+         << "      \"dimension\": " << result.dimension << ",\n"
+         << "      \"grid_size\": " << result.grid_size << ",\n"
+         << "      \"cell_count\": " << result.cell_count << ",\n"
+         << "      \"boundary_cell_count\": "
+         << result.boundary_cell_count << ",\n"
+         << "      \"repetitions\": " << result.repetitions << ",\n"
+         << "      \"real_time_ns\": " << result.min_time.count() << ",\n"
+         << "      \"mean_time_ns\": " << result.mean_time.count() << ",\n"
+         << "      \"cells_per_second\": " << fixed << setprecision(0)
+         << CellsPerSecond(result) << ",\n"
+         << "      \"peak_rss_bytes\": " << result.peak_rss_bytes << ",\n"
+         << "      \"validation_ns\": "
+         << result.stats.validation.count() << ",\n"
+         << "      \"topology_ns\": " << result.stats.topology.count() << ",\n"
+         << "      \"inside_march_ns\": "
+         << result.stats.inside_march.count() << ",\n"
+         << "      \"outside_march_ns\": "
+         << result.stats.outside_march.count() << ",\n"
+         << "      \"solve_count\": " << result.stats.solve_count << ",\n"
+         << "      \"push_count\": " << result.stats.push_count << ",\n"
+         << "      \"stale_pop_count\": "
+         << result.stats.stale_pop_count << ",\n"
+         << "      \"peak_narrow_band_size\": "
+         << result.stats.peak_narrow_band_size << ",\n"
+         << "      \"connected_component_count\": "
+         << result.stats.connected_component_count << ",\n"
+         << "      \"dilation_band_count\": "
+         << result.stats.dilation_band_count << ",\n";
+    // Errors are null if there are no exact arrival times to compare with.
+    file << setprecision(9)
+         << "      \"max_abs_error\": ";
+    if (result.has_errors) {
+      file << result.max_abs_error;
+    }
+    else {
+      file << "null";
+    }
+    file << ",\n"
+         << "      \"mean_abs_error\": ";
+    if (result.has_errors) {
+      file << result.mean_abs_error;
+    }
+    else {
+      file << "null";
+    }
+    file << "\n"
+         << "    }";
+  }
+  file << "\n  ]\n}\n";
+  if (!file) {
+    throw runtime_error("failed to write JSON file '" + path + "'");
+  }
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[])
+{
+  using namespace std;
+
+  try {
+    auto list = false;
+    auto const options = ParseOptions(argc, argv, &list);
+    auto results = Benchmarks(options);
+    if (list) {
+      for (auto const& result : results) {
+        cout << result.name << endl;
+      }
+      return 0;
+    }
+
+    PrintHeader();
+    for (auto& result : results) {
+      switch (result.dimension) {
+      case 2:
+        RunWithPrecision<2>(&result);
+        break;
+      case 3:
+        RunWithPrecision<3>(&result);
+        break;
+      default:
+        RunWithPrecision<4>(&result);
+        break;
+      }
+      PrintResult(result);
+    }
+
+    if (!options.json_path.empty()) {
+      WriteJson(options.json_path, results);
+    }
+  }
+  catch (invalid_argument const& ex) {
+    cerr << "fast-marching-method-bench: " << ex.what() << endl << endl;
+    PrintUsage(cerr);
+    return 1;
+  }
+  catch (exception const& ex) {
+    cerr << "fast-marching-method-bench: " << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
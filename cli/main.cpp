@@ -0,0 +1,467 @@
+// Copyright 2017 Tommy Hinks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+// Command line tool for computing arrival times on a grid.
+//
+// Usage:
+//   fmm --size 64,64,64 --boundary boundary.txt [options]
+//
+// The boundary file has one boundary cell per line, given as integer grid
+// coordinates followed by the arrival time at the cell, separated by
+// whitespace. Empty lines and lines starting with '#' are ignored. Speed and
+// output grids are grid files, see GridFileWriter.
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../include/thinks/fast_marching_method/fast_marching_method.hpp"
+
+namespace {
+
+//! Options given on the command line.
+struct Options
+{
+  std::vector<std::size_t> grid_size;
+  std::vector<double> grid_spacing;
+  std::string boundary_path;
+  std::string speed_path;
+  std::string output_path;
+  std::string solver;
+  std::string precision;
+  double uniform_speed;
+  bool unsigned_times;
+  bool compress;
+};
+
+
+void PrintUsage(std::ostream& os)
+{
+  os << "usage: fmm --size <n0,n1[,n2]> --boundary <file> [options]\n"
+     << "\n"
+     << "options:\n"
+     << "  --size <n0,n1[,n2]>  grid size, 2 or 3 dimensions\n"
+     << "  --boundary <file>    boundary cells, one 'i0 i1 [i2] time'"
+     << " per line\n"
+     << "  --spacing <d[,...]>  grid spacing, one value or one per dimension"
+     << " (default 1)\n"
+     << "  --speed <file>       speed grid file, also gives the grid spacing\n"
+     << "  --uniform-speed <s>  speed when no speed grid is given (default 1)\n"
+     << "  --solver <name>      first-order (default), high-accuracy or"
+     << " distance\n"
+     << "  --precision <name>   float or double (default)\n"
+     << "  --unsigned           march a single front outward from the boundary"
+     << "\n"
+     << "                       instead of computing signed arrival times\n"
+     << "  --output <file>      write arrival times to a grid file\n"
+     << "  --compress           run-length encode the output grid file\n";
+}
+
+
+//! Returns the comma-separated values in @a text.
+//!
+//! Throws std::invalid_argument if a value cannot be parsed.
+template<typename T>
+std::vector<T> ParseList(std::string const& option, std::string const& text)
+{
+  using namespace std;
+
+  auto values = vector<T>();
+  auto ss = stringstream(text);
+  auto item = string();
+  while (getline(ss, item, ',')) {
+    auto item_ss = stringstream(item);
+    auto value = T();
+    if (!(item_ss >> value) || !(item_ss >> ws).eof()) {
+      throw invalid_argument("invalid value for " + option + ": " + text);
+    }
+    values.push_back(value);
+  }
+  if (values.empty()) {
+    throw invalid_argument("invalid value for " + option + ": " + text);
+  }
+  return values;
+}
+
+
+//! Returns the options given by @a argc and @a argv.
+//!
+//! Throws std::invalid_argument if the options are invalid.
+Options ParseOptions(int const argc, char* argv[])
+{
+  using namespace std;
+
+  auto options = Options();
+  options.solver = "first-order";
+  options.precision = "double";
+  options.uniform_speed = 1.0;
+  options.unsigned_times = false;
+  options.compress = false;
+
+  for (auto i = 1; i < argc; ++i) {
+    auto const option = string(argv[i]);
+    auto const value = [&]() {
+      if (i + 1 == argc) {
+        throw invalid_argument("missing value for " + option);
+      }
+      return string(argv[++i]);
+    };
+
+    if (option == "--size") {
+      options.grid_size = ParseList<size_t>(option, value());
+    }
+    else if (option == "--spacing") {
+      options.grid_spacing = ParseList<double>(option, value());
+    }
+    else if (option == "--boundary") {
+      options.boundary_path = value();
+    }
+    else if (option == "--speed") {
+      options.speed_path = value();
+    }
+    else if (option == "--uniform-speed") {
+      options.uniform_speed = ParseList<double>(option, value()).front();
+    }
+    else if (option == "--solver") {
+      options.solver = value();
+    }
+    else if (option == "--precision") {
+      options.precision = value();
+    }
+    else if (option == "--output") {
+      options.output_path = value();
+    }
+    else if (option == "--unsigned") {
+      options.unsigned_times = true;
+    }
+    else if (option == "--compress") {
+      options.compress = true;
+    }
+    else {
+      throw invalid_argument("unknown option: " + option);
+    }
+  }
+
+  if (options.grid_size.empty()) {
+    throw invalid_argument("missing option: --size");
+  }
+  if (options.boundary_path.empty()) {
+    throw invalid_argument("missing option: --boundary");
+  }
+  if (options.solver != "first-order" &&
+      options.solver != "high-accuracy" &&
+      options.solver != "distance") {
+    throw invalid_argument("unknown solver: " + options.solver);
+  }
+  if (options.precision != "float" && options.precision != "double") {
+    throw invalid_argument("unknown precision: " + options.precision);
+  }
+  if (!options.grid_spacing.empty() && !options.speed_path.empty()) {
+    throw invalid_argument("--spacing cannot be combined with --speed");
+  }
+  return options;
+}
+
+
+//! Reads boundary cells from the file at @a path into @a boundary_indices
+//! and @a boundary_times.
+//!
+//! Throws std::runtime_error if the file cannot be read or a line is
+//! invalid.
+template<typename T, std::size_t N>
+void ReadBoundary(
+  std::string const& path,
+  std::vector<std::array<std::int32_t, N>>* const boundary_indices,
+  std::vector<T>* const boundary_times)
+{
+  using namespace std;
+
+  auto file = ifstream(path);
+  if (!file) {
+    throw runtime_error("failed to open boundary file '" + path + "'");
+  }
+
+  auto line = string();
+  auto line_number = size_t{0};
+  while (getline(file, line)) {
+    ++line_number;
+    auto ss = stringstream(line);
+    if (!(ss >> ws) || ss.peek() == '#') {
+      continue;
+    }
+
+    auto index = array<int32_t, N>();
+    auto time = T();
+    for (auto& i : index) {
+      ss >> i;
+    }
+    ss >> time;
+    if (!ss || !(ss >> ws).eof()) {
+      auto error_ss = stringstream();
+      error_ss << "invalid boundary cell in '" << path << "' on line "
+               << line_number << ": " << line;
+      throw runtime_error(error_ss.str());
+    }
+    boundary_indices->push_back(index);
+    boundary_times->push_back(time);
+  }
+}
+
+
+//! Returns the grid spacing given in @a options, which is read from the
+//! speed grid file if there is one.
+//!
+//! Throws std::invalid_argument if the number of grid spacing values does
+//! not match the dimension.
+template<typename T, std::size_t N>
+std::array<T, N> GridSpacing(Options const& options)
+{
+  using namespace std;
+  namespace fmm = thinks::fast_marching_method;
+
+#if defined(__unix__) || defined(__APPLE__)
+  if (!options.speed_path.empty()) {
+    return fmm::GridFileView<T, N>(options.speed_path).grid_spacing();
+  }
+#endif
+
+  if (options.grid_spacing.size() > 1 && options.grid_spacing.size() != N) {
+    throw invalid_argument("--spacing does not match the dimension");
+  }
+  auto grid_spacing = array<T, N>();
+  for (auto i = size_t{0}; i < N; ++i) {
+    grid_spacing[i] = options.grid_spacing.empty() ? T{1} :
+      static_cast<T>(options.grid_spacing.size() == 1 ?
+        options.grid_spacing[0] : options.grid_spacing[i]);
+  }
+  return grid_spacing;
+}
+
+
+//! Returns arrival times computed with @a eikonal_solver, and adds the time
+//! spent in each phase to @a stats.
+template<typename T, std::size_t N, typename EikonalSolverType>
+std::vector<T> March(
+  Options const& options,
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  thinks::fast_marching_method::ArrivalTimeStats* const stats)
+{
+  namespace fmm = thinks::fast_marching_method;
+
+  if (options.unsigned_times) {
+    return fmm::GeodesicArrivalTime(
+      grid_size,
+      boundary_indices,
+      boundary_times,
+      eikonal_solver,
+      stats);
+  }
+  return fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    stats);
+}
+
+
+//! Returns arrival times computed with the solver chosen in @a options.
+//!
+//! Throws std::invalid_argument if the solver cannot be used with the
+//! other options.
+template<typename T, std::size_t N>
+std::vector<T> SolveWithOptions(
+  Options const& options,
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  thinks::fast_marching_method::ArrivalTimeStats* const stats)
+{
+  using namespace std;
+  namespace fmm = thinks::fast_marching_method;
+
+  if (!options.speed_path.empty()) {
+#if defined(__unix__) || defined(__APPLE__)
+    fmm::GridFileView<T, N> const speed_file(options.speed_path);
+    if (speed_file.size() != grid_size) {
+      throw invalid_argument("speed grid size does not match --size");
+    }
+    if (options.solver == "first-order") {
+      return March(options, grid_size, boundary_indices, boundary_times,
+        fmm::VaryingSpeedEikonalSolver<T, N>(speed_file), stats);
+    }
+    if (options.solver == "high-accuracy") {
+      return March(options, grid_size, boundary_indices, boundary_times,
+        fmm::HighAccuracyVaryingSpeedEikonalSolver<T, N>(speed_file), stats);
+    }
+    throw invalid_argument("solver " + options.solver +
+                           " cannot be used with --speed");
+#else
+    throw invalid_argument("--speed is not supported on this platform");
+#endif
+  }
+
+  auto const grid_spacing = GridSpacing<T, N>(options);
+  auto const uniform_speed = static_cast<T>(options.uniform_speed);
+
+  if (options.solver == "first-order") {
+    return March(options, grid_size, boundary_indices, boundary_times,
+      fmm::UniformSpeedEikonalSolver<T, N>(grid_spacing, uniform_speed),
+      stats);
+  }
+  if (options.solver == "high-accuracy") {
+    return March(options, grid_size, boundary_indices, boundary_times,
+      fmm::HighAccuracyUniformSpeedEikonalSolver<T, N>(
+        grid_spacing, uniform_speed),
+      stats);
+  }
+  if (options.grid_spacing.size() > 1 || options.uniform_speed != 1.0) {
+    throw invalid_argument(
+      "distance solver requires a single grid spacing and unit speed");
+  }
+  return March(options, grid_size, boundary_indices, boundary_times,
+    fmm::DistanceSolver<T, N>(grid_spacing[0]), stats);
+}
+
+
+void PrintTime(std::string const& name, std::chrono::nanoseconds const time)
+{
+  using namespace std;
+
+  cout << left << setw(16) << name << right << fixed << setprecision(3)
+       << setw(12) << time.count() * 1e-6 << " ms" << endl;
+}
+
+
+//! Runs the tool for arrival times of type T on an N-dimensional grid.
+template<typename T, std::size_t N>
+void Run(Options const& options)
+{
+  using namespace std;
+  using namespace std::chrono;
+  namespace fmm = thinks::fast_marching_method;
+
+  auto grid_size = array<size_t, N>();
+  copy(begin(options.grid_size), end(options.grid_size), begin(grid_size));
+
+  auto const read_start = steady_clock::now();
+  auto boundary_indices = vector<array<int32_t, N>>();
+  auto boundary_times = vector<T>();
+  ReadBoundary(options.boundary_path, &boundary_indices, &boundary_times);
+  auto const read_time =
+    duration_cast<nanoseconds>(steady_clock::now() - read_start);
+
+  auto stats = fmm::ArrivalTimeStats();
+  auto const march_start = steady_clock::now();
+  auto const arrival_times = SolveWithOptions(
+    options,
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    &stats);
+  auto const march_time =
+    duration_cast<nanoseconds>(steady_clock::now() - march_start);
+
+  auto const write_start = steady_clock::now();
+  if (!options.output_path.empty()) {
+    fmm::GridFileWriter<T, N> writer(
+      options.output_path,
+      grid_size,
+      GridSpacing<T, N>(options),
+      options.compress ?
+        fmm::GridFileCompression::kRunLength :
+        fmm::GridFileCompression::kNone);
+    writer.Write(arrival_times.data(), arrival_times.size());
+    writer.Close();
+  }
+  auto const write_time =
+    duration_cast<nanoseconds>(steady_clock::now() - write_start);
+
+  PrintTime("read input", read_time);
+  PrintTime("validation", stats.validation);
+  PrintTime("topology", stats.topology);
+  PrintTime("inside march", stats.inside_march);
+  PrintTime("outside march", stats.outside_march);
+  PrintTime("write output", write_time);
+  PrintTime("total", read_time + march_time + write_time);
+  cout << "cells/s         " << setprecision(0)
+       << arrival_times.size() / duration<double>(march_time).count() << endl;
+  cout << "solves          " << stats.solve_count << endl
+       << "stale pops      " << stats.stale_pop_count << endl
+       << "peak band size  " << stats.peak_narrow_band_size << endl
+       << "components      " << stats.connected_component_count << endl
+       << "dilation bands  " << stats.dilation_band_count << endl;
+}
+
+
+//! Runs the tool with the dimension and precision given in @a options.
+template<typename T>
+void RunWithDimension(Options const& options)
+{
+  using namespace std;
+
+  switch (options.grid_size.size()) {
+  case 2:
+    Run<T, 2>(options);
+    break;
+  case 3:
+    Run<T, 3>(options);
+    break;
+  default:
+    throw invalid_argument("unsupported dimension: " +
+                           to_string(options.grid_size.size()));
+  }
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[])
+{
+  using namespace std;
+
+  try {
+    auto const options = ParseOptions(argc, argv);
+    if (options.precision == "float") {
+      RunWithDimension<float>(options);
+    }
+    else {
+      RunWithDimension<double>(options);
+    }
+  }
+  catch (invalid_argument const& ex) {
+    cerr << "fmm: " << ex.what() << endl << endl;
+    PrintUsage(cerr);
+    return 1;
+  }
+  catch (exception const& ex) {
+    cerr << "fmm: " << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
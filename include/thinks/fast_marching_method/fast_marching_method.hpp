@@ -23,10 +23,15 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <exception>
+#include <fstream>
 #include <functional>
 #include <future>
 #include <limits>
@@ -35,25 +40,78 @@
 #include <queue>
 #include <sstream>
 #include <stack>
+#include <stdexcept>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
 namespace thinks {
 namespace fast_marching_method {
+
+//! Wall clock time spent in the phases of computing arrival times, and
+//! counts of the work done while marching, see SignedArrivalTime and
+//! GeodesicArrivalTime. Times and counts are added to the existing values
+//! (the peak narrow band size is the largest seen), so that one object can
+//! accumulate several calls. All times and counts start at zero.
+//!
+//! Topology is the inside/outside analysis of the boundary. Single front
+//! marching, as in GeodesicArrivalTime, has no topology or inside phases,
+//! all cells are marched in the outside phase.
+//!
+//! Stale pops are narrow band values popped for cells that had already been
+//! frozen with a smaller time, since the narrow band may hold several values
+//! for the same cell.
+struct ArrivalTimeStats
+{
+  std::chrono::nanoseconds validation = std::chrono::nanoseconds::zero();
+  std::chrono::nanoseconds topology = std::chrono::nanoseconds::zero();
+  std::chrono::nanoseconds inside_march = std::chrono::nanoseconds::zero();
+  std::chrono::nanoseconds outside_march = std::chrono::nanoseconds::zero();
+  std::size_t solve_count = 0;
+  std::size_t push_count = 0;
+  std::size_t stale_pop_count = 0;
+  std::size_t peak_narrow_band_size = 0;
+  std::size_t connected_component_count = 0;
+  std::size_t dilation_band_count = 0;
+};
+
+
+//! Compression of the tiles in a grid file, see GridFileWriter.
+enum class GridFileCompression : std::uint32_t
+{
+  kNone = 0,
+  kRunLength = 1
+};
+
+
 namespace detail {
 
+template<std::size_t N>
+void ThrowIfInvalidSize(std::array<std::size_t, N> const& size);
+
+
 //! Returns the product of the elements in array @a size.
-//! Note: Not checking for integer overflow here!
+//!
+//! Throws an std::invalid_argument exception if @a size is invalid, see
+//! ThrowIfInvalidSize. In particular, the product does not overflow.
 template<std::size_t N>
 std::size_t LinearSize(std::array<std::size_t, N> const& size)
 {
   using namespace std;
 
-  ThrowIfZeroElementInSize(size);
+  ThrowIfInvalidSize(size);
   return accumulate(begin(size), end(size), size_t{1}, multiplies<size_t>());
 }
 
@@ -205,6 +263,46 @@ void ThrowIfZeroElementInSize(std::array<std::size_t, N> const& size)
 }
 
 
+//! Returns the largest supported number of cells in a single grid
+//! dimension. Cells are addressed by 32-bit integer coordinates, and
+//! neighbors one cell outside the grid (or outside the grid padded by one
+//! cell) must also be addressable.
+constexpr std::size_t MaxSizeElement()
+{
+  return static_cast<std::size_t>(
+    std::numeric_limits<std::int32_t>::max() - 2);
+}
+
+
+//! Throws an std::invalid_argument exception if:
+//! - One or more of the elements in @a size is zero, or
+//! - One or more of the elements in @a size is larger than
+//!   MaxSizeElement(), or
+//! - The product of the elements in @a size, i.e. the number of grid cells,
+//!   does not fit in std::size_t.
+//!
+//! Linear indices are computed using std::size_t, so grids with more than
+//! 2^32 cells are supported on 64-bit platforms.
+template<std::size_t N>
+void ThrowIfInvalidSize(std::array<std::size_t, N> const& size)
+{
+  using namespace std;
+
+  ThrowIfZeroElementInSize(size);
+
+  auto linear_size = size_t{1};
+  for (auto const x : size) {
+    if (x > MaxSizeElement() ||
+        x > numeric_limits<size_t>::max() / linear_size) {
+      auto ss = stringstream();
+      ss << "invalid size: " << ToString(size);
+      throw invalid_argument(ss.str());
+    }
+    linear_size *= x;
+  }
+}
+
+
 //! Throws an std::invalid_argument exception if the linear size
 //! of @a grid_size is not equal to @a cell_buffer_size.
 template<std::size_t N>
@@ -283,6 +381,55 @@ void ThrowIfBoundaryIndexOutsideGrid(
 }
 
 
+//! Throws an std::invalid_argument exception if @a target_index is not
+//! inside @a grid_size.
+template<std::size_t N>
+void ThrowIfTargetIndexOutsideGrid(
+  std::array<std::int32_t, N> const& target_index,
+  std::array<std::size_t, N> const& grid_size)
+{
+  using namespace std;
+
+  if (!Inside(target_index, grid_size)) {
+    auto ss = stringstream();
+    ss << "target index outside grid - "
+       << "index: " << ToString(target_index) << ", "
+       << "grid size: " << ToString(grid_size);
+    throw invalid_argument(ss.str());
+  }
+}
+
+
+//! Throws an std::invalid_argument exception if @a receiver_index is not
+//! inside @a grid_size.
+template<std::size_t N>
+void ThrowIfReceiverIndexOutsideGrid(
+  std::array<std::int32_t, N> const& receiver_index,
+  std::array<std::size_t, N> const& grid_size)
+{
+  using namespace std;
+
+  if (!Inside(receiver_index, grid_size)) {
+    auto ss = stringstream();
+    ss << "receiver index outside grid - "
+       << "index: " << ToString(receiver_index) << ", "
+       << "grid size: " << ToString(grid_size);
+    throw invalid_argument(ss.str());
+  }
+}
+
+
+//! Throws an std::invalid_argument exception if @a thread_count is zero.
+inline void ThrowIfZeroThreadCount(std::size_t const thread_count)
+{
+  using namespace std;
+
+  if (thread_count == 0) {
+    throw invalid_argument("invalid thread count: 0");
+  }
+}
+
+
 //! Throws an std::invalid_argument exception if the flag @a valid is false.
 //! @a time is used to construct the exception message.
 template<typename T>
@@ -333,6 +480,87 @@ void ThrowIfBoundaryIndicesTimesSizeMismatch(
 }
 
 
+//! Throws an std::invalid_argument if the size of @a boundary_indices is
+//! not equal to the size of @a boundary_labels.
+template<typename L, std::size_t N>
+void ThrowIfBoundaryIndicesLabelsSizeMismatch(
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<L> const& boundary_labels)
+{
+  using namespace std;
+
+  if (boundary_indices.size() != boundary_labels.size()) {
+    auto ss = stringstream();
+    ss << "boundary indices[" << boundary_indices.size() << "] / "
+       << "boundary labels[" << boundary_labels.size() << "] size mismatch";
+    throw invalid_argument(ss.str());
+  }
+}
+
+
+//! Throws an std::invalid_argument if the size of @a boundary_indices is
+//! not equal to the size of @a boundary_values.
+template<typename V, std::size_t N>
+void ThrowIfBoundaryIndicesValuesSizeMismatch(
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<V> const& boundary_values)
+{
+  using namespace std;
+
+  if (boundary_indices.size() != boundary_values.size()) {
+    auto ss = stringstream();
+    ss << "boundary indices[" << boundary_indices.size() << "] / "
+       << "boundary values[" << boundary_values.size() << "] size mismatch";
+    throw invalid_argument(ss.str());
+  }
+}
+
+
+//! Throws an std::invalid_argument exception if @a position is not inside
+//! a grid of size @a grid_size with cells of size @a grid_spacing. The grid
+//! covers [0, grid_size[i] * grid_spacing[i]) in each dimension i.
+template<typename T, std::size_t N>
+void ThrowIfPositionOutsideGrid(
+  std::array<T, N> const& position,
+  std::array<std::size_t, N> const& grid_size,
+  std::array<T, N> const& grid_spacing)
+{
+  using namespace std;
+
+  for (auto i = size_t{0}; i < N; ++i) {
+    // Fail when position is NaN.
+    if (!(T{0} <= position[i] &&
+          position[i] < grid_size[i] * grid_spacing[i])) {
+      auto ss = stringstream();
+      ss << "position outside grid - "
+         << "position: " << ToString(position) << ", "
+         << "grid size: " << ToString(grid_size);
+      throw invalid_argument(ss.str());
+    }
+  }
+}
+
+
+//! Throws an std::invalid_argument exception if @a step_length is not
+//! positive or larger than half the smallest element in @a grid_spacing.
+template<typename T, std::size_t N>
+void ThrowIfInvalidStepLength(
+  T const step_length,
+  std::array<T, N> const& grid_spacing)
+{
+  using namespace std;
+
+  // Fail when step length is NaN.
+  auto const min_grid_spacing =
+    *min_element(begin(grid_spacing), end(grid_spacing));
+  if (!(T{0} < step_length && step_length <= T(0.5) * min_grid_spacing)) {
+    auto ss = stringstream();
+    ss << "invalid step length: " << step_length;
+    throw invalid_argument(ss.str());
+  }
+}
+
+
 //! Throws an std::runtime_error exception if @a arrival_time is not valid.
 template<typename T, std::size_t N>
 void ThrowIfInvalidArrivalTime(
@@ -391,6 +619,54 @@ void ThrowIfFullGridBoundaryIndices(
 }
 
 
+//! Throws an std::invalid_argument exception if @a max_time is NaN or
+//! negative.
+template<typename T>
+void ThrowIfInvalidMaxTime(T const max_time)
+{
+  using namespace std;
+
+  if (!(max_time >= T{0})) {
+    auto ss = stringstream();
+    ss << "invalid max time: " << max_time;
+    throw invalid_argument(ss.str());
+  }
+}
+
+
+//! Throws an std::invalid_argument exception if @a max_time is NaN or
+//! negative, or if @a far_time is not frozen or not larger than @a max_time.
+template<typename T>
+void ThrowIfInvalidMaxTime(T const max_time, T const far_time)
+{
+  using namespace std;
+
+  ThrowIfInvalidMaxTime(max_time);
+
+  // Fail when far time is NaN.
+  if (!(max_time < far_time && far_time < numeric_limits<T>::max())) {
+    auto ss = stringstream();
+    ss << "invalid far time: " << far_time;
+    throw invalid_argument(ss.str());
+  }
+}
+
+
+//! Throws an std::invalid_argument exception if the level set value
+//! @a phi is NaN.
+template<typename T>
+void ThrowIfInvalidPhi(T const phi)
+{
+  using namespace std;
+
+  if (isnan(phi)) {
+    auto ss = stringstream();
+    ss << "invalid phi: " << phi;
+    throw invalid_argument(ss.str());
+  }
+}
+
+
 //! Returns an array that can be used to transform an N-dimensional index
 //! into a linear index.
 template<std::size_t N>
@@ -410,8 +686,9 @@ std::array<std::size_t, N - 1> GridStrides(
 
 
 //! Returns a linear (scalar) index into an array representing an
-//! N-dimensional grid for integer coordinate @a index.
-//! Note: Not checking for integer overflow here!
+//! N-dimensional grid for integer coordinate @a index. The index is
+//! computed using std::size_t, so it does not overflow for cells inside
+//! grids with valid sizes, see ThrowIfInvalidSize.
 template<std::size_t N>
 std::size_t GridLinearIndex(
   std::array<std::int32_t, N> const& index,
@@ -421,12 +698,36 @@ std::size_t GridLinearIndex(
 
   auto k = static_cast<size_t>(index[0]);
   for (auto i = size_t{1}; i < N; ++i) {
-    k += index[i] * grid_strides[i - 1];
+    k += static_cast<size_t>(index[i]) * grid_strides[i - 1];
   }
   return k;
 }
 
 
+//! Returns the integer coordinate for @a linear_index into an array
+//! representing an N-dimensional grid of size @a grid_size. This is the
+//! inverse of GridLinearIndex.
+//!
+//! Preconditions:
+//! - @a linear_index is less than the linear size of @a grid_size.
+template<std::size_t N>
+std::array<std::int32_t, N> GridIndex(
+  std::size_t linear_index,
+  std::array<std::size_t, N> const& grid_size)
+{
+  using namespace std;
+
+  assert(linear_index < LinearSize(grid_size) && "Precondition");
+
+  auto index = array<int32_t, N>();
+  for (auto i = size_t{0}; i < N; ++i) {
+    index[i] = static_cast<int32_t>(linear_index % grid_size[i]);
+    linear_index /= grid_size[i];
+  }
+  return index;
+}
+
+
 //! Access a linear array as if it were an N-dimensional grid.
 //! Allows mutating operations on the underlying array. The grid does
 //! not own the underlying array, but is simply an indexing structure.
@@ -475,13 +776,30 @@ public:
     , strides_(GridStrides(size))
     , cells_(nullptr)
   {
-    ThrowIfZeroElementInSize(size);
+    ThrowIfInvalidSize(size);
     ThrowIfInvalidCellBufferSize(size, cell_buffer.size());
 
     assert(!cell_buffer.empty());
     cells_ = &cell_buffer.front();
   }
 
+  //! Construct a grid from a given @a size and a pointer to a buffer of
+  //! @a cell_buffer_size cells, e.g. a memory-mapped file. Does not take
+  //! ownership of the cell buffer, see above.
+  Grid(
+    SizeType const& size,
+    T* const cell_buffer,
+    std::size_t const cell_buffer_size)
+    : size_(size)
+    , strides_(GridStrides(size))
+    , cells_(cell_buffer)
+  {
+    ThrowIfInvalidSize(size);
+    ThrowIfInvalidCellBufferSize(size, cell_buffer_size);
+
+    assert(cell_buffer != nullptr && "Precondition");
+  }
+
   //! Returns the size of the grid.
   SizeType size() const
   {
@@ -560,13 +878,30 @@ public:
     , strides_(GridStrides(size))
     , cells_(nullptr)
   {
-    ThrowIfZeroElementInSize(size);
+    ThrowIfInvalidSize(size);
     ThrowIfInvalidCellBufferSize(size, cell_buffer.size());
 
     assert(!cell_buffer.empty() && "Precondition");
     cells_ = &cell_buffer.front();
   }
 
+  //! Construct a grid from a given @a size and a pointer to a buffer of
+  //! @a cell_buffer_size cells, e.g. a memory-mapped file. Does not take
+  //! ownership of the cell buffer, see above.
+  ConstGrid(
+    SizeType const& size,
+    T const* const cell_buffer,
+    std::size_t const cell_buffer_size)
+    : size_(size)
+    , strides_(GridStrides(size))
+    , cells_(cell_buffer)
+  {
+    ThrowIfInvalidSize(size);
+    ThrowIfInvalidCellBufferSize(size, cell_buffer_size);
+
+    assert(cell_buffer != nullptr && "Precondition");
+  }
+
   //! Returns the size of the grid.
   SizeType size() const
   {
@@ -611,6 +946,23 @@ public:
     return min_heap_.empty();
   }
 
+  //! Returns the number of values in the store.
+  std::size_t size() const
+  {
+    return min_heap_.size();
+  }
+
+  //! Returns the value with the smallest distance in the store, without
+  //! removing it.
+  //!
+  //! Preconditions:
+  //! - The store is not empty (check first with empty()).
+  ValueType const& Top() const
+  {
+    assert(!min_heap_.empty() && "Precondition");
+    return min_heap_.front(); // O(1)
+  }
+
   //! Remove the value with the smallest distance from the store and
   //! return it.
   //!
@@ -619,78 +971,248 @@ public:
   ValueType Pop()
   {
     assert(!min_heap_.empty() && "Precondition");
-    auto const v = min_heap_.top(); // O(1)
-    min_heap_.pop(); // O(log N)
+    std::pop_heap(
+      std::begin(min_heap_),
+      std::end(min_heap_),
+      std::greater<ValueType>()); // O(log N)
+    auto const v = min_heap_.back();
+    min_heap_.pop_back();
     return v;
   }
 
   //! Adds @a value to the store.
   void Push(ValueType const& value)
   {
-    min_heap_.push(value); // O(log N)
+    min_heap_.push_back(value);
+    std::push_heap(
+      std::begin(min_heap_),
+      std::end(min_heap_),
+      std::greater<ValueType>()); // O(log N)
   }
 
-private:
-  // Place smaller values at the top of the heap.
-  typedef std::priority_queue<
-    ValueType,
-    std::vector<ValueType>,
-    std::greater<ValueType>> MinHeap_;
+  //! Remove all values from the store. Allocated memory is kept, so that
+  //! the store can be re-used without allocations.
+  void Clear()
+  {
+    min_heap_.clear();
+  }
 
-  MinHeap_ min_heap_;
+private:
+  // Place smaller values at the front of the heap. Same ordering as a
+  // std::priority_queue, but the underlying memory can be re-used.
+  std::vector<ValueType> min_heap_;
 };
 
 
-//! Returns an array of pairs, where each element is the min/max index
-//! coordinates in the corresponding dimension.
-//!
-//! Preconditions:
-//! - @a indices is not empty.
-template<std::size_t N>
-std::array<std::pair<std::int32_t, std::int32_t>, N> BoundingBox(
-  std::vector<std::array<std::int32_t, N>> const& indices)
+//! Narrow band store that orders cells by arrival time plus a heuristic
+//! lower bound on the remaining time to a target, given by
+//! heuristic(index). The interface is the same as NarrowBandStore, i.e.
+//! values are (time, index) pairs, so that the same marching code can be
+//! used for both stores. Only the order in which values are popped differs.
+template<typename T, std::size_t N, typename H>
+class HeuristicNarrowBandStore
 {
-  using namespace std;
+public:
+  typedef T DistanceType;
+  typedef std::array<std::int32_t, N> IndexType;
+  typedef std::pair<DistanceType, IndexType> ValueType;
 
-  static_assert(N > 0, "Dimensionality cannot be zero");
+  //! Create an empty store.
+  explicit HeuristicNarrowBandStore(H const& heuristic)
+    : heuristic_(heuristic)
+  {}
 
-  assert(!indices.empty() && "Precondition");
+  //! Returns true if the store is empty, otherwise false.
+  bool empty() const
+  {
+    return min_heap_.empty();
+  }
 
-  // Initialize bounding box in all dimensions.
-  auto bbox = array<pair<int32_t, int32_t>, N>();
-  for (auto i = size_t{0}; i < N; ++i) {
-    bbox[i].first = numeric_limits<int32_t>::max();
-    bbox[i].second = numeric_limits<int32_t>::min();
+  //! Returns the number of values in the store.
+  std::size_t size() const
+  {
+    return min_heap_.size();
   }
 
-  // Update with each index in all dimensions.
-  for (auto const& index : indices) {
-    for (auto i = size_t{0}; i < N; ++i) {
-      bbox[i].first = min(bbox[i].first, index[i]);
-      bbox[i].second = max(bbox[i].second, index[i]);
-    }
+  //! Returns the value with the smallest time plus heuristic in the store,
+  //! without removing it.
+  //!
+  //! Preconditions:
+  //! - The store is not empty (check first with empty()).
+  ValueType const& Top() const
+  {
+    assert(!min_heap_.empty() && "Precondition");
+    return min_heap_.top().second; // O(1)
   }
-  return bbox;
-}
 
+  //! Remove the value with the smallest time plus heuristic from the store
+  //! and return it.
+  //!
+  //! Preconditions:
+  //! - The store is not empty (check first with empty()).
+  ValueType Pop()
+  {
+    assert(!min_heap_.empty() && "Precondition");
+    auto const v = min_heap_.top().second; // O(1)
+    min_heap_.pop(); // O(log N)
+    return v;
+  }
 
-//! Returns the hyper volume of the provided N-dimensional
-//! bounding box @a bbox. This function does not take grid spacing into
-//! account, but rather returns the volume in an index space.
-//!
-//! Preconditions:
-//! - The pairs representing bounds in each dimension store the lower bound
-//!   as the first element and the higher bound as the second element.
-template<std::size_t N>
-std::size_t HyperVolume(
-  std::array<std::pair<std::int32_t, std::int32_t>, N> const& bbox)
-{
-  using namespace std;
+  //! Adds @a value to the store.
+  void Push(ValueType const& value)
+  {
+    min_heap_.push({value.first + heuristic_(value.second), value}); // O(log N)
+  }
+
+private:
+  typedef std::pair<DistanceType, ValueType> HeapValueType_;
+
+  // Place smaller values at the top of the heap.
+  typedef std::priority_queue<
+    HeapValueType_,
+    std::vector<HeapValueType_>,
+    std::greater<HeapValueType_>> MinHeap_;
+
+  H const& heuristic_;
+  MinHeap_ min_heap_;
+};
+
+
+//! Stats recorder that records nothing. Calls are inlined away, so that
+//! marching without stats has no overhead. See ArrivalTimeStatsRecorder
+//! for the interface.
+struct NullArrivalTimeStatsRecorder
+{
+  std::chrono::nanoseconds* PhaseTime(
+    std::chrono::nanoseconds ArrivalTimeStats::* const) const
+  {
+    return nullptr;
+  }
+
+  void CountSolve() const
+  {}
+
+  void CountPush(std::size_t const) const
+  {}
+
+  void CountStalePop() const
+  {}
+
+  void CountTopology(std::size_t const, std::size_t const) const
+  {}
+};
+
+
+//! Stats recorder that adds phase times and counts to an ArrivalTimeStats.
+//! Marching functions are templated on the recorder type, so the counting
+//! code is only compiled in when stats are requested.
+class ArrivalTimeStatsRecorder
+{
+public:
+  //! Preconditions:
+  //! - @a stats is not null.
+  explicit ArrivalTimeStatsRecorder(ArrivalTimeStats* const stats)
+    : stats_(stats)
+  {
+    assert(stats != nullptr && "Precondition");
+  }
+
+  //! Returns a pointer to the @a phase time in the stats, see
+  //! ScopedPhaseTimer.
+  std::chrono::nanoseconds* PhaseTime(
+    std::chrono::nanoseconds ArrivalTimeStats::* const phase) const
+  {
+    return &(stats_->*phase);
+  }
+
+  //! Called for each arrival time estimated by an eikonal solver.
+  void CountSolve() const
+  {
+    ++stats_->solve_count;
+  }
+
+  //! Called after a value was pushed to a narrow band holding
+  //! @a narrow_band_size values.
+  void CountPush(std::size_t const narrow_band_size) const
+  {
+    ++stats_->push_count;
+    stats_->peak_narrow_band_size =
+      std::max(stats_->peak_narrow_band_size, narrow_band_size);
+  }
+
+  //! Called for each narrow band value popped for a frozen cell.
+  void CountStalePop() const
+  {
+    ++stats_->stale_pop_count;
+  }
+
+  //! Called once per inside/outside analysis of the boundary.
+  void CountTopology(
+    std::size_t const connected_component_count,
+    std::size_t const dilation_band_count) const
+  {
+    stats_->connected_component_count += connected_component_count;
+    stats_->dilation_band_count += dilation_band_count;
+  }
+
+private:
+  ArrivalTimeStats* const stats_;
+};
+
+
+//! Returns an array of pairs, where each element is the min/max index
+//! coordinates in the corresponding dimension.
+//!
+//! Preconditions:
+//! - @a indices is not empty.
+template<std::size_t N>
+std::array<std::pair<std::int32_t, std::int32_t>, N> BoundingBox(
+  std::vector<std::array<std::int32_t, N>> const& indices)
+{
+  using namespace std;
+
+  static_assert(N > 0, "Dimensionality cannot be zero");
+
+  assert(!indices.empty() && "Precondition");
+
+  // Initialize bounding box in all dimensions.
+  auto bbox = array<pair<int32_t, int32_t>, N>();
+  for (auto i = size_t{0}; i < N; ++i) {
+    bbox[i].first = numeric_limits<int32_t>::max();
+    bbox[i].second = numeric_limits<int32_t>::min();
+  }
+
+  // Update with each index in all dimensions.
+  for (auto const& index : indices) {
+    for (auto i = size_t{0}; i < N; ++i) {
+      bbox[i].first = min(bbox[i].first, index[i]);
+      bbox[i].second = max(bbox[i].second, index[i]);
+    }
+  }
+  return bbox;
+}
+
+
+//! Returns the hyper volume of the provided N-dimensional
+//! bounding box @a bbox. This function does not take grid spacing into
+//! account, but rather returns the volume in an index space.
+//!
+//! Preconditions:
+//! - The pairs representing bounds in each dimension store the lower bound
+//!   as the first element and the higher bound as the second element.
+template<std::size_t N>
+std::size_t HyperVolume(
+  std::array<std::pair<std::int32_t, std::int32_t>, N> const& bbox)
+{
+  using namespace std;
 
   auto hyper_volume = size_t{1};
   for (auto i = size_t{0}; i < N; ++i) {
     assert(bbox[i].first <= bbox[i].second && "Precondition");
-    hyper_volume *= (bbox[i].second - bbox[i].first + 1);
+    // Compute the extent using std::size_t, since the 32-bit difference
+    // overflows for very large grids.
+    hyper_volume *= static_cast<size_t>(bbox[i].second) -
+                    static_cast<size_t>(bbox[i].first) + size_t{1};
   }
   return hyper_volume;
 }
@@ -902,6 +1424,8 @@ std::array<std::int32_t, N>
 DistanceGridIndexFromDilationGridIndex(
   std::array<std::int32_t, N> const& dilation_grid_index)
 {
+  using namespace std;
+
   auto distance_grid_index = dilation_grid_index;
   for_each(begin(distance_grid_index), end(distance_grid_index),
            [](auto& d) { d -= int32_t{1}; });
@@ -915,6 +1439,8 @@ std::array<std::int32_t, N>
 DilationGridIndexFromDistanceGridIndex(
   std::array<std::int32_t, N> const& distance_grid_index)
 {
+  using namespace std;
+
   auto dilation_grid_index = distance_grid_index;
   for_each(begin(dilation_grid_index), end(dilation_grid_index),
            [](auto& d) { d += int32_t{1}; assert(d >= int32_t{0}); });
@@ -1111,16 +1637,19 @@ NarrowBandDilationBandCells(
 //! returned list may contain duplicates (this is not the case for the inside
 //! indices).
 //!
-//! All returned indices are guaranteed to be inside @a grid_size.
+//! All returned indices are guaranteed to be inside @a grid_size. The
+//! number of connected components and dilation bands are passed to
+//! @a stats_recorder.
 //!
 //! Preconditions:
 //! - Every element in @a boundary_indices is inside @a grid_size.
-template<std::size_t N>
+template<std::size_t N, typename R>
 std::pair<std::vector<std::array<std::int32_t, N>>,
           std::vector<std::array<std::int32_t, N>>>
 OutsideInsideNarrowBandIndices(
   std::vector<std::array<std::int32_t, N>> const& boundary_indices,
-  std::array<std::size_t, N> const& grid_size)
+  std::array<std::size_t, N> const& grid_size,
+  R& stats_recorder)
 {
   using namespace std;
 
@@ -1199,6 +1728,7 @@ OutsideInsideNarrowBandIndices(
   // dilation bands for all boundary indices at once we would then need to
   // do extra work to figure out if these were outer or inner dilation bands.
   auto const face_neighbor_offsets = FaceNeighborOffsets<N>();
+  auto dilation_band_count = size_t{0};
   for (auto const& connected_component : connected_components) {
     auto const dilation_bands = DilationBands(
       connected_component,
@@ -1208,6 +1738,7 @@ OutsideInsideNarrowBandIndices(
       begin(face_neighbor_offsets),
       end(face_neighbor_offsets));
     assert(!dilation_bands.empty());
+    dilation_band_count += dilation_bands.size();
 
     if (dilation_bands.size() == 1) {
       // Only one dilation band means that the connected component has genus
@@ -1307,10 +1838,29 @@ OutsideInsideNarrowBandIndices(
     }
   }
 
+  stats_recorder.CountTopology(
+    connected_components.size(),
+    dilation_band_count);
   return {outside_narrow_band_indices, inside_narrow_band_indices};
 }
 
 
+//! Same as above, without stats.
+template<std::size_t N>
+std::pair<std::vector<std::array<std::int32_t, N>>,
+          std::vector<std::array<std::int32_t, N>>>
+OutsideInsideNarrowBandIndices(
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::array<std::size_t, N> const& grid_size)
+{
+  auto stats_recorder = NullArrivalTimeStatsRecorder();
+  return OutsideInsideNarrowBandIndices(
+    boundary_indices,
+    grid_size,
+    stats_recorder);
+}
+
+
 //! Returns true if the (distance) value @a d  is considered frozen,
 //! otherwise false.
 //!
@@ -1339,13 +1889,13 @@ bool Frozen(T const d)
 //! - The @a check_duplicate_indices is true and there is one or more
 //!   duplicate in @a indices.
 //! - Not every element in @a boundary_indices is inside @a time_grid.
-template <typename T, std::size_t N>
+template <typename T, std::size_t N, typename G>
 void SetBoundaryCondition(
   std::vector<std::array<std::int32_t, N>> const& boundary_indices,
   std::vector<T> const& boundary_times,
   T const multiplier,
   bool const check_duplicate_indices,
-  Grid<T, N>* const time_grid)
+  G* const time_grid)
 {
   using namespace std;
 
@@ -1367,6 +1917,90 @@ void SetBoundaryCondition(
 }
 
 
+//! Returns the indices of the non-frozen face-neighbors of the cells at
+//! @a boundary_indices in @a time_grid. The returned list may contain
+//! duplicates, and is empty if there are no non-frozen face-neighbors.
+//!
+//! Preconditions:
+//! - Boundary condition times have been set in @a time_grid.
+template<std::size_t N, typename G>
+std::vector<std::array<std::int32_t, N>>
+FaceNeighborNarrowBandIndices(
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  G const& time_grid)
+{
+  using namespace std;
+
+  auto narrow_band_indices = vector<array<int32_t, N>>();
+  auto const face_neighbor_offsets = FaceNeighborOffsets<N>();
+  for (auto const& boundary_index : boundary_indices) {
+    assert(Inside(boundary_index, time_grid.size()) && "Precondition");
+    assert(Frozen(time_grid.Cell(boundary_index)) && "Precondition");
+    for (auto const& face_neighbor_offset : face_neighbor_offsets) {
+      auto neighbor_index = boundary_index;
+      for (auto i = size_t{0}; i < N; ++i) {
+        neighbor_index[i] += face_neighbor_offset[i];
+      }
+
+      if (Inside(neighbor_index, time_grid.size()) &&
+          !Frozen(time_grid.Cell(neighbor_index))) {
+        narrow_band_indices.push_back(neighbor_index);
+      }
+    }
+  }
+  return narrow_band_indices;
+}
+
+
+//! Clears @a narrow_band and fills it with estimated distances for the
+//! cells in @a narrow_band_indices, re-using the memory already allocated
+//! by the store. Solves and pushes are passed to @a stats_recorder. See
+//! InitializedNarrowBand.
+template<typename T, std::size_t N, typename E, typename G, typename R>
+void InitializeNarrowBand(
+  std::vector<std::array<std::int32_t, N>> const& narrow_band_indices,
+  G const& time_grid,
+  E const& eikonal_solver,
+  NarrowBandStore<T, N>* const narrow_band,
+  R& stats_recorder)
+{
+  using namespace std;
+
+  assert(narrow_band != nullptr);
+  assert(!narrow_band_indices.empty() && "Precondition");
+
+  narrow_band->Clear();
+  for (auto const& narrow_band_index : narrow_band_indices) {
+    assert(Inside(narrow_band_index, time_grid.size()) && "Precondition");
+    assert(!Frozen(time_grid.Cell(narrow_band_index)) && "Precondition");
+    narrow_band->Push({
+      eikonal_solver.Solve(narrow_band_index, time_grid),
+      narrow_band_index});
+    stats_recorder.CountSolve();
+    stats_recorder.CountPush(narrow_band->size());
+  }
+  assert(!narrow_band->empty());
+}
+
+
+//! Same as above, without stats.
+template<typename T, std::size_t N, typename E, typename G>
+void InitializeNarrowBand(
+  std::vector<std::array<std::int32_t, N>> const& narrow_band_indices,
+  G const& time_grid,
+  E const& eikonal_solver,
+  NarrowBandStore<T, N>* const narrow_band)
+{
+  auto stats_recorder = NullArrivalTimeStatsRecorder();
+  InitializeNarrowBand(
+    narrow_band_indices,
+    time_grid,
+    eikonal_solver,
+    narrow_band,
+    stats_recorder);
+}
+
+
 //! Returns a (non-null) non-empty narrow band store containing estimated
 //! distances for the cells in @a narrow_band_indices. Note that
 //! @a narrow_band_indices may contain duplicates.
@@ -1385,32 +2019,28 @@ InitializedNarrowBand(
 {
   using namespace std;
 
-  assert(!narrow_band_indices.empty() && "Precondition");
-
   auto narrow_band =
     unique_ptr<NarrowBandStore<T, N>>(new NarrowBandStore<T, N>());
-  for (auto const& narrow_band_index : narrow_band_indices) {
-    assert(Inside(narrow_band_index, time_grid.size()) && "Precondition");
-    assert(!Frozen(time_grid.Cell(narrow_band_index)) && "Precondition");
-    narrow_band->Push({
-      eikonal_solver.Solve(narrow_band_index, time_grid),
-      narrow_band_index});
-  }
-  assert(!narrow_band->empty());
-
+  InitializeNarrowBand(
+    narrow_band_indices,
+    time_grid,
+    eikonal_solver,
+    narrow_band.get());
   return narrow_band;
 }
 
 
 //! Compute arrival times using the @a eikonal_solver for the face-neighbors of
 //! the cell at @a index. The arrival times are not written to the @a time_grid,
-//! but are instead stored in the @a narrow_band.
-template <typename T, std::size_t N, typename E>
+//! but are instead stored in the @a narrow_band. Solves and pushes are passed
+//! to @a stats_recorder.
+template <std::size_t N, typename E, typename G, typename S, typename R>
 void UpdateNeighbors(
   std::array<std::int32_t, N> const& index,
   E const& eikonal_solver,
-  Grid<T, N>* const time_grid,
-  NarrowBandStore<T, N>* const narrow_band)
+  G* const time_grid,
+  S* const narrow_band,
+  R& stats_recorder)
 {
   using namespace std;
 
@@ -1440,6 +2070,8 @@ void UpdateNeighbors(
           narrow_band->Push({
             eikonal_solver.Solve(neighbor_index, *time_grid),
             neighbor_index});
+          stats_recorder.CountSolve();
+          stats_recorder.CountPush(narrow_band->size());
         }
       }
     }
@@ -1447,17 +2079,125 @@ void UpdateNeighbors(
 }
 
 
+//! Take the smallest time from the @a narrow_band and freeze it, i.e. write
+//! it to the @a time_grid, then update the narrow band with times for the
+//! non-frozen face-neighbors of the newly frozen cell. The
+//! @a frozen_cell_visitor is called as frozen_cell_visitor(index, time) for
+//! the newly frozen cell.
+//!
+//! Returns true if a cell was frozen, false if the smallest time in the
+//! narrow band belonged to a cell that was already frozen. Solves, pushes
+//! and stale pops are passed to @a stats_recorder.
+//!
+//! Preconditions:
+//! - @a narrow_band is not empty.
+template <typename E, typename S, typename G, typename V, typename R>
+bool FreezeNarrowBandCell(
+  E const& eikonal_solver,
+  S* const narrow_band,
+  G* const time_grid,
+  V& frozen_cell_visitor,
+  R& stats_recorder)
+{
+  using namespace std;
+
+  assert(time_grid != nullptr);
+  assert(narrow_band != nullptr);
+  assert(!narrow_band->empty() && "Precondition");
+
+  auto const narrow_band_cell = narrow_band->Pop();
+  auto const time = narrow_band_cell.first;
+  auto const index = narrow_band_cell.second;
+
+  assert(Inside(index, time_grid->size()));
+  auto& time_cell = time_grid->Cell(index);
+
+  // Since we allow multiple values for the same cell index in the
+  // narrow band it could happen that this grid cell has already been
+  // frozen. In that case just ignore subsequent values from the narrow
+  // band for that grid cell and move on.
+  if (Frozen(time_cell)) {
+    stats_recorder.CountStalePop();
+    return false;
+  }
+
+  time_cell = time;
+  assert(Frozen(time_cell));
+  frozen_cell_visitor(index, time);
+
+  // Update distances for non-frozen face-neighbors of the newly
+  // frozen cell.
+  UpdateNeighbors(
+    index,
+    eikonal_solver,
+    time_grid,
+    narrow_band,
+    stats_recorder);
+  return true;
+}
+
+
+//! Same as above, without stats.
+template <typename E, typename S, typename G, typename V>
+bool FreezeNarrowBandCell(
+  E const& eikonal_solver,
+  S* const narrow_band,
+  G* const time_grid,
+  V& frozen_cell_visitor)
+{
+  auto stats_recorder = NullArrivalTimeStatsRecorder();
+  return FreezeNarrowBandCell(
+    eikonal_solver,
+    narrow_band,
+    time_grid,
+    frozen_cell_visitor,
+    stats_recorder);
+}
+
+
 //! Compute distances using @a eikonal_solver for all non-frozen cells in
 //! @a distance_grid that have a face-connected path to at least one of the
 //! cells in @a narrow_band.
 //!
+//! Marching stops when the smallest time in the narrow band is larger than
+//! @a max_time. In that case the narrow band is left non-empty, and cells
+//! that were not reached remain non-frozen in @a time_grid.
+//!
+//! The @a frozen_cell_visitor is called as frozen_cell_visitor(index, time)
+//! each time a cell is frozen, i.e. exactly once for every cell whose time
+//! is written to @a time_grid.
+//!
+//! Marching also stops when @a stop_predicate() returns true. The predicate
+//! is checked each time a cell has been frozen and its neighbors have been
+//! updated, so that the narrow band is left in a consistent state.
+//!
+//! The @a narrow_band is typically a NarrowBandStore, but any store with
+//! the same interface can be used, e.g. a HeuristicNarrowBandStore to
+//! change the order in which cells are frozen.
+//! Likewise, @a time_grid is typically a Grid, but a SparseGrid can be
+//! used to store only the cells around the boundary.
+//!
+//! Solves, pushes and stale pops are passed to @a stats_recorder, see
+//! ArrivalTimeStatsRecorder.
+//!
 //! Preconditions:
 //! - @a narrow_band is not empty.
-template <typename T, std::size_t N, typename E>
+template <
+  typename T,
+  typename E,
+  typename B,
+  typename G,
+  typename V,
+  typename S,
+  typename R>
 void MarchNarrowBand(
   E const& eikonal_solver,
-  NarrowBandStore<T, N>* const narrow_band,
-  Grid<T, N>* const time_grid)
+  B* const narrow_band,
+  G* const time_grid,
+  T const max_time,
+  V& frozen_cell_visitor,
+  S const& stop_predicate,
+  R& stats_recorder)
 {
   using namespace std;
 
@@ -1466,813 +2206,5715 @@ void MarchNarrowBand(
   assert(!narrow_band->empty() && "Precondition");
 
   while (!narrow_band->empty()) {
-    // Take smallest time from the narrow band and freeze it, i.e.
-    // write it to the time grid.
-    auto const narrow_band_cell = narrow_band->Pop();
-    auto const time = narrow_band_cell.first;
-    auto const index = narrow_band_cell.second;
-
-    assert(Inside(index, time_grid->size()));
-    auto& time_cell = time_grid->Cell(index);
-
-    // Since we allow multiple values for the same cell index in the
-    // narrow band it could happen that this grid cell has already been
-    // frozen. In that case just ignore subsequent values from the narrow
-    // band for that grid cell and move on.
-    if (!Frozen(time_cell)) {
-      time_cell = time;
-      assert(Frozen(time_cell));
+    if (narrow_band->Top().first > max_time) {
+      // All remaining times in the narrow band are larger than the
+      // maximum time, since the smallest one is.
+      break;
+    }
 
-      // Update distances for non-frozen face-neighbors of the newly
-      // frozen cell.
-      UpdateNeighbors(index, eikonal_solver, time_grid, narrow_band);
+    if (FreezeNarrowBandCell(
+          eikonal_solver,
+          narrow_band,
+          time_grid,
+          frozen_cell_visitor,
+          stats_recorder) &&
+        stop_predicate()) {
+      break;
     }
   }
 }
 
 
-//! DOCS
-//!
-//!
-//! Throws std::invalid_argument if:
-//! - Not the same number of @a indices and @a distances, or
-//! - @a indices (and @a distances) are empty, or
-//! - Any index is outside the @a distance_grid, or
-//! - Any duplicate in @a indices, or
-//! - Any value in @a distances does not pass the @a distance_predicate test.
-template<typename T, std::size_t N, typename EikonalSolverType, typename P>
-std::vector<T> ArrivalTime(
-  std::array<std::size_t, N> const& grid_size,
-  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
-  std::vector<T> const& boundary_times,
-  EikonalSolverType const& eikonal_solver,
-  P const boundary_time_predicate,
-  bool const negative_inside)
+//! Same as above, without stats.
+template <
+  typename T,
+  typename E,
+  typename B,
+  typename G,
+  typename V,
+  typename S>
+void MarchNarrowBand(
+  E const& eikonal_solver,
+  B* const narrow_band,
+  G* const time_grid,
+  T const max_time,
+  V& frozen_cell_visitor,
+  S const& stop_predicate)
 {
-  using namespace std;
+  auto stats_recorder = NullArrivalTimeStatsRecorder();
+  MarchNarrowBand(
+    eikonal_solver,
+    narrow_band,
+    time_grid,
+    max_time,
+    frozen_cell_visitor,
+    stop_predicate,
+    stats_recorder);
+}
 
-  typedef T TimeType;
 
-  static_assert(N >= 2, "dimensions must be >= 2");
-  static_assert(N == EikonalSolverType::kDimension,
-                "mismatching eikonal solver dimension");
+//! Same as above, without a stop predicate.
+template <typename T, typename E, typename B, typename G, typename V>
+void MarchNarrowBand(
+  E const& eikonal_solver,
+  B* const narrow_band,
+  G* const time_grid,
+  T const max_time,
+  V& frozen_cell_visitor)
+{
+  MarchNarrowBand(
+    eikonal_solver,
+    narrow_band,
+    time_grid,
+    max_time,
+    frozen_cell_visitor,
+    []() { return false; });
+}
 
-  // Check input.
-  ThrowIfZeroElementInSize(grid_size);
-  ThrowIfEmptyBoundaryIndices(boundary_indices);
-  ThrowIfFullGridBoundaryIndices(boundary_indices, grid_size);
-  ThrowIfBoundaryIndicesTimesSizeMismatch(boundary_indices, boundary_times);
-  for_each(
-    begin(boundary_indices),
-    end(boundary_indices),
-    [=](auto const& boundary_index) {
-      ThrowIfBoundaryIndexOutsideGrid(boundary_index, grid_size);
-  });
-  for_each(
-    begin(boundary_times),
-    end(boundary_times),
-    [=](auto const& boundary_time) {
-      ThrowIfInvalidBoundaryTime(
-        boundary_time_predicate(boundary_time),
-        boundary_time);
-    });
-
-  auto narrow_band_indices = OutsideInsideNarrowBandIndices(
-    boundary_indices,
-    grid_size);
-  auto const& outside_narrow_band_indices = narrow_band_indices.first;
-  auto const& inside_narrow_band_indices = narrow_band_indices.second;
-
-  auto time_buffer = vector<TimeType>(
-    LinearSize(grid_size), numeric_limits<TimeType>::max());
-  assert(none_of(begin(time_buffer), end(time_buffer),
-                 [](TimeType const t) { return Frozen(t); }));
-  auto time_grid = Grid<TimeType, N>(grid_size, time_buffer);
 
-  if (!inside_narrow_band_indices.empty()) {
-    // Set boundaries for marching inside. Always check for duplicate indices.
-    auto const check_duplicate_indices = true;
-    SetBoundaryCondition(
-      boundary_indices,
-      boundary_times,
-      TimeType{-1}, // Multiplier, negate boundary times for inside.
-      check_duplicate_indices,
-      &time_grid);
+//! Set @a far_time for all non-frozen cells in @a time_grid that have a
+//! face-connected path of non-frozen cells to at least one of the cells
+//! remaining in @a narrow_band. This is used to fill in the cells that
+//! were not reached when marching stopped at a maximum time. The
+//! @a frozen_cell_visitor is called for every filled cell. The narrow band
+//! is empty when this function returns.
+//!
+//! Preconditions:
+//! - @a far_time is frozen.
+template <typename T, std::size_t N, typename V>
+void FillNonFrozenCells(
+  T const far_time,
+  NarrowBandStore<T, N>* const narrow_band,
+  Grid<T, N>* const time_grid,
+  V& frozen_cell_visitor)
+{
+  using namespace std;
 
-    // Initialize inside narrow band with negated boundary times.
-    auto inside_narrow_band = InitializedNarrowBand(
-      inside_narrow_band_indices,
-      time_grid,
-      eikonal_solver);
-    MarchNarrowBand(eikonal_solver, inside_narrow_band.get(), &time_grid);
+  assert(time_grid != nullptr);
+  assert(narrow_band != nullptr);
+  assert(Frozen(far_time) && "Precondition");
 
-    if (negative_inside) {
-      // Negate all the inside times. Essentially, negate everything
-      // computed so far. Note that this also affects the boundary cells.
-      for_each(
-        begin(time_buffer),
-        end(time_buffer),
-        [](auto& t) { t = Frozen(t) ? t * TimeType{-1} : t; });
+  auto fill_indices = vector<array<int32_t, N>>();
+  while (!narrow_band->empty()) {
+    auto const narrow_band_index = narrow_band->Pop().second;
+    assert(Inside(narrow_band_index, time_grid->size()));
+    auto& narrow_band_cell = time_grid->Cell(narrow_band_index);
+    if (!Frozen(narrow_band_cell)) {
+      narrow_band_cell = far_time;
+      frozen_cell_visitor(narrow_band_index, far_time);
+      fill_indices.push_back(narrow_band_index);
     }
-  }
-
-  if (!outside_narrow_band_indices.empty()) {
-    // Set boundaries for marching outside. Only check for duplicate indices
-    // if this was not done already, i.e. if we marched an inside narrow band.
-    auto const check_duplicate_indices = inside_narrow_band_indices.empty();
-    SetBoundaryCondition(
-      boundary_indices,
-      boundary_times,
-      TimeType{1}, // Multiplier, original boundary distances for outside.
-      check_duplicate_indices,
-      &time_grid);
 
-    // Initialize outside narrow band with original boundary times.
-    auto outside_narrow_band = InitializedNarrowBand(
-      outside_narrow_band_indices,
-      time_grid,
-      eikonal_solver);
-    MarchNarrowBand(eikonal_solver, outside_narrow_band.get(), &time_grid);
+    // Flood-fill non-frozen cells.
+    while (!fill_indices.empty()) {
+      auto const fill_index = fill_indices.back();
+      fill_indices.pop_back();
+      for (auto i = size_t{0}; i < N; ++i) {
+        for (auto const neighbor_offset : {int32_t{-1}, int32_t{1}}) {
+          auto neighbor_index = fill_index;
+          neighbor_index[i] += neighbor_offset;
+          if (Inside(neighbor_index, time_grid->size())) {
+            auto& neighbor_cell = time_grid->Cell(neighbor_index);
+            if (!Frozen(neighbor_cell)) {
+              neighbor_cell = far_time;
+              frozen_cell_visitor(neighbor_index, far_time);
+              fill_indices.push_back(neighbor_index);
+            }
+          }
+        }
+      }
+    }
   }
-
-  assert(all_of(begin(time_buffer), end(time_buffer),
-                [](TimeType const t) { return Frozen(t); }));
-
-  return time_buffer;
 }
 
 
-//! Polynomial coefficients are equivalent to array index,
-//! i.e. Sum(q[i] * x^i) = 0, for i in [0, 2], or simpler
-//! q[0] + q[1] * x + q[2] * x^2 = 0.
+//! Returns the arrival time at @a index computed by @a eikonal_solver, as if
+//! the cells in @a time_grid with times larger than @a time were not yet
+//! frozen. This is the arrival time that would have been estimated for the
+//! cell at @a index when marching in order of arrival time, at the point
+//! when @a time was the smallest time in the narrow band. The cell at
+//! @a index itself is also treated as not frozen.
 //!
-//! Returns the largest real root, if any (otherwise a NaN value).
-//! Note that we are not checking for errors here.
-template<typename T>
-T SolveEikonalQuadratic(std::array<T, 3> const& q)
+//! The face-neighbors of @a index are temporarily modified in
+//! @a time_grid, but are restored before this function returns.
+//!
+//! Preconditions:
+//! - @a index is inside @a time_grid.
+//! - At least one face-neighbor of @a index is frozen with a time less
+//!   than or equal to @a time.
+template <typename T, std::size_t N, typename E>
+T MaskedSolve(
+  E const& eikonal_solver,
+  std::array<std::int32_t, N> const& index,
+  T const time,
+  Grid<T, N>* const time_grid)
 {
   using namespace std;
 
-  static_assert(is_floating_point<T>::value,
-                "quadratic coefficients must be floating point");
+  assert(time_grid != nullptr);
+  assert(Inside(index, time_grid->size()) && "Precondition");
 
-  // No error-checking here, caller handles bad values.
-  auto const discriminant = q[1] * q[1] - T{4} * q[2] * q[0];
-  auto const pos_root = (-q[1] + sqrt(discriminant)) / (T{2} * q[2]);
-  return pos_root;
+  // Hide the cell itself and face-neighbors with larger times.
+  auto masked_cells = array<pair<T, array<int32_t, N>>, 2 * N + 1>();
+  auto masked_cell_count = size_t{0};
+  masked_cells[masked_cell_count++] = {time_grid->Cell(index), index};
+  time_grid->Cell(index) = numeric_limits<T>::max();
+  for (auto i = size_t{0}; i < N; ++i) {
+    for (auto const neighbor_offset : {int32_t{-1}, int32_t{1}}) {
+      auto neighbor_index = index;
+      neighbor_index[i] += neighbor_offset;
+      if (Inside(neighbor_index, time_grid->size())) {
+        auto& neighbor_cell = time_grid->Cell(neighbor_index);
+        if (neighbor_cell > time && Frozen(neighbor_cell)) {
+          masked_cells[masked_cell_count++] = {neighbor_cell, neighbor_index};
+          neighbor_cell = numeric_limits<T>::max();
+        }
+      }
+    }
+  }
+
+  auto const masked_time = eikonal_solver.Solve(index, *time_grid);
+
+  for (auto i = size_t{0}; i < masked_cell_count; ++i) {
+    time_grid->Cell(masked_cells[i].second) = masked_cells[i].first;
+  }
+  return masked_time;
 }
 
 
-//! Solve the eikonal equation to get the arrival time (which is distance when
-//! @a speed is one) at @a index.
+//! Resets the cells in @a time_grid whose arrival times may depend on the
+//! given @a seeds, which are (time, index) pairs where time is the arrival
+//! time of the seed cell before it changed. A cell is considered to depend
+//! on a face-neighbor if the neighbor has a smaller time and is the
+//! smallest of the two neighbors in that dimension, i.e. if the neighbor
+//! would be used as upwind neighbor by an eikonal solver. Cells for which
+//! @a is_boundary(index) returns true are never reset.
 //!
-//! The returned value is guaranteed to be positive.
-//!
-//! Preconditions:
-//! - @a speed must be greater than zero.
-//! - All elements of @a grid_spacing must be greater than zero.
-//! - @a index is inside @a distance_grid.
-//! - The cell at @a index must not be frozen in @a distance_grid.
-//! - There must be at least one cell in @a distance_grid that is a
-//!   frozen face-neighbor of @a index.
-//! - Cells in @a distance_grid that are not frozen must have the value
-//!   numeric_limits<T>::max().
-template<typename T, std::size_t N>
-T SolveEikonal(
-  std::array<std::int32_t, N> const& index,
-  Grid<T, N> const& distance_grid,
-  T const speed,
-  std::array<T, N> const& grid_spacing)
+//! Reset cells are set to numeric_limits<T>::max(). Returns the indices of
+//! the reset cells, including seed cells that were reset by the caller.
+template <typename T, std::size_t N, typename B>
+std::vector<std::array<std::int32_t, N>> InvalidateDownstreamCells(
+  std::vector<std::pair<T, std::array<std::int32_t, N>>> const& seeds,
+  B const& is_boundary,
+  Grid<T, N>* const time_grid)
 {
   using namespace std;
 
-  static_assert(std::is_floating_point<T>::value,
-                "scalar type must be floating point");
+  assert(time_grid != nullptr);
 
-  assert(ValidSpeed(speed) && "Precondition");
-  assert(ValidGridSpacing(grid_spacing) && "Precondition");
-  assert(Inside(index, distance_grid.size()) && "Precondition");
-  assert(!Frozen(distance_grid.Cell(index)) && "Precondition");
+  auto invalidated_indices = vector<array<int32_t, N>>();
+  auto invalidated_cells = seeds;
+  for (auto const& seed : seeds) {
+    assert(Inside(seed.second, time_grid->size()));
+    if (!Frozen(time_grid->Cell(seed.second))) {
+      invalidated_indices.push_back(seed.second);
+    }
+  }
 
-  // Find the smallest frozen neighbor (if any) in each dimension.
-  auto frozen_neighbor_distances = array<pair<T, size_t>, N>();
-  auto frozen_neighbor_distances_count = size_t{0};
-  for (auto i = size_t{0}; i < N; ++i) {
-    auto neighbor_min_distance = numeric_limits<T>::max();
-    assert(!Frozen(neighbor_min_distance));
+  while (!invalidated_cells.empty()) {
+    auto const invalidated_cell = invalidated_cells.back();
+    invalidated_cells.pop_back();
+    auto const time = invalidated_cell.first;
+    auto const index = invalidated_cell.second;
 
-    // Find the smallest face neighbor for this dimension.
-    auto neighbor_index = index;
+    for (auto i = size_t{0}; i < N; ++i) {
+      for (auto const neighbor_offset : {int32_t{-1}, int32_t{1}}) {
+        auto neighbor_index = index;
+        neighbor_index[i] += neighbor_offset;
+        if (!Inside(neighbor_index, time_grid->size()) ||
+            is_boundary(neighbor_index)) {
+          continue;
+        }
 
-    // -1
-    neighbor_index[i] -= int32_t{1};
-    if (Inside(neighbor_index, distance_grid.size())) {
-      // Note that if the neighbor is not frozen it will have the default
-      // distance numeric_limits<T>::max().
-      auto const neighbor_distance = distance_grid.Cell(neighbor_index);
-      if (neighbor_distance < neighbor_min_distance) {
-        neighbor_min_distance = neighbor_distance;
-        assert(Frozen(neighbor_min_distance));
-      }
-    }
+        auto& neighbor_cell = time_grid->Cell(neighbor_index);
+        if (!Frozen(neighbor_cell) || !(neighbor_cell > time)) {
+          continue;
+        }
 
-    // +1
-    neighbor_index[i] += int32_t{2}; // -1 + 2 = 1
-    if (Inside(neighbor_index, distance_grid.size())) {
-      // Note that if the neighbor is not frozen it will have the default
-      // distance numeric_limits<T>::max().
-      auto const neighbor_distance = distance_grid.Cell(neighbor_index);
-      if (neighbor_distance < neighbor_min_distance) {
-        neighbor_min_distance = neighbor_distance;
-        assert(Frozen(neighbor_min_distance));
-      }
-    }
+        // Check that the invalidated cell is the smaller one of the two
+        // neighbors of the neighbor in this dimension. Note that neighbors
+        // that have already been reset count as larger.
+        auto other_index = neighbor_index;
+        other_index[i] += neighbor_offset;
+        if (Inside(other_index, time_grid->size()) &&
+            time_grid->Cell(other_index) < time) {
+          continue;
+        }
 
-    // If no frozen neighbor was found that dimension does not contribute
-    // to the arrival time.
-    if (neighbor_min_distance < numeric_limits<T>::max()) {
-      frozen_neighbor_distances[frozen_neighbor_distances_count++] =
-        {neighbor_min_distance, i};
+        invalidated_cells.push_back({neighbor_cell, neighbor_index});
+        invalidated_indices.push_back(neighbor_index);
+        neighbor_cell = numeric_limits<T>::max();
+      }
     }
   }
-  assert(frozen_neighbor_distances_count > size_t{0} && "Precondition");
 
-  auto arrival_time = numeric_limits<T>::quiet_NaN();
-  if (frozen_neighbor_distances_count == 1) {
-    // If frozen neighbor in only one dimension we don't need to solve a
-    // quadratic.
-    auto const distance = frozen_neighbor_distances[0].first;
-    auto const j = frozen_neighbor_distances[0].second;
-    arrival_time = distance + grid_spacing[j] / speed;
-  }
-  else {
-    // Initialize quadratic coefficients.
-    auto q = array<T, 3>{{T{-1} / Squared(speed), T{0}, T{0}}};
-    auto const inverse_squared_grid_spacing = InverseSquared(grid_spacing);
-    for (auto i = size_t{0}; i < frozen_neighbor_distances_count; ++i) {
-      auto const distance = frozen_neighbor_distances[i].first;
-      auto const j = frozen_neighbor_distances[i].second;
-      auto const alpha = inverse_squared_grid_spacing[j];
-      q[0] += Squared(distance) * alpha;
-      q[1] += T{-2} * distance * alpha;
-      q[2] += alpha;
+  return invalidated_indices;
+}
+
+
+//! Push the frozen face-neighbors of the cells at @a invalidated_indices
+//! to the @a narrow_band, using their current times in @a time_grid. These
+//! cells are the boundary of the invalidated region, and will propagate
+//! their times into that region when popped from the narrow band.
+template <typename T, std::size_t N>
+void PushInvalidatedRegionBoundary(
+  std::vector<std::array<std::int32_t, N>> const& invalidated_indices,
+  Grid<T, N> const& time_grid,
+  NarrowBandStore<T, N>* const narrow_band)
+{
+  using namespace std;
+
+  assert(narrow_band != nullptr);
+
+  auto const face_neighbor_offsets = FaceNeighborOffsets<N>();
+  auto const strides = GridStrides(time_grid.size());
+  auto pushed_indices = unordered_set<size_t>();
+  for (auto const& invalidated_index : invalidated_indices) {
+    for (auto const& face_neighbor_offset : face_neighbor_offsets) {
+      auto neighbor_index = invalidated_index;
+      for (auto i = size_t{0}; i < N; ++i) {
+        neighbor_index[i] += face_neighbor_offset[i];
+      }
+
+      if (Inside(neighbor_index, time_grid.size())) {
+        auto const neighbor_time = time_grid.Cell(neighbor_index);
+        if (Frozen(neighbor_time) &&
+            pushed_indices.insert(
+              GridLinearIndex(neighbor_index, strides)).second) {
+          narrow_band->Push({neighbor_time, neighbor_index});
+        }
+      }
     }
-    arrival_time = SolveEikonalQuadratic(q);
   }
-
-  ThrowIfInvalidArrivalTime(arrival_time, index);
-  return arrival_time;
 }
 
 
-//! Solve the eikonal equation to get the arrival time (which is distance when
-//! @a speed is one) at @a index. Uses second order derivatives where possible,
-//! this version is slower but more accurate. However, it is important to
-//! have good boundary conditions that allow second order derivatives to be
-//! used early when marching. Otherwise early errors will be propagated.
-//!
-//! The returned value is guaranteed to be positive.
+//! Push the frozen face-neighbors of @a index with times in the open
+//! interval (@a min_time, @a max_time) to the @a narrow_band, using their
+//! current times in @a time_grid.
 //!
-//! Preconditions:
-//! - @a speed must be greater than zero.
-//! - All elements of @a grid_spacing must be greater than zero.
-//! - @a index is inside @a distance_grid.
-//! - The cell at @a index must not be frozen in @a distance_grid.
-//! - There must be at least one cell in @a distance_grid that is a
-//!   frozen face-neighbor of @a index.
-//! - Cells in @a distance_grid that are not frozen must have the value
-//!   numeric_limits<T>::max().
-template<typename T, std::size_t N>
-T HighAccuracySolveEikonal(
+//! When a cell gets a new time estimate @a max_time while processing a
+//! cell with time @a min_time, neighbors with times in between are not yet
+//! used by the estimate. When marching the whole grid those neighbors
+//! would be frozen before the cell, each time improving its estimate. If
+//! the times of those neighbors do not change they are not otherwise
+//! processed when re-marching, so they are pushed here to play the same
+//! role.
+template <typename T, std::size_t N>
+void PushUnchangedUpwindNeighbors(
   std::array<std::int32_t, N> const& index,
-  Grid<T, N> const& distance_grid,
-  T const speed,
-  std::array<T, N> const& grid_spacing)
+  T const min_time,
+  T const max_time,
+  Grid<T, N> const& time_grid,
+  NarrowBandStore<T, N>* const narrow_band)
 {
   using namespace std;
 
-  static_assert(std::is_floating_point<T>::value,
-                "scalar type must be floating point");
-
-  assert(ValidSpeed(speed) && "Precondition");
-  assert(ValidGridSpacing(grid_spacing) && "Precondition");
-  assert(Inside(index, distance_grid.size()) && "Precondition");
-  assert(!Frozen(distance_grid.Cell(index)) && "Precondition");
+  assert(narrow_band != nullptr);
 
-  // Find the smallest frozen neighbor(s) (if any) in each dimension.
-  auto const neighbor_offsets = array<int32_t, 2>{{-1, 1}};
-  auto frozen_neighbor_distances = array<pair<pair<T, T>, size_t>, N>();
-  auto frozen_neighbor_distances_count = size_t{0};
   for (auto i = size_t{0}; i < N; ++i) {
-    auto neighbor_min_distance = numeric_limits<T>::max();
-    auto neighbor_min_distance2 = numeric_limits<T>::max();
-    assert(!Frozen(neighbor_min_distance));
-    assert(!Frozen(neighbor_min_distance2));
-
-    // Check neighbors in both directions for this dimenion.
-    for (auto const neighbor_offset : neighbor_offsets) {
+    for (auto const neighbor_offset : {int32_t{-1}, int32_t{1}}) {
       auto neighbor_index = index;
       neighbor_index[i] += neighbor_offset;
-      if (Inside(neighbor_index, distance_grid.size())) {
-        auto const neighbor_distance = distance_grid.Cell(neighbor_index);
-        if (neighbor_distance < neighbor_min_distance) {
-          // Neighbor one step away is frozen.
-          assert(Frozen(neighbor_distance));
-          neighbor_min_distance = neighbor_distance;
-
-          // Check if neighbor two steps away is frozen and has smaller
-          // (or equal) distance than neighbor one step away. Reset
-          // the distance first since otherwise we might get the secondary
-          // distance from the previous neighbor offset.
-          neighbor_min_distance2 = numeric_limits<T>::max();
-          auto neighbor_index2 = neighbor_index;
-          neighbor_index2[i] += neighbor_offset;
-          if (Inside(neighbor_index2, distance_grid.size())) {
-            auto const neighbor_distance2 = distance_grid.Cell(neighbor_index2);
-            if (neighbor_distance2 <= neighbor_distance) {
-              // Neighbor index two steps away is frozen.
-              assert(Frozen(neighbor_distance2));
-              neighbor_min_distance2 = neighbor_distance2;
-            }
-          }
+      if (Inside(neighbor_index, time_grid.size())) {
+        auto const neighbor_time = time_grid.Cell(neighbor_index);
+        if (min_time < neighbor_time && neighbor_time < max_time) {
+          assert(Frozen(neighbor_time));
+          narrow_band->Push({neighbor_time, neighbor_index});
         }
       }
     }
-
-    if (neighbor_min_distance2 < numeric_limits<T>::max()) {
-      // Two frozen neighbors in this dimension.
-      assert(neighbor_min_distance < numeric_limits<T>::max());
-      frozen_neighbor_distances[frozen_neighbor_distances_count++] =
-        {{neighbor_min_distance, neighbor_min_distance2}, i};
-    }
-    else if (neighbor_min_distance < numeric_limits<T>::max()) {
-      // One frozen neighbor in this dimension.
-      frozen_neighbor_distances[frozen_neighbor_distances_count++] =
-        {{neighbor_min_distance, numeric_limits<T>::max()}, i};
-    }
-    // else: no frozen neighbors in this dimension.
   }
-  assert(frozen_neighbor_distances_count > size_t{0} && "Precondition");
+}
 
-  auto q = array<T, 3>{ {T{ -1 } / Squared(speed), T{ 0 }, T{ 0 }}}; // TMP!!
 
-  auto arrival_time = numeric_limits<T>::quiet_NaN();
-  if (frozen_neighbor_distances_count == 1) {
-    // If frozen neighbor in only one dimension we don't need to solve a
-    // quadratic.
-    auto const distance = frozen_neighbor_distances[0].first.first;
-    auto const j = frozen_neighbor_distances[0].second;
-    arrival_time = distance + grid_spacing[j] / speed;
-  }
-  else {
-    // Initialize quadratic coefficients.
-    //auto q = array<T, 3>{{T{-1} / Squared(speed), T{0}, T{0}}};
-    auto const inverse_squared_grid_spacing = InverseSquared(grid_spacing);
+//! Re-march arrival times in @a time_grid after some of them have changed.
+//! The @a narrow_band contains (time, index) pairs for cells whose times
+//! have been lowered, or whose times need to be propagated to neighbors,
+//! e.g. cells next to a region that has been reset.
+//!
+//! Cells are processed in order of arrival time. When a cell is processed
+//! its non-boundary face-neighbors with larger times are solved with
+//! MaskedSolve, i.e. using only neighbor times up to the time of the
+//! processed cell, exactly as when marching the whole grid. Neighbors are
+//! pushed to the narrow band only if this gives a strictly smaller time
+//! than the current one, so that marching stops where the new times agree
+//! with the old ones. Each cell is processed at most once per time.
+//! Cells for which @a is_boundary(index) returns true are never modified.
+template <typename T, std::size_t N, typename E, typename B>
+void ReMarchNarrowBand(
+  E const& eikonal_solver,
+  NarrowBandStore<T, N>* const narrow_band,
+  Grid<T, N>* const time_grid,
+  B const& is_boundary)
+{
+  using namespace std;
 
-    for (auto i = size_t{0}; i < frozen_neighbor_distances_count; ++i) {
-      auto const distance = frozen_neighbor_distances[i].first.first;
-      auto const distance2 = frozen_neighbor_distances[i].first.second;
-      auto const j = frozen_neighbor_distances[i].second;
-      if (distance2 < numeric_limits<T>::max()) {
-        // Second order coefficients.
-        assert(distance < numeric_limits<T>::max());
-        auto const alpha = (T{9} / T{4}) * inverse_squared_grid_spacing[j];
-        auto const t = (T{1} / T{3}) * (T{4} * distance - distance2);
-        q[0] += Squared(t) * alpha;
-        q[1] += T{-2} * t * alpha;
-        q[2] += alpha;
-      }
-      else if (distance < numeric_limits<T>::max()) {
-        // First order coefficients.
-        auto const alpha = inverse_squared_grid_spacing[j];
-        q[0] += Squared(distance) * alpha;
-        q[1] += T{-2} * distance * alpha;
-        q[2] += alpha;
-      }
-    }
-    arrival_time = SolveEikonalQuadratic(q);
-  }
+  assert(time_grid != nullptr);
+  assert(narrow_band != nullptr);
+
+  auto const strides = GridStrides(time_grid->size());
+  auto processed = unordered_set<size_t>();
+
+  while (!narrow_band->empty()) {
+    auto const narrow_band_cell = narrow_band->Pop();
+    auto const time = narrow_band_cell.first;
+    auto const index = narrow_band_cell.second;
 
-  //ThrowIfInvalidArrivalTime(arrival_time, index);
-  if (!(arrival_time >= T{ 0 })) {
-    auto const cell_distance = distance_grid.Cell(index);
-    for (auto i = size_t{ 0 }; i < frozen_neighbor_distances_count; ++i) {
-      cerr << "[" << i << "]:" << cell_distance << " | " << frozen_neighbor_distances[i].first.first << ", " << frozen_neighbor_distances[i].first.second << endl;
+    assert(Inside(index, time_grid->size()));
+    auto& time_cell = time_grid->Cell(index);
+    auto const linear_index = GridLinearIndex(index, strides);
+    if (time > time_cell ||
+        (time == time_cell && processed.count(linear_index) != 0)) {
+      // Cell time has already been lowered further, or this is a
+      // duplicate of a cell that has already been processed.
+      continue;
     }
-    cerr << "q: " << ToString(q) << endl;
-    cerr << "discr: " << q[1] * q[1] - T{ 4 } *q[2] * q[0] << endl;
-    cerr << "int64: " << int64_t{ -800046 } *int64_t{ -800046 } -int64_t{ 4 } *int64_t{ 1179650 } *int64_t{ 135649 } << endl;
+    time_cell = time;
+    processed.insert(linear_index);
 
-    //auto ss = stringstream();
-    cerr << "invalid arrival time (distance) " << arrival_time << " at index " << ToString(index) << endl;
-    std::abort();
-    //throw runtime_error(ss.str());
+    for (auto i = size_t{0}; i < N; ++i) {
+      for (auto const neighbor_offset : {int32_t{-1}, int32_t{1}}) {
+        auto neighbor_index = index;
+        neighbor_index[i] += neighbor_offset;
+        // Neighbors with times less than or equal to the time of the
+        // processed cell would already have been frozen at this point.
+        if (Inside(neighbor_index, time_grid->size()) &&
+            !is_boundary(neighbor_index) &&
+            time_grid->Cell(neighbor_index) > time) {
+          auto const neighbor_time =
+            MaskedSolve(eikonal_solver, neighbor_index, time, time_grid);
+          // Even if the neighbor time did not improve, unchanged
+          // neighbors with times in between may still improve it when
+          // combined with the time of the processed cell.
+          PushUnchangedUpwindNeighbors(
+            neighbor_index,
+            time,
+            min(neighbor_time, time_grid->Cell(neighbor_index)),
+            *time_grid,
+            narrow_band);
+          if (neighbor_time < time_grid->Cell(neighbor_index)) {
+            narrow_band->Push({neighbor_time, neighbor_index});
+          }
+        }
+      }
+    }
   }
-  return arrival_time;
 }
 
 
+//! Returns the linear indices of @a boundary_indices in a grid of size
+//! @a grid_size.
 //!
-//!
-//! Implementation follows pseudo-code given in "Fluid Simulation for
-//! Computer Graphics" by Robert Bridson.
+//! Throws std::invalid_argument if there are duplicates in
+//! @a boundary_indices.
 //!
 //! Preconditions:
-//! - @a dx must be greater than zero.
-//! - @a index is inside @a distance_grid.
-//! - The cell at @a index must not be frozen in @a distance_grid.
-//! - There must be at least one cell in @a distance_grid that is a
-//!   frozen face-neighbor of @a index.
-//! - Cells in @a distance_grid that are not frozen must have the value
-//!   numeric_limits<T>::max().
-//!
-//! Note: Currently supports only uniformly spaced (square) cells.
-//! Note: Currently supports only 1D, 2D, and 3D.
-template<typename T, std::size_t N>
-T SolveDistance(
-    std::array<std::int32_t, N> const& index,
-    Grid<T, N> const& distance_grid,
-    T const dx)
+//! - @a boundary_indices are inside @a grid_size.
+template<std::size_t N>
+std::unordered_set<std::size_t> BoundaryLinearIndices(
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::array<std::size_t, N> const& grid_size)
 {
   using namespace std;
 
-  static_assert(1 <= N && N <= 3, "invalid dimensionality");
+  auto const strides = GridStrides(grid_size);
+  auto boundary_linear_indices = unordered_set<size_t>();
+  for (auto const& boundary_index : boundary_indices) {
+    assert(Inside(boundary_index, grid_size) && "Precondition");
+    ThrowIfDuplicateBoundaryIndex(
+      !boundary_linear_indices.insert(
+        GridLinearIndex(boundary_index, strides)).second,
+      boundary_index);
+  }
+  return boundary_linear_indices;
+}
 
-  assert(Inside(index, distance_grid.size()) && "Precondition");
-  assert(!Frozen(distance_grid.Cell(index)) && "Precondition");
 
-  auto phi = array<T, N>();
-  fill(begin(phi), end(phi), numeric_limits<T>::max());
-  auto phi_count = size_t{0};
+//! Reset the cells downstream of @a raised_seeds in @a time_grid and
+//! re-march arrival times for them, together with the lowered times
+//! already in the @a narrow_band. See InvalidateDownstreamCells and
+//! ReMarchNarrowBand.
+template <typename T, std::size_t N, typename E, typename B>
+void UpdateArrivalTimes(
+  E const& eikonal_solver,
+  std::vector<std::pair<T, std::array<std::int32_t, N>>> const& raised_seeds,
+  B const& is_boundary,
+  NarrowBandStore<T, N>* const narrow_band,
+  Grid<T, N>* const time_grid)
+{
+  assert(time_grid != nullptr);
+  assert(narrow_band != nullptr);
 
-  // Find the smallest frozen neighbor(s) (if any) in each dimension.
-  for (auto i = size_t{0}; i < N; ++i) {
-    auto neighbor_min_distance = numeric_limits<T>::max();
-    assert(!Frozen(neighbor_min_distance));
+  auto const invalidated_indices = InvalidateDownstreamCells(
+    raised_seeds,
+    is_boundary,
+    time_grid);
+  PushInvalidatedRegionBoundary(
+    invalidated_indices,
+    *time_grid,
+    narrow_band);
+  ReMarchNarrowBand(
+    eikonal_solver,
+    narrow_band,
+    time_grid,
+    is_boundary);
+}
 
-    // -1
-    auto neighbor_index = index;
-    neighbor_index[i] -= 1;
-    if (Inside(neighbor_index, distance_grid.size())) {
-      auto const neighbor_distance = distance_grid.Cell(neighbor_index);
-      if (neighbor_distance < neighbor_min_distance) {
-        neighbor_min_distance = neighbor_distance;
-      }
-    }
 
-    // -1 + 2 = +1
-    neighbor_index[i] += 2;
-    if (Inside(neighbor_index, distance_grid.size())) {
-      auto const neighbor_distance = distance_grid.Cell(neighbor_index);
-      if (neighbor_distance < neighbor_min_distance) {
-        neighbor_min_distance = neighbor_distance;
+//! Returns the indices of the cells in @a phi_grid that are next to a zero
+//! crossing, together with the (unsigned) distance from each of these
+//! cells to the zero level set. Cells where phi is negative are inside,
+//! a zero crossing is where a cell and a face-neighbor are on different
+//! sides. Distances are estimated by linear interpolation of phi along
+//! each dimension with a crossing, and combining the crossings found in
+//! different dimensions as the distance to a plane.
+template<typename T, std::size_t N>
+std::pair<std::vector<std::array<std::int32_t, N>>, std::vector<T>>
+LevelSetBoundaryCells(
+  ConstGrid<T, N> const& phi_grid,
+  std::array<T, N> const& grid_spacing)
+{
+  using namespace std;
+
+  auto boundary_indices = vector<array<int32_t, N>>();
+  auto boundary_times = vector<T>();
+
+  auto const linear_size = LinearSize(phi_grid.size());
+  for (auto linear_index = size_t{0}; linear_index < linear_size;
+       ++linear_index) {
+    auto const index = GridIndex(linear_index, phi_grid.size());
+    auto const phi = phi_grid.Cell(index);
+    auto const inside = phi < T{0};
+
+    auto inverse_squared_distance_sum = T{0};
+    auto crossing = false;
+    for (auto i = size_t{0}; i < N; ++i) {
+      auto min_distance = numeric_limits<T>::max();
+      for (auto const neighbor_offset : {int32_t{-1}, int32_t{1}}) {
+        auto neighbor_index = index;
+        neighbor_index[i] += neighbor_offset;
+        if (Inside(neighbor_index, phi_grid.size())) {
+          auto const neighbor_phi = phi_grid.Cell(neighbor_index);
+          if ((neighbor_phi < T{0}) != inside) {
+            // Fraction of the distance to the neighbor where phi is zero.
+            min_distance = min(
+              min_distance,
+              grid_spacing[i] * phi / (phi - neighbor_phi));
+          }
+        }
+      }
+      if (min_distance < numeric_limits<T>::max()) {
+        crossing = true;
+        if (min_distance == T{0}) {
+          inverse_squared_distance_sum = numeric_limits<T>::infinity();
+        }
+        else {
+          inverse_squared_distance_sum +=
+            T{1} / (min_distance * min_distance);
+        }
       }
     }
 
-    if (neighbor_min_distance < numeric_limits<T>::max()) {
-      phi[phi_count++] = neighbor_min_distance;
+    if (crossing) {
+      boundary_indices.push_back(index);
+      boundary_times.push_back(
+        T{1} / sqrt(inverse_squared_distance_sum));
     }
   }
-  assert(phi_count > 0 && "Precondition");
 
-  // Sort ascending using a sorting network approach.
-  if (N >= 2 && phi[0] > phi[1]) { swap(phi[0], phi[1]); }
-  if (N == 3 && phi[1] > phi[2]) { swap(phi[1], phi[2]); }
-  if (N == 3 && phi[0] > phi[1]) { swap(phi[0], phi[1]); }
+  return {boundary_indices, boundary_times};
+}
 
-  auto distance = phi[0] + dx;
-  if (N >= 2 && phi_count > 1 && distance > phi[1]) {
-    distance = T(0.5) * (phi[0] + phi[1] +
-      sqrt(T(2) * Squared(dx) - Squared(phi[1] - phi[0])));
-    if (N == 3 && phi_count == 3 && distance > phi[2]) {
-      auto const phi_sum = phi[0] + phi[1] + phi[2];
-      auto phi_sum_squared = Squared(phi[0]) + Squared(phi[1]) + Squared(phi[2]);
-      distance = (T(1) / T(3)) * (phi_sum + sqrt(max(
-        T(0),
-        Squared(phi_sum) - T(3) * (phi_sum_squared - Squared(dx)))));
+
+//! Returns the discrete gradient of the arrival times in @a time_grid for
+//! each cell, using the same upwind differences as the Eikonal solvers. In
+//! each dimension the face-neighbor with the smaller time is used, and the
+//! gradient element is zero if neither face-neighbor has a smaller time.
+//! Gradients are stored in the same layout as the times.
+template<typename T, std::size_t N>
+std::vector<std::array<T, N>> ArrivalTimeGradients(
+  ConstGrid<T, N> const& time_grid,
+  std::array<T, N> const& grid_spacing)
+{
+  using namespace std;
+
+  auto gradients = vector<array<T, N>>(LinearSize(time_grid.size()));
+  for (auto linear_index = size_t{0}; linear_index < gradients.size();
+       ++linear_index) {
+    auto const index = GridIndex(linear_index, time_grid.size());
+    auto const time = time_grid.Cell(index);
+    auto& gradient = gradients[linear_index];
+    for (auto i = size_t{0}; i < N; ++i) {
+      gradient[i] = T{0};
+      auto min_neighbor_time = time;
+      for (auto const neighbor_offset : {int32_t{-1}, int32_t{1}}) {
+        auto neighbor_index = index;
+        neighbor_index[i] += neighbor_offset;
+        if (Inside(neighbor_index, time_grid.size())) {
+          auto const neighbor_time = time_grid.Cell(neighbor_index);
+          if (neighbor_time < min_neighbor_time) {
+            min_neighbor_time = neighbor_time;
+            gradient[i] =
+              neighbor_offset * (neighbor_time - time) / grid_spacing[i];
+          }
+        }
+      }
     }
   }
-
-  // Arrival time is distance here since we have assumed that speed is one.
-  ThrowIfInvalidArrivalTime(distance, index);
-  return distance;
+  return gradients;
 }
 
 
-//! Base class for Eikonal solvers.
-//! Note: dtor is not virtual!
-template <typename T, std::size_t N>
-class EikonalSolverBase
+//! Returns the gradient at @a position, linearly interpolated from the
+//! @a gradients at the surrounding cell centers and normalized. Returns a
+//! zero vector if the interpolated gradient is zero. Cell centers are at
+//! (index[i] + 0.5) * grid_spacing[i], positions outside the cell centers
+//! are clamped.
+template<typename T, std::size_t N>
+std::array<T, N> InterpolatedDirection(
+  std::array<T, N> const& position,
+  std::vector<std::array<T, N>> const& gradients,
+  std::array<std::size_t, N> const& grid_size,
+  std::array<T, N> const& grid_spacing)
 {
-public:
-  typedef T ScalarType;
-  static std::size_t const kDimension = N;
+  using namespace std;
 
-protected:
-  explicit EikonalSolverBase(std::array<T, N> const& grid_spacing)
-    : grid_spacing_(grid_spacing)
-  {
-    ThrowIfInvalidGridSpacing(grid_spacing_);
+  auto const strides = GridStrides(grid_size);
+
+  // Lower corner index and interpolation weights in each dimension.
+  auto corner = array<int32_t, N>();
+  auto alpha = array<T, N>();
+  for (auto i = size_t{0}; i < N; ++i) {
+    auto const x = min(
+      max(position[i] / grid_spacing[i] - T(0.5), T{0}),
+      static_cast<T>(grid_size[i] - 1));
+    corner[i] = min(
+      static_cast<int32_t>(floor(x)),
+      max(static_cast<int32_t>(grid_size[i]) - 2, int32_t{0}));
+    alpha[i] = x - corner[i];
   }
 
-  std::array<T, N> const& grid_spacing() const
-  {
-    return grid_spacing_;
+  auto direction = array<T, N>();
+  fill(begin(direction), end(direction), T{0});
+  for (auto k = size_t{0}; k < (size_t{1} << N); ++k) {
+    auto index = corner;
+    auto weight = T{1};
+    for (auto i = size_t{0}; i < N; ++i) {
+      auto const upper = ((k >> i) & size_t{1}) != 0;
+      index[i] += upper ? 1 : 0;
+      weight *= upper ? alpha[i] : T{1} - alpha[i];
+    }
+    if (weight > T{0} && Inside(index, grid_size)) {
+      auto const& gradient = gradients[GridLinearIndex(index, strides)];
+      for (auto i = size_t{0}; i < N; ++i) {
+        direction[i] += weight * gradient[i];
+      }
+    }
   }
 
-private:
-  std::array<T, N> const grid_spacing_;
-};
+  auto const norm = sqrt(inner_product(
+    begin(direction), end(direction), begin(direction), T{0}));
+  if (norm > T{0}) {
+    for (auto& d : direction) {
+      d /= norm;
+    }
+  }
+  return direction;
+}
 
 
-//! Base class for Eikonal solvers with uniform speed.
-//! Note: dtor is not virtual!
-template <typename T, std::size_t N>
-class UniformSpeedEikonalSolverBase : public EikonalSolverBase<T, N>
+//! Returns a path from @a start_position down the gradient of the arrival
+//! times in @a time_grid to a cell with locally minimal time, typically a
+//! boundary cell. Steps of @a step_length are taken using the midpoint
+//! (second order Runge-Kutta) method, with directions interpolated from
+//! the precomputed @a gradients. The path ends at the center of the cell
+//! with locally minimal time, or after @a max_step_count steps.
+template<typename T, std::size_t N>
+std::vector<std::array<T, N>> TracePath(
+  std::array<T, N> const& start_position,
+  ConstGrid<T, N> const& time_grid,
+  std::vector<std::array<T, N>> const& gradients,
+  std::array<T, N> const& grid_spacing,
+  T const step_length,
+  std::size_t const max_step_count)
 {
-protected:
-  UniformSpeedEikonalSolverBase(
-    std::array<T, N> const& grid_spacing,
-    T const uniform_speed)
-    : EikonalSolverBase<T, N>(grid_spacing)
-    , uniform_speed_(uniform_speed)
-  {
-    ThrowIfZeroOrNegativeOrNanSpeed(uniform_speed_);
-  }
+  using namespace std;
 
-  //! Returns the uniform speed, guaranteed to be:
-  //! - Non-zero
-  //! - Positive
-  //! - Not NaN
-  T uniform_speed() const
-  {
-    return uniform_speed_;
+  auto const grid_size = time_grid.size();
+  auto const clamped = [&](array<T, N> position) {
+    for (auto i = size_t{0}; i < N; ++i) {
+      position[i] = min(
+        max(position[i], T{0}),
+        nextafter(grid_size[i] * grid_spacing[i], T{0}));
+    }
+    return position;
+  };
+  auto const cell_index = [&](array<T, N> const& position) {
+    auto index = array<int32_t, N>();
+    for (auto i = size_t{0}; i < N; ++i) {
+      index[i] = min(
+        static_cast<int32_t>(position[i] / grid_spacing[i]),
+        static_cast<int32_t>(grid_size[i] - 1));
+    }
+    return index;
+  };
+  auto const local_minimum = [&](array<int32_t, N> const& index) {
+    auto const time = time_grid.Cell(index);
+    for (auto i = size_t{0}; i < N; ++i) {
+      for (auto const neighbor_offset : {int32_t{-1}, int32_t{1}}) {
+        auto neighbor_index = index;
+        neighbor_index[i] += neighbor_offset;
+        if (Inside(neighbor_index, grid_size) &&
+            time_grid.Cell(neighbor_index) < time) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+
+  auto path = vector<array<T, N>>();
+  path.push_back(start_position);
+  auto position = start_position;
+  for (auto step = size_t{0}; step < max_step_count; ++step) {
+    auto const index = cell_index(position);
+    if (local_minimum(index)) {
+      auto cell_center = array<T, N>();
+      for (auto i = size_t{0}; i < N; ++i) {
+        cell_center[i] = (index[i] + T(0.5)) * grid_spacing[i];
+      }
+      path.push_back(cell_center);
+      break;
+    }
+
+    auto const direction = InterpolatedDirection(
+      position, gradients, grid_size, grid_spacing);
+    auto midpoint = position;
+    for (auto i = size_t{0}; i < N; ++i) {
+      midpoint[i] -= T(0.5) * step_length * direction[i];
+    }
+    auto const midpoint_direction = InterpolatedDirection(
+      clamped(midpoint), gradients, grid_size, grid_spacing);
+    if (all_of(begin(midpoint_direction), end(midpoint_direction),
+               [](T const d) { return d == T{0}; })) {
+      // Flat region, e.g. cells that were not reached when marching.
+      break;
+    }
+    for (auto i = size_t{0}; i < N; ++i) {
+      position[i] -= step_length * midpoint_direction[i];
+    }
+    position = clamped(position);
+    path.push_back(position);
   }
+  return path;
+}
 
-private:
-  T const uniform_speed_;
-};
 
+//! Calls @a work on @a thread_count threads, including the calling thread,
+//! and returns when all calls have returned. Typically, @a work takes
+//! tasks from a shared atomic counter until there are no tasks left, so
+//! that threads that finish early take on remaining tasks. If any call
+//! throws, the exception is re-thrown after all threads have finished.
+//!
+//! Preconditions:
+//! - @a thread_count is not zero.
+template<typename W>
+void RunOnThreads(std::size_t const thread_count, W const& work)
+{
+  using namespace std;
 
-//! Base class for Eikonal solvers with varying speed.
-//! Note: dtor is not virtual!
-template <typename T, std::size_t N>
-class VaryingSpeedEikonalSolverBase : public EikonalSolverBase<T, N>
-{
-protected:
-  VaryingSpeedEikonalSolverBase(
-    std::array<T, N> const& grid_spacing,
-    std::array<std::size_t, N> const& speed_grid_size,
-    std::vector<T> const& speed_buffer)
-    : EikonalSolverBase(grid_spacing)
-    , speed_grid_(speed_grid_size, speed_buffer)
-  {
-    for (auto const speed : speed_buffer) {
-      ThrowIfZeroOrNegativeOrNanSpeed(speed);
+  assert(thread_count > 0 && "Precondition");
+
+  auto futures = vector<future<void>>();
+  for (auto t = size_t{1}; t < thread_count; ++t) {
+    futures.push_back(async(launch::async, [&work]() { work(); }));
+  }
+  auto exception = exception_ptr();
+  try {
+    work();
+  }
+  catch (...) {
+    exception = current_exception();
+  }
+  for (auto& f : futures) {
+    try {
+      f.get();
+    }
+    catch (...) {
+      if (!exception) {
+        exception = current_exception();
+      }
     }
   }
-
-  //! Returns the speed at @a index in the speed grid, guaranteed to be:
-  //! - Non-zero
-  //! - Positive
-  //! - Not NaN
-  //!
-  //! Throws an std::invalid_argument exception if @a index is outside the
-  //! speed grid.
-  T Speed(std::array<std::int32_t, N> const& index) const
-  {
-    ThrowIfSpeedIndexOutsideGrid(index, speed_grid_.size());
-    return speed_grid_.Cell(index);
+  if (exception) {
+    rethrow_exception(exception);
   }
-
-private:
-  ConstGrid<T, N> const speed_grid_;
-};
-
-} // namespace detail
+}
 
 
-//! Provides methods for solving the eikonal equation for a single grid cell
-//! at a time using the current distance grid. Uses a uniform speed for
-//! the entire grid.
-template<typename T, std::size_t N>
-class UniformSpeedEikonalSolver :
-  public detail::UniformSpeedEikonalSolverBase<T, N>
+//! Marches a single front outward from the cell at @a source_index, which
+//! is given arrival time zero. Marching stops when @a stop_predicate
+//! returns true after a cell has been frozen, or when all cells are
+//! frozen. The @a frozen_cell_visitor is called for the source cell and
+//! for every frozen cell. The @a narrow_band is used as scratch memory.
+//!
+//! Preconditions:
+//! - No cells in @a time_grid are frozen.
+//! - @a source_index is inside @a time_grid.
+//! - @a time_grid has more than one cell.
+template<typename T, std::size_t N, typename E, typename V, typename S>
+void MarchPointSource(
+  std::array<std::int32_t, N> const& source_index,
+  E const& eikonal_solver,
+  NarrowBandStore<T, N>* const narrow_band,
+  Grid<T, N>* const time_grid,
+  V& frozen_cell_visitor,
+  S const& stop_predicate)
 {
-public:
-  explicit UniformSpeedEikonalSolver(
-    std::array<T, N> const& grid_spacing,
-    T const uniform_speed = T{1})
-    : detail::UniformSpeedEikonalSolverBase<T, N>(grid_spacing, uniform_speed)
-  {}
+  using namespace std;
 
-  //! Returns the distance for grid cell at @a index given the current
-  //! distances (@a distance_grid) of other cells.
-  T Solve(
-    std::array<std::int32_t, N> const& index,
-    detail::Grid<T, N> const& distance_grid) const
-  {
-    return detail::SolveEikonal(
-      index,
-      distance_grid,
-      uniform_speed(),
-      grid_spacing());
+  assert(narrow_band != nullptr);
+  assert(time_grid != nullptr);
+  assert(Inside(source_index, time_grid->size()) && "Precondition");
+  assert(!Frozen(time_grid->Cell(source_index)) && "Precondition");
+  assert(LinearSize(time_grid->size()) > 1 && "Precondition");
+
+  time_grid->Cell(source_index) = T{0};
+  frozen_cell_visitor(source_index, T{0});
+  if (stop_predicate()) {
+    return;
   }
-};
 
+  InitializeNarrowBand(
+    FaceNeighborNarrowBandIndices(
+      vector<array<int32_t, N>>(1, source_index),
+      *time_grid),
+    *time_grid,
+    eikonal_solver,
+    narrow_band);
+  MarchNarrowBand(
+    eikonal_solver,
+    narrow_band,
+    time_grid,
+    numeric_limits<T>::max(), // max_time
+    frozen_cell_visitor,
+    stop_predicate);
+}
 
-//! Provides methods for solving the eikonal equation for a single grid cell
-//! at a time using the current distance grid. Uses a uniform speed for
-//! the entire grid. When possible uses second order derivates to achieve
-//! better accuracy.
-template <typename T, std::size_t N>
-class HighAccuracyUniformSpeedEikonalSolver :
-  public detail::UniformSpeedEikonalSolverBase<T, N>
+
+//! Throws std::invalid_argument if:
+//! - @a grid_size has a zero element, or
+//! - Any of the @a source_indices is outside the grid, or
+//! - The grid has only one cell, or
+//! - @a thread_count is zero.
+template<std::size_t N>
+void ThrowIfInvalidSources(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& source_indices,
+  std::size_t const thread_count)
 {
-public:
-  explicit HighAccuracyUniformSpeedEikonalSolver(
-    std::array<T, N> const& grid_spacing,
-    T const uniform_speed = T{1})
-    : detail::UniformSpeedEikonalSolverBase<T, N>(grid_spacing, uniform_speed)
-  {}
+  using namespace std;
 
-  //! Returns the distance for grid cell at @a index given the current
-  //! distances (@a distance_grid) of other cells.
-  T Solve(
-    std::array<std::int32_t, N> const& index,
-    detail::Grid<T, N> const& distance_grid) const
-  {
-    return detail::HighAccuracySolveEikonal(
-      index,
-      distance_grid,
-      uniform_speed(),
-      grid_spacing());
-  }
-};
+  ThrowIfInvalidSize(grid_size);
+  for_each(
+    begin(source_indices),
+    end(source_indices),
+    [&](auto const& source_index) {
+      auto const boundary_indices =
+        vector<array<int32_t, N>>(1, source_index);
+      ThrowIfFullGridBoundaryIndices(boundary_indices, grid_size);
+      ThrowIfBoundaryIndexOutsideGrid(source_index, grid_size);
+    });
+  ThrowIfZeroThreadCount(thread_count);
+}
 
 
-//! Provides methods for solving the eikonal equation for a single grid cell
-//! at a time using the current distance grid. A speed grid must be provided
-//! and that grid must cover the arrival time grid.
-template <typename T, std::size_t N>
-class VaryingSpeedEikonalSolver :
-  public detail::VaryingSpeedEikonalSolverBase<T, N>
+//! Frozen cell visitor that does nothing. Calls are inlined away.
+struct NullFrozenCellVisitor
 {
-public:
-  VaryingSpeedEikonalSolver(
-    std::array<T, N> const& grid_spacing,
-    std::array<std::size_t, N> const& speed_grid_size,
-    std::vector<T> const& speed_buffer)
-    : detail::VaryingSpeedEikonalSolverBase<T, N>(
-        grid_spacing, speed_grid_size, speed_buffer)
+  template<typename I, typename T>
+  void operator()(I const&, T const) const
   {}
-
-  //! Returns the distance for grid cell at @a index given the current
-  //! distances (@a distance_grid) of other cells.
-  T Solve(
-    std::array<std::int32_t, N> const& index,
-    detail::Grid<T, N> const& distance_grid) const
-  {
-    return detail::SolveEikonal(
-      index,
-      distance_grid,
-      Speed(index),
-      grid_spacing());
-  }
 };
 
 
-//! Provides methods for solving the eikonal equation for a single grid cell
-//! at a time using the current distance grid. A speed grid must be provided
-//! and that grid must cover the arrival time grid. When possible uses second
-//! order derivates to achieve better accuracy.
-template <typename T, std::size_t N>
-class HighAccuracyVaryingSpeedEikonalSolver :
-  public detail::VaryingSpeedEikonalSolverBase<T, N>
+//! Value accumulator that ignores the upwind weights passed by the eikonal
+//! solvers, see ValueExtendingEikonalSolver. Calls are inlined away.
+struct NullValueAccumulator
 {
-public:
-  HighAccuracyVaryingSpeedEikonalSolver(
-    std::array<T, N> const& grid_spacing,
-    std::array<std::size_t, N> const& speed_grid_size,
-    std::vector<T> const& speed_buffer)
-    : detail::VaryingSpeedEikonalSolverBase<T, N>(
-        grid_spacing, speed_grid_size, speed_buffer)
+  template<typename I, typename T>
+  void operator()(I const&, T const) const
   {}
-
-  //! Returns the distance for grid cell at @a index given the current
-  //! distances (@a distance_grid) of other cells.
-  T Solve(
-    std::array<std::int32_t, N> const& index,
-    detail::Grid<T, N> const& distance_grid) const
-  {
-    return detail::HighAccuracySolveEikonal(
-      index,
-      distance_grid,
-      Speed(index),
-      grid_spacing());
-  }
 };
 
 
-//! Provides methods for solving the eikonal equation for a single grid cell
-//! at a time using the current distance grid. The speed is assumed to be
-//! one for the entire grid, meaning that arrival time can be interpreted
-//! as distance.
+//! Value is true for eikonal solvers that declare a kStencilReach of one,
+//! i.e. solvers that only read the times of face-neighbors. Solvers that
+//! do not declare a stencil reach, including solvers wrapping other
+//! solvers, may read cells further away and are not face-neighbor solvers.
+template<typename E, typename = void>
+struct FaceNeighborEikonalSolver : std::false_type
+{};
+
+template<typename E>
+struct FaceNeighborEikonalSolver<
+  E,
+  typename std::enable_if<E::kStencilReach == 1>::type>
+  : std::true_type
+{};
+
+
+//! Throws std::invalid_argument if:
+//! - @a grid_size has a zero element, or
+//! - @a boundary_indices is empty, or
+//! - @a boundary_indices cover the whole grid, or
+//! - Not the same number of @a boundary_indices and @a boundary_times, or
+//! - Any boundary index is outside the grid, or
+//! - Any boundary time does not pass the @a boundary_time_predicate test.
 //!
-//! Note: Currently only supports uniform grid spacing.
-template<typename T, std::size_t N>
-class DistanceSolver
+//! Note that duplicate boundary indices are checked when setting boundary
+//! conditions on the time grid.
+template<typename T, std::size_t N, typename P>
+void ThrowIfInvalidBoundaryCondition(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  P const boundary_time_predicate)
+{
+  using namespace std;
+
+  ThrowIfInvalidSize(grid_size);
+  ThrowIfEmptyBoundaryIndices(boundary_indices);
+  ThrowIfFullGridBoundaryIndices(boundary_indices, grid_size);
+  ThrowIfBoundaryIndicesTimesSizeMismatch(boundary_indices, boundary_times);
+  for_each(
+    begin(boundary_indices),
+    end(boundary_indices),
+    [=](auto const& boundary_index) {
+      ThrowIfBoundaryIndexOutsideGrid(boundary_index, grid_size);
+  });
+  for_each(
+    begin(boundary_times),
+    end(boundary_times),
+    [=](auto const& boundary_time) {
+      ThrowIfInvalidBoundaryTime(
+        boundary_time_predicate(boundary_time),
+        boundary_time);
+    });
+}
+
+
+//! Adds the wall clock time between construction and destruction to
+//! @a *phase_time, unless @a phase_time is null.
+class ScopedPhaseTimer
 {
 public:
-  typedef T ScalarType;
-  static std::size_t const kDimension = N;
+  explicit ScopedPhaseTimer(std::chrono::nanoseconds* const phase_time)
+    : phase_time_(phase_time)
+    , start_(phase_time != nullptr ?
+        std::chrono::steady_clock::now() :
+        std::chrono::steady_clock::time_point())
+  {}
 
-  explicit DistanceSolver(T const dx)
-    : dx_(dx)
+  ~ScopedPhaseTimer()
   {
-    detail::ThrowIfInvalidGridSpacing(detail::FilledArray<T, N>(dx_));
-  }
+    using namespace std::chrono;
 
-  //! Returns the distance for grid cell at @a index given the current
-  //! distances (@a distance_grid) of other cells.
-  T Solve(
-    std::array<std::int32_t, N> const& index,
-    detail::Grid<T, N> const& distance_grid) const
-  {
-    return detail::SolveDistance(
-      index,
-      distance_grid,
-      dx_);
+    if (phase_time_ != nullptr) {
+      *phase_time_ += duration_cast<nanoseconds>(steady_clock::now() - start_);
+    }
   }
 
+  ScopedPhaseTimer(ScopedPhaseTimer const&) = delete;
+  ScopedPhaseTimer& operator=(ScopedPhaseTimer const&) = delete;
+
 private:
-  T const dx_;
+  std::chrono::nanoseconds* const phase_time_;
+  std::chrono::steady_clock::time_point const start_;
 };
 
 
-//! Compute the signed distance on a grid.
+//! Writes arrival times for all cells in a grid of size @a grid_size to
+//! @a time_buffer, which holds LinearSize(grid_size) cells. The
+//! @a frozen_cell_visitor is called once for every cell in the grid with the
+//! final (possibly negated) arrival time, as soon as that time is known.
+//! The @a narrow_band is used as scratch memory for marching, so that
+//! repeated calls can re-use its allocated memory. Phase times and counts
+//! are passed to @a stats_recorder, typically a
+//! NullArrivalTimeStatsRecorder or an ArrivalTimeStatsRecorder.
 //!
-//! Input:
-//!   grid_size          - Number of grid cells in each dimension.
-//!   boundary_indices   - Integer coordinates of cells with provided distances.
-//!   boundary_distances - Signed distances assigned to boundary cells.
+//! Marching stops at arrival times (in absolute value) larger than
+//! @a max_time. Cells that were not reached are assigned @a far_time, or
+//! -far_time if inside and @a negative_inside is true.
 //!
-//! Preconditions:
-//!   - grid_size may not have a zero element.
-//!   - frozen_indices, frozen_distances and normals must have the same size.
-//!   - frozen_indices must all be within size.
+//! Throws std::invalid_argument if:
+//! - Not the same number of @a indices and @a distances, or
+//! - @a indices (and @a distances) are empty, or
+//! - Any index is outside the @a distance_grid, or
+//! - Any duplicate in @a indices, or
+//! - Any value in @a distances does not pass the @a distance_predicate test.
 //!
-//! TODO - example usage!
-template<typename T, std::size_t N, typename EikonalSolverType>
-std::vector<T> SignedArrivalTime(
+//! Preconditions:
+//! - @a far_time is frozen and larger than @a max_time, unless @a max_time
+//!   is numeric_limits<T>::max(), in which case all cells are reached.
+template<
+  typename T,
+  std::size_t N,
+  typename EikonalSolverType,
+  typename P,
+  typename V,
+  typename R>
+void ArrivalTime(
   std::array<std::size_t, N> const& grid_size,
   std::vector<std::array<std::int32_t, N>> const& boundary_indices,
   std::vector<T> const& boundary_times,
-  EikonalSolverType const& eikonal_solver)
+  EikonalSolverType const& eikonal_solver,
+  P const boundary_time_predicate,
+  bool const negative_inside,
+  T const max_time,
+  T const far_time,
+  V& frozen_cell_visitor,
+  NarrowBandStore<T, N>* const narrow_band,
+  T* const time_buffer,
+  R& stats_recorder)
 {
   using namespace std;
-  using namespace detail;
+
+  assert(narrow_band != nullptr);
+  assert(time_buffer != nullptr);
 
   typedef T TimeType;
 
-  auto const boundary_time_predicate = [](auto const t) {
-    return !isnan(t) && Frozen(t);
-  };
-  auto constexpr negative_inside = true;
-  return ArrivalTime(
-    grid_size,
-    boundary_indices,
-    boundary_times,
-    eikonal_solver,
-    boundary_time_predicate,
-    negative_inside);
-#if 0
+  static_assert(N >= 2, "dimensions must be >= 2");
+  static_assert(N == EikonalSolverType::kDimension,
+                "mismatching eikonal solver dimension");
 
-  detail::ThrowIfZeroElementInSize(grid_size);
-  detail::ThrowIfEmptyBoundaryIndices(boundary_indices);
-  std::for_each(
-    begin(boundary_indices),
-    end(boundary_indices),
-    [=](auto const& boundary_index) {
-      detail::ThrowIfBoundaryIndexOutsideGrid(boundary_index, grid_size);
-  });
+  // Check input.
+  {
+    ScopedPhaseTimer const timer(
+      stats_recorder.PhaseTime(&ArrivalTimeStats::validation));
+    ThrowIfInvalidBoundaryCondition(
+      grid_size,
+      boundary_indices,
+      boundary_times,
+      boundary_time_predicate);
+  }
 
-  auto narrow_band_indices = detail::OutsideInsideNarrowBandIndices(
+  auto narrow_band_indices =
+    pair<vector<array<int32_t, N>>, vector<array<int32_t, N>>>();
+  {
+    ScopedPhaseTimer const timer(
+      stats_recorder.PhaseTime(&ArrivalTimeStats::topology));
+    narrow_band_indices = OutsideInsideNarrowBandIndices(
+      boundary_indices,
+      grid_size,
+      stats_recorder);
+  }
+  auto const& outside_narrow_band_indices = narrow_band_indices.first;
+  auto const& inside_narrow_band_indices = narrow_band_indices.second;
+
+  auto const time_buffer_end = time_buffer + LinearSize(grid_size);
+  fill(time_buffer, time_buffer_end, numeric_limits<TimeType>::max());
+  assert(none_of(time_buffer, time_buffer_end,
+                 [](TimeType const t) { return Frozen(t); }));
+  auto time_grid = Grid<TimeType, N>(
+    grid_size,
+    time_buffer,
+    LinearSize(grid_size));
+
+  // Boundary cells end up with their given times, regardless of inside
+  // and outside marching.
+  for (auto i = size_t{0}; i < boundary_indices.size(); ++i) {
+    frozen_cell_visitor(boundary_indices[i], boundary_times[i]);
+  }
+
+  if (!inside_narrow_band_indices.empty()) {
+    ScopedPhaseTimer const timer(
+      stats_recorder.PhaseTime(&ArrivalTimeStats::inside_march));
+
+    // Set boundaries for marching inside. Always check for duplicate indices.
+    auto const check_duplicate_indices = true;
+    SetBoundaryCondition(
+      boundary_indices,
+      boundary_times,
+      TimeType{-1}, // Multiplier, negate boundary times for inside.
+      check_duplicate_indices,
+      &time_grid);
+
+    // Initialize inside narrow band with negated boundary times.
+    InitializeNarrowBand(
+      inside_narrow_band_indices,
+      time_grid,
+      eikonal_solver,
+      narrow_band,
+      stats_recorder);
+    auto const inside_multiplier = negative_inside ? TimeType{-1} : TimeType{1};
+    auto inside_visitor =
+      [&frozen_cell_visitor, inside_multiplier](
+        array<int32_t, N> const& index,
+        TimeType const time) {
+        frozen_cell_visitor(index, inside_multiplier * time);
+      };
+    MarchNarrowBand(
+      eikonal_solver,
+      narrow_band,
+      &time_grid,
+      max_time,
+      inside_visitor,
+      []() { return false; }, // Stop predicate.
+      stats_recorder);
+    if (!narrow_band->empty()) {
+      FillNonFrozenCells(
+        far_time,
+        narrow_band,
+        &time_grid,
+        inside_visitor);
+    }
+
+    if (negative_inside) {
+      // Negate all the inside times. Essentially, negate everything
+      // computed so far. Note that this also affects the boundary cells.
+      for_each(
+        time_buffer,
+        time_buffer_end,
+        [](auto& t) { t = Frozen(t) ? t * TimeType{-1} : t; });
+    }
+  }
+
+  if (!outside_narrow_band_indices.empty()) {
+    ScopedPhaseTimer const timer(
+      stats_recorder.PhaseTime(&ArrivalTimeStats::outside_march));
+
+    // Set boundaries for marching outside. Only check for duplicate indices
+    // if this was not done already, i.e. if we marched an inside narrow band.
+    auto const check_duplicate_indices = inside_narrow_band_indices.empty();
+    SetBoundaryCondition(
+      boundary_indices,
+      boundary_times,
+      TimeType{1}, // Multiplier, original boundary distances for outside.
+      check_duplicate_indices,
+      &time_grid);
+
+    // Initialize outside narrow band with original boundary times.
+    InitializeNarrowBand(
+      outside_narrow_band_indices,
+      time_grid,
+      eikonal_solver,
+      narrow_band,
+      stats_recorder);
+    MarchNarrowBand(
+      eikonal_solver,
+      narrow_band,
+      &time_grid,
+      max_time,
+      frozen_cell_visitor,
+      []() { return false; }, // Stop predicate.
+      stats_recorder);
+    if (!narrow_band->empty()) {
+      FillNonFrozenCells(
+        far_time,
+        narrow_band,
+        &time_grid,
+        frozen_cell_visitor);
+    }
+  }
+
+  assert(all_of(time_buffer, time_buffer_end,
+                [](TimeType const t) { return Frozen(t); }));
+}
+
+
+//! Returns arrival times for all cells in a grid of size @a grid_size, see
+//! ArrivalTime above.
+template<
+  typename T,
+  std::size_t N,
+  typename EikonalSolverType,
+  typename P,
+  typename V>
+std::vector<T> ArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  P const boundary_time_predicate,
+  bool const negative_inside,
+  T const max_time,
+  T const far_time,
+  V& frozen_cell_visitor,
+  NarrowBandStore<T, N>* const narrow_band)
+{
+  auto time_buffer = std::vector<T>(LinearSize(grid_size));
+  auto stats_recorder = NullArrivalTimeStatsRecorder();
+  ArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    boundary_time_predicate,
+    negative_inside,
+    max_time,
+    far_time,
+    frozen_cell_visitor,
+    narrow_band,
+    time_buffer.data(),
+    stats_recorder);
+  return time_buffer;
+}
+
+
+//! Returns arrival times for all cells in a grid of size @a grid_size, see
+//! ArrivalTime above. The narrow band store is allocated for this call.
+template<
+  typename T,
+  std::size_t N,
+  typename EikonalSolverType,
+  typename P,
+  typename V>
+std::vector<T> ArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  P const boundary_time_predicate,
+  bool const negative_inside,
+  T const max_time,
+  T const far_time,
+  V& frozen_cell_visitor)
+{
+  auto narrow_band = NarrowBandStore<T, N>();
+  return ArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    boundary_time_predicate,
+    negative_inside,
+    max_time,
+    far_time,
+    frozen_cell_visitor,
+    &narrow_band);
+}
+
+
+//! Writes arrival times for all cells in a grid of size @a grid_size to
+//! @a time_buffer, which holds LinearSize(grid_size) cells, by marching a
+//! single front outward from the boundary cells. See GeodesicArrivalTime.
+//! Phase times and counts are passed to @a stats_recorder.
+template<
+  typename T,
+  std::size_t N,
+  typename EikonalSolverType,
+  typename V,
+  typename R>
+void SingleFrontArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  V& frozen_cell_visitor,
+  T* const time_buffer,
+  R& stats_recorder)
+{
+  using namespace std;
+
+  static_assert(N >= 2, "dimensions must be >= 2");
+  static_assert(N == EikonalSolverType::kDimension,
+                "mismatching eikonal solver dimension");
+
+  assert(time_buffer != nullptr);
+
+  // Check input.
+  {
+    ScopedPhaseTimer const timer(
+      stats_recorder.PhaseTime(&ArrivalTimeStats::validation));
+    auto const boundary_time_predicate = [](auto const t) {
+      return !isnan(t) && Frozen(t) && t >= T{0};
+    };
+    ThrowIfInvalidBoundaryCondition(
+      grid_size,
+      boundary_indices,
+      boundary_times,
+      boundary_time_predicate);
+  }
+
+  ScopedPhaseTimer const timer(
+    stats_recorder.PhaseTime(&ArrivalTimeStats::outside_march));
+  auto const time_buffer_end = time_buffer + LinearSize(grid_size);
+  fill(time_buffer, time_buffer_end, numeric_limits<T>::max());
+  auto time_grid = Grid<T, N>(grid_size, time_buffer, LinearSize(grid_size));
+  auto const check_duplicate_indices = true;
+  SetBoundaryCondition(
+    boundary_indices,
+    boundary_times,
+    T{1}, // Multiplier.
+    check_duplicate_indices,
+    &time_grid);
+
+  // Since the boundary cells do not cover the whole grid there is at least
+  // one non-frozen face-neighbor.
+  auto narrow_band = NarrowBandStore<T, N>();
+  InitializeNarrowBand(
+    FaceNeighborNarrowBandIndices(boundary_indices, time_grid),
+    time_grid,
+    eikonal_solver,
+    &narrow_band,
+    stats_recorder);
+  for (auto i = size_t{0}; i < boundary_indices.size(); ++i) {
+    frozen_cell_visitor(boundary_indices[i], boundary_times[i]);
+  }
+  MarchNarrowBand(
+    eikonal_solver,
+    &narrow_band,
+    &time_grid,
+    numeric_limits<T>::max(), // max_time
+    frozen_cell_visitor,
+    []() { return false; }, // Stop predicate.
+    stats_recorder);
+
+  assert(all_of(time_buffer, time_buffer_end,
+                [](T const t) { return Frozen(t); }));
+}
+
+
+//! Returns signed arrival times for all cells in a grid of size
+//! @a grid_size, marched from the cells next to zero crossings of the level
+//! set @a phi. See ReinitializedSignedArrivalTime.
+//!
+//! Marching stops at arrival times (in absolute value) larger than
+//! @a max_time. Cells that were not reached are assigned @a far_time with
+//! the sign of @a phi.
+//!
+//! Preconditions:
+//! - @a far_time is frozen and larger than @a max_time, unless @a max_time
+//!   is numeric_limits<T>::max(), in which case all cells are reached.
+template<typename T, std::size_t N, typename EikonalSolverType>
+std::vector<T> ReinitializedArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::array<T, N> const& grid_spacing,
+  std::vector<T> const& phi,
+  EikonalSolverType const& eikonal_solver,
+  T const max_time,
+  T const far_time)
+{
+  using namespace std;
+
+  static_assert(N >= 2, "dimensions must be >= 2");
+  static_assert(N == EikonalSolverType::kDimension,
+                "mismatching eikonal solver dimension");
+
+  // Check input.
+  ThrowIfInvalidGridSpacing(grid_spacing);
+  auto const phi_grid = ConstGrid<T, N>(grid_size, phi);
+  for_each(begin(phi), end(phi), [](auto const p) { ThrowIfInvalidPhi(p); });
+
+  auto const boundary = LevelSetBoundaryCells(phi_grid, grid_spacing);
+  auto const& boundary_indices = boundary.first;
+  auto const& boundary_times = boundary.second;
+  ThrowIfEmptyBoundaryIndices(boundary_indices);
+
+  auto time_buffer =
+    vector<T>(LinearSize(grid_size), numeric_limits<T>::max());
+  auto time_grid = Grid<T, N>(grid_size, time_buffer);
+  for (auto i = size_t{0}; i < boundary_indices.size(); ++i) {
+    time_grid.Cell(boundary_indices[i]) = boundary_times[i];
+  }
+
+  // There are no non-frozen face-neighbors if all cells are boundary cells.
+  auto const narrow_band_indices =
+    FaceNeighborNarrowBandIndices(boundary_indices, time_grid);
+  if (!narrow_band_indices.empty()) {
+    auto narrow_band = InitializedNarrowBand(
+      narrow_band_indices,
+      time_grid,
+      eikonal_solver);
+    auto frozen_cell_visitor = NullFrozenCellVisitor();
+    MarchNarrowBand(
+      eikonal_solver,
+      narrow_band.get(),
+      &time_grid,
+      max_time,
+      frozen_cell_visitor);
+  }
+
+  // Cells that were not reached get the far time, then apply signs.
+  for (auto i = size_t{0}; i < time_buffer.size(); ++i) {
+    auto& time = time_buffer[i];
+    if (!Frozen(time)) {
+      time = far_time;
+    }
+    if (phi[i] < T{0}) {
+      time *= T{-1};
+    }
+  }
+
+  return time_buffer;
+}
+
+
+//! Polynomial coefficients are equivalent to array index,
+//! i.e. Sum(q[i] * x^i) = 0, for i in [0, 2], or simpler
+//! q[0] + q[1] * x + q[2] * x^2 = 0.
+//!
+//! Returns the largest real root, if any (otherwise a NaN value).
+//! Note that we are not checking for errors here.
+template<typename T>
+T SolveEikonalQuadratic(std::array<T, 3> const& q)
+{
+  using namespace std;
+
+  static_assert(is_floating_point<T>::value,
+                "quadratic coefficients must be floating point");
+
+  // No error-checking here, caller handles bad values.
+  auto const discriminant = q[1] * q[1] - T{4} * q[2] * q[0];
+  auto const pos_root = (-q[1] + sqrt(discriminant)) / (T{2} * q[2]);
+  return pos_root;
+}
+
+
+//! Solve the eikonal equation to get the arrival time (which is distance when
+//! @a speed is one) at @a index.
+//!
+//! Arrival times are read from, and returned as, type T (the storage type),
+//! while the quadratic coefficients are accumulated and solved using type C
+//! (the compute type). Using a wider compute type than storage type improves
+//! robustness without increasing the size of the arrival time grid.
+//!
+//! The upwind weights of the solution are passed to @a value_accumulator,
+//! called as value_accumulator(neighbor_index, weight), see
+//! ValueExtendingEikonalSolver.
+//!
+//! The returned value is guaranteed to be positive.
+//!
+//! Preconditions:
+//! - @a speed must be greater than zero.
+//! - All elements of @a grid_spacing must be greater than zero.
+//! - @a index is inside @a distance_grid.
+//! - The cell at @a index must not be frozen in @a distance_grid.
+//! - There must be at least one cell in @a distance_grid that is a
+//!   frozen face-neighbor of @a index.
+//! - Cells in @a distance_grid that are not frozen must have the value
+//!   numeric_limits<T>::max().
+template<typename T, std::size_t N, typename C = T, typename G, typename A>
+T SolveEikonal(
+  std::array<std::int32_t, N> const& index,
+  G const& distance_grid,
+  T const speed,
+  std::array<T, N> const& grid_spacing,
+  A& value_accumulator)
+{
+  using namespace std;
+
+  static_assert(std::is_floating_point<T>::value,
+                "scalar type must be floating point");
+  static_assert(std::is_floating_point<C>::value,
+                "compute type must be floating point");
+  static_assert(numeric_limits<C>::digits >= numeric_limits<T>::digits,
+                "compute type cannot be less precise than scalar type");
+
+  assert(ValidSpeed(speed) && "Precondition");
+  assert(ValidGridSpacing(grid_spacing) && "Precondition");
+  assert(Inside(index, distance_grid.size()) && "Precondition");
+  assert(!Frozen(distance_grid.Cell(index)) && "Precondition");
+
+  // Find the smallest frozen neighbor (if any) in each dimension.
+  auto frozen_neighbor_distances = array<pair<T, size_t>, N>();
+  auto frozen_neighbor_indices = array<array<int32_t, N>, N>();
+  auto frozen_neighbor_distances_count = size_t{0};
+  for (auto i = size_t{0}; i < N; ++i) {
+    auto neighbor_min_distance = numeric_limits<T>::max();
+    auto neighbor_min_index = index;
+    assert(!Frozen(neighbor_min_distance));
+
+    // Find the smallest face neighbor for this dimension.
+    auto neighbor_index = index;
+
+    // -1
+    neighbor_index[i] -= int32_t{1};
+    if (Inside(neighbor_index, distance_grid.size())) {
+      // Note that if the neighbor is not frozen it will have the default
+      // distance numeric_limits<T>::max().
+      auto const neighbor_distance = distance_grid.Cell(neighbor_index);
+      if (neighbor_distance < neighbor_min_distance) {
+        neighbor_min_distance = neighbor_distance;
+        neighbor_min_index = neighbor_index;
+        assert(Frozen(neighbor_min_distance));
+      }
+    }
+
+    // +1
+    neighbor_index[i] += int32_t{2}; // -1 + 2 = 1
+    if (Inside(neighbor_index, distance_grid.size())) {
+      // Note that if the neighbor is not frozen it will have the default
+      // distance numeric_limits<T>::max().
+      auto const neighbor_distance = distance_grid.Cell(neighbor_index);
+      if (neighbor_distance < neighbor_min_distance) {
+        neighbor_min_distance = neighbor_distance;
+        neighbor_min_index = neighbor_index;
+        assert(Frozen(neighbor_min_distance));
+      }
+    }
+
+    // If no frozen neighbor was found that dimension does not contribute
+    // to the arrival time.
+    if (neighbor_min_distance < numeric_limits<T>::max()) {
+      frozen_neighbor_indices[frozen_neighbor_distances_count] =
+        neighbor_min_index;
+      frozen_neighbor_distances[frozen_neighbor_distances_count++] =
+        {neighbor_min_distance, i};
+    }
+  }
+  assert(frozen_neighbor_distances_count > size_t{0} && "Precondition");
+
+  auto arrival_time = numeric_limits<C>::quiet_NaN();
+  if (frozen_neighbor_distances_count == 1) {
+    // If frozen neighbor in only one dimension we don't need to solve a
+    // quadratic.
+    auto const distance = C{frozen_neighbor_distances[0].first};
+    auto const j = frozen_neighbor_distances[0].second;
+    arrival_time = distance + C{grid_spacing[j]} / C{speed};
+  }
+  else {
+    // Initialize quadratic coefficients.
+    auto q = array<C, 3>{{C{-1} / Squared(C{speed}), C{0}, C{0}}};
+    for (auto i = size_t{0}; i < frozen_neighbor_distances_count; ++i) {
+      auto const distance = C{frozen_neighbor_distances[i].first};
+      auto const j = frozen_neighbor_distances[i].second;
+      auto const alpha = InverseSquared(C{grid_spacing[j]});
+      q[0] += Squared(distance) * alpha;
+      q[1] += C{-2} * distance * alpha;
+      q[2] += alpha;
+    }
+    arrival_time = SolveEikonalQuadratic(q);
+  }
+
+  ThrowIfInvalidArrivalTime(arrival_time, index);
+
+  // Pass the upwind weights to the value accumulator. These are the terms
+  // of the derivative of the quadratic, (arrival_time - distance) * alpha,
+  // where positive.
+  if (frozen_neighbor_distances_count == 1) {
+    value_accumulator(frozen_neighbor_indices[0], T{1});
+  }
+  else {
+    for (auto i = size_t{0}; i < frozen_neighbor_distances_count; ++i) {
+      auto const distance = C{frozen_neighbor_distances[i].first};
+      auto const j = frozen_neighbor_distances[i].second;
+      auto const weight =
+        (arrival_time - distance) * InverseSquared(C{grid_spacing[j]});
+      if (weight > C{0}) {
+        value_accumulator(frozen_neighbor_indices[i], static_cast<T>(weight));
+      }
+    }
+  }
+
+  return static_cast<T>(arrival_time);
+}
+
+
+//! Solve the eikonal equation to get the arrival time (which is distance when
+//! @a speed is one) at @a index. Uses second order derivatives where possible,
+//! this version is slower but more accurate. However, it is important to
+//! have good boundary conditions that allow second order derivatives to be
+//! used early when marching. Otherwise early errors will be propagated.
+//!
+//! Arrival times are read from, and returned as, type T (the storage type),
+//! while the quadratic coefficients are accumulated and solved using type C
+//! (the compute type). The discriminant of the second order quadratic is
+//! prone to cancellation, so using double as compute type is recommended
+//! when storing arrival times as float.
+//!
+//! The upwind weights of the solution are passed to @a value_accumulator,
+//! see SolveEikonal.
+//!
+//! The returned value is guaranteed to be positive.
+//!
+//! Preconditions:
+//! - @a speed must be greater than zero.
+//! - All elements of @a grid_spacing must be greater than zero.
+//! - @a index is inside @a distance_grid.
+//! - The cell at @a index must not be frozen in @a distance_grid.
+//! - There must be at least one cell in @a distance_grid that is a
+//!   frozen face-neighbor of @a index.
+//! - Cells in @a distance_grid that are not frozen must have the value
+//!   numeric_limits<T>::max().
+template<typename T, std::size_t N, typename C = T, typename G, typename A>
+T HighAccuracySolveEikonal(
+  std::array<std::int32_t, N> const& index,
+  G const& distance_grid,
+  T const speed,
+  std::array<T, N> const& grid_spacing,
+  A& value_accumulator)
+{
+  using namespace std;
+
+  static_assert(std::is_floating_point<T>::value,
+                "scalar type must be floating point");
+  static_assert(std::is_floating_point<C>::value,
+                "compute type must be floating point");
+  static_assert(numeric_limits<C>::digits >= numeric_limits<T>::digits,
+                "compute type cannot be less precise than scalar type");
+
+  assert(ValidSpeed(speed) && "Precondition");
+  assert(ValidGridSpacing(grid_spacing) && "Precondition");
+  assert(Inside(index, distance_grid.size()) && "Precondition");
+  assert(!Frozen(distance_grid.Cell(index)) && "Precondition");
+
+  // Find the smallest frozen neighbor(s) (if any) in each dimension.
+  auto const neighbor_offsets = array<int32_t, 2>{{-1, 1}};
+  auto frozen_neighbor_distances = array<pair<pair<T, T>, size_t>, N>();
+  auto frozen_neighbor_indices = array<array<int32_t, N>, N>();
+  auto frozen_neighbor_distances_count = size_t{0};
+  for (auto i = size_t{0}; i < N; ++i) {
+    auto neighbor_min_distance = numeric_limits<T>::max();
+    auto neighbor_min_distance2 = numeric_limits<T>::max();
+    auto neighbor_min_index = index;
+    assert(!Frozen(neighbor_min_distance));
+    assert(!Frozen(neighbor_min_distance2));
+
+    // Check neighbors in both directions for this dimenion.
+    for (auto const neighbor_offset : neighbor_offsets) {
+      auto neighbor_index = index;
+      neighbor_index[i] += neighbor_offset;
+      if (Inside(neighbor_index, distance_grid.size())) {
+        auto const neighbor_distance = distance_grid.Cell(neighbor_index);
+        if (neighbor_distance < neighbor_min_distance) {
+          // Neighbor one step away is frozen.
+          assert(Frozen(neighbor_distance));
+          neighbor_min_distance = neighbor_distance;
+          neighbor_min_index = neighbor_index;
+
+          // Check if neighbor two steps away is frozen and has smaller
+          // (or equal) distance than neighbor one step away. Reset
+          // the distance first since otherwise we might get the secondary
+          // distance from the previous neighbor offset.
+          neighbor_min_distance2 = numeric_limits<T>::max();
+          auto neighbor_index2 = neighbor_index;
+          neighbor_index2[i] += neighbor_offset;
+          if (Inside(neighbor_index2, distance_grid.size())) {
+            auto const neighbor_distance2 = distance_grid.Cell(neighbor_index2);
+            if (neighbor_distance2 <= neighbor_distance) {
+              // Neighbor index two steps away is frozen.
+              assert(Frozen(neighbor_distance2));
+              neighbor_min_distance2 = neighbor_distance2;
+            }
+          }
+        }
+      }
+    }
+
+    if (neighbor_min_distance2 < numeric_limits<T>::max()) {
+      // Two frozen neighbors in this dimension.
+      assert(neighbor_min_distance < numeric_limits<T>::max());
+      frozen_neighbor_indices[frozen_neighbor_distances_count] =
+        neighbor_min_index;
+      frozen_neighbor_distances[frozen_neighbor_distances_count++] =
+        {{neighbor_min_distance, neighbor_min_distance2}, i};
+    }
+    else if (neighbor_min_distance < numeric_limits<T>::max()) {
+      // One frozen neighbor in this dimension.
+      frozen_neighbor_indices[frozen_neighbor_distances_count] =
+        neighbor_min_index;
+      frozen_neighbor_distances[frozen_neighbor_distances_count++] =
+        {{neighbor_min_distance, numeric_limits<T>::max()}, i};
+    }
+    // else: no frozen neighbors in this dimension.
+  }
+  assert(frozen_neighbor_distances_count > size_t{0} && "Precondition");
+
+  auto arrival_time = numeric_limits<C>::quiet_NaN();
+  if (frozen_neighbor_distances_count == 1) {
+    // If frozen neighbor in only one dimension we don't need to solve a
+    // quadratic.
+    auto const distance = C{frozen_neighbor_distances[0].first.first};
+    auto const j = frozen_neighbor_distances[0].second;
+    arrival_time = distance + C{grid_spacing[j]} / C{speed};
+  }
+  else {
+    // Initialize quadratic coefficients.
+    auto q = array<C, 3>{{C{-1} / Squared(C{speed}), C{0}, C{0}}};
+    for (auto i = size_t{0}; i < frozen_neighbor_distances_count; ++i) {
+      auto const distance = frozen_neighbor_distances[i].first.first;
+      auto const distance2 = frozen_neighbor_distances[i].first.second;
+      auto const j = frozen_neighbor_distances[i].second;
+      auto const inverse_squared_grid_spacing =
+        InverseSquared(C{grid_spacing[j]});
+      if (distance2 < numeric_limits<T>::max()) {
+        // Second order coefficients.
+        assert(distance < numeric_limits<T>::max());
+        auto const alpha = (C{9} / C{4}) * inverse_squared_grid_spacing;
+        auto const t = (C{1} / C{3}) * (C{4} * C{distance} - C{distance2});
+        q[0] += Squared(t) * alpha;
+        q[1] += C{-2} * t * alpha;
+        q[2] += alpha;
+      }
+      else if (distance < numeric_limits<T>::max()) {
+        // First order coefficients.
+        auto const alpha = inverse_squared_grid_spacing;
+        q[0] += Squared(C{distance}) * alpha;
+        q[1] += C{-2} * C{distance} * alpha;
+        q[2] += alpha;
+      }
+    }
+    arrival_time = SolveEikonalQuadratic(q);
+  }
+
+  ThrowIfInvalidArrivalTime(arrival_time, index);
+
+  // Pass the upwind weights to the value accumulator, see SolveEikonal.
+  // With second order coefficients the upwind value is extrapolated from
+  // the neighbors one and two steps away, the same as the time.
+  if (frozen_neighbor_distances_count == 1) {
+    value_accumulator(frozen_neighbor_indices[0], T{1});
+  }
+  else {
+    for (auto i = size_t{0}; i < frozen_neighbor_distances_count; ++i) {
+      auto const distance = frozen_neighbor_distances[i].first.first;
+      auto const distance2 = frozen_neighbor_distances[i].first.second;
+      auto const j = frozen_neighbor_distances[i].second;
+      auto const& neighbor_index = frozen_neighbor_indices[i];
+      auto const inverse_squared_grid_spacing =
+        InverseSquared(C{grid_spacing[j]});
+      if (distance2 < numeric_limits<T>::max()) {
+        auto const alpha = (C{9} / C{4}) * inverse_squared_grid_spacing;
+        auto const t = (C{1} / C{3}) * (C{4} * C{distance} - C{distance2});
+        auto const weight = (arrival_time - t) * alpha;
+        if (weight > C{0}) {
+          auto neighbor_index2 = neighbor_index;
+          neighbor_index2[j] += neighbor_index[j] - index[j];
+          value_accumulator(
+            neighbor_index, static_cast<T>((C{4} / C{3}) * weight));
+          value_accumulator(
+            neighbor_index2, static_cast<T>((C{-1} / C{3}) * weight));
+        }
+      }
+      else {
+        auto const weight =
+          (arrival_time - C{distance}) * inverse_squared_grid_spacing;
+        if (weight > C{0}) {
+          value_accumulator(neighbor_index, static_cast<T>(weight));
+        }
+      }
+    }
+  }
+
+  return static_cast<T>(arrival_time);
+}
+
+
+//!
+//!
+//! Implementation follows pseudo-code given in "Fluid Simulation for
+//! Computer Graphics" by Robert Bridson.
+//!
+//! The upwind weights of the solution are passed to @a value_accumulator,
+//! see SolveEikonal.
+//!
+//! Preconditions:
+//! - @a dx must be greater than zero.
+//! - @a index is inside @a distance_grid.
+//! - The cell at @a index must not be frozen in @a distance_grid.
+//! - There must be at least one cell in @a distance_grid that is a
+//!   frozen face-neighbor of @a index.
+//! - Cells in @a distance_grid that are not frozen must have the value
+//!   numeric_limits<T>::max().
+//!
+//! Note: Currently supports only uniformly spaced (square) cells.
+//! Note: Currently supports only 1D, 2D, and 3D.
+template<typename T, std::size_t N, typename G, typename A>
+T SolveDistance(
+    std::array<std::int32_t, N> const& index,
+    G const& distance_grid,
+    T const dx,
+    A& value_accumulator)
+{
+  using namespace std;
+
+  static_assert(1 <= N && N <= 3, "invalid dimensionality");
+
+  assert(Inside(index, distance_grid.size()) && "Precondition");
+  assert(!Frozen(distance_grid.Cell(index)) && "Precondition");
+
+  auto phi = array<T, N>();
+  fill(begin(phi), end(phi), numeric_limits<T>::max());
+  auto phi_indices = array<array<int32_t, N>, N>();
+  auto phi_count = size_t{0};
+
+  // Find the smallest frozen neighbor(s) (if any) in each dimension.
+  for (auto i = size_t{0}; i < N; ++i) {
+    auto neighbor_min_distance = numeric_limits<T>::max();
+    auto neighbor_min_index = index;
+    assert(!Frozen(neighbor_min_distance));
+
+    // -1
+    auto neighbor_index = index;
+    neighbor_index[i] -= 1;
+    if (Inside(neighbor_index, distance_grid.size())) {
+      auto const neighbor_distance = distance_grid.Cell(neighbor_index);
+      if (neighbor_distance < neighbor_min_distance) {
+        neighbor_min_distance = neighbor_distance;
+        neighbor_min_index = neighbor_index;
+      }
+    }
+
+    // -1 + 2 = +1
+    neighbor_index[i] += 2;
+    if (Inside(neighbor_index, distance_grid.size())) {
+      auto const neighbor_distance = distance_grid.Cell(neighbor_index);
+      if (neighbor_distance < neighbor_min_distance) {
+        neighbor_min_distance = neighbor_distance;
+        neighbor_min_index = neighbor_index;
+      }
+    }
+
+    if (neighbor_min_distance < numeric_limits<T>::max()) {
+      phi_indices[phi_count] = neighbor_min_index;
+      phi[phi_count++] = neighbor_min_distance;
+    }
+  }
+  assert(phi_count > 0 && "Precondition");
+
+  // Sort ascending using a sorting network approach, keeping the neighbor
+  // indices in the same order.
+  auto const sort_pair = [&](size_t const a, size_t const b) {
+    if (phi[a] > phi[b]) {
+      swap(phi[a], phi[b]);
+      swap(phi_indices[a], phi_indices[b]);
+    }
+  };
+  if (N >= 2) { sort_pair(0, 1); }
+  if (N == 3) { sort_pair(1, 2); }
+  if (N == 3) { sort_pair(0, 1); }
+
+  auto distance = phi[0] + dx;
+  auto upwind_count = size_t{1};
+  if (N >= 2 && phi_count > 1 && distance > phi[1]) {
+    upwind_count = 2;
+    distance = T(0.5) * (phi[0] + phi[1] +
+      sqrt(T(2) * Squared(dx) - Squared(phi[1] - phi[0])));
+    if (N == 3 && phi_count == 3 && distance > phi[2]) {
+      upwind_count = 3;
+      auto const phi_sum = phi[0] + phi[1] + phi[2];
+      auto phi_sum_squared = Squared(phi[0]) + Squared(phi[1]) + Squared(phi[2]);
+      distance = (T(1) / T(3)) * (phi_sum + sqrt(max(
+        T(0),
+        Squared(phi_sum) - T(3) * (phi_sum_squared - Squared(dx)))));
+    }
+  }
+
+  // Arrival time is distance here since we have assumed that speed is one.
+  ThrowIfInvalidArrivalTime(distance, index);
+
+  // Pass the upwind weights to the value accumulator, see SolveEikonal.
+  // The grid spacing is the same in all dimensions.
+  if (upwind_count == 1) {
+    value_accumulator(phi_indices[0], T{1});
+  }
+  else {
+    for (auto i = size_t{0}; i < upwind_count; ++i) {
+      if (distance > phi[i]) {
+        value_accumulator(phi_indices[i], distance - phi[i]);
+      }
+    }
+  }
+
+  return distance;
+}
+
+
+//! Base class for Eikonal solvers.
+//! Note: dtor is not virtual!
+template <typename T, std::size_t N>
+class EikonalSolverBase
+{
+public:
+  typedef T ScalarType;
+  static std::size_t const kDimension = N;
+
+protected:
+  explicit EikonalSolverBase(std::array<T, N> const& grid_spacing)
+    : grid_spacing_(grid_spacing)
+  {
+    ThrowIfInvalidGridSpacing(grid_spacing_);
+  }
+
+  std::array<T, N> const& grid_spacing() const
+  {
+    return grid_spacing_;
+  }
+
+private:
+  std::array<T, N> const grid_spacing_;
+};
+
+
+//! Base class for Eikonal solvers with uniform speed.
+//! Note: dtor is not virtual!
+template <typename T, std::size_t N>
+class UniformSpeedEikonalSolverBase : public EikonalSolverBase<T, N>
+{
+protected:
+  UniformSpeedEikonalSolverBase(
+    std::array<T, N> const& grid_spacing,
+    T const uniform_speed)
+    : EikonalSolverBase<T, N>(grid_spacing)
+    , uniform_speed_(uniform_speed)
+  {
+    ThrowIfZeroOrNegativeOrNanSpeed(uniform_speed_);
+  }
+
+  //! Returns the uniform speed, guaranteed to be:
+  //! - Non-zero
+  //! - Positive
+  //! - Not NaN
+  T uniform_speed() const
+  {
+    return uniform_speed_;
+  }
+
+private:
+  T const uniform_speed_;
+};
+
+
+//! Base class for Eikonal solvers with varying speed.
+//! Note: dtor is not virtual!
+template <typename T, std::size_t N>
+class VaryingSpeedEikonalSolverBase : public EikonalSolverBase<T, N>
+{
+protected:
+  VaryingSpeedEikonalSolverBase(
+    std::array<T, N> const& grid_spacing,
+    std::array<std::size_t, N> const& speed_grid_size,
+    std::vector<T> const& speed_buffer)
+    : EikonalSolverBase<T, N>(grid_spacing)
+    , speed_grid_(speed_grid_size, speed_buffer)
+  {
+    for (auto const speed : speed_buffer) {
+      ThrowIfZeroOrNegativeOrNanSpeed(speed);
+    }
+  }
+
+  VaryingSpeedEikonalSolverBase(
+    std::array<T, N> const& grid_spacing,
+    std::array<std::size_t, N> const& speed_grid_size,
+    T const* const speed_buffer,
+    std::size_t const speed_buffer_size)
+    : EikonalSolverBase<T, N>(grid_spacing)
+    , speed_grid_(speed_grid_size, speed_buffer, speed_buffer_size)
+  {
+    std::for_each(
+      speed_buffer,
+      speed_buffer + speed_buffer_size,
+      [](T const speed) { ThrowIfZeroOrNegativeOrNanSpeed(speed); });
+  }
+
+  //! Returns the speed at @a index in the speed grid, guaranteed to be:
+  //! - Non-zero
+  //! - Positive
+  //! - Not NaN
+  //!
+  //! Throws an std::invalid_argument exception if @a index is outside the
+  //! speed grid.
+  T Speed(std::array<std::int32_t, N> const& index) const
+  {
+    ThrowIfSpeedIndexOutsideGrid(index, speed_grid_.size());
+    return speed_grid_.Cell(index);
+  }
+
+private:
+  ConstGrid<T, N> const speed_grid_;
+};
+
+
+//! Eikonal solver for marching where cells are not frozen in order of
+//! arrival time, e.g. heuristic-guided marching. The frozen neighbor times
+//! of a cell may then be too far apart to be upwind of it, so that the
+//! quadratic has no real root and the wrapped solver throws. When that
+//! happens the face neighbors in the dimension with the largest neighbor
+//! time are temporarily hidden in the @a time_grid and the wrapped solver
+//! is called again, until there is a solution. Results are the same as
+//! for the wrapped solver whenever it succeeds.
+//!
+//! Preconditions:
+//! - Solve is only called with the grid pointed to by @a time_grid.
+template <typename T, std::size_t N, typename E>
+class DimensionDroppingEikonalSolver
+{
+public:
+  typedef T ScalarType;
+  static std::size_t const kDimension = N;
+
+  DimensionDroppingEikonalSolver(
+    E const& eikonal_solver,
+    Grid<T, N>* const time_grid)
+    : eikonal_solver_(eikonal_solver)
+    , time_grid_(time_grid)
+  {
+    assert(time_grid != nullptr && "Precondition");
+  }
+
+  template<typename G>
+  T Solve(
+    std::array<std::int32_t, N> const& index,
+    G const& time_grid) const
+  {
+    using namespace std;
+
+    assert(&time_grid == time_grid_ && "Precondition");
+
+    try {
+      return eikonal_solver_.Solve(index, time_grid);
+    }
+    catch (runtime_error const&) {
+      // Find the dimension with the largest smallest frozen neighbor time.
+      // If there is only one dimension left there is nothing to drop.
+      auto dimension_count = size_t{0};
+      auto drop_dimension = size_t{0};
+      auto drop_time = numeric_limits<T>::lowest();
+      for (auto i = size_t{0}; i < N; ++i) {
+        auto neighbor_min_time = numeric_limits<T>::max();
+        for (auto const offset : {int32_t{-1}, int32_t{1}}) {
+          auto neighbor_index = index;
+          neighbor_index[i] += offset;
+          if (Inside(neighbor_index, time_grid_->size())) {
+            neighbor_min_time =
+              min(neighbor_min_time, time_grid_->Cell(neighbor_index));
+          }
+        }
+        if (Frozen(neighbor_min_time)) {
+          ++dimension_count;
+          if (neighbor_min_time > drop_time) {
+            drop_dimension = i;
+            drop_time = neighbor_min_time;
+          }
+        }
+      }
+      if (dimension_count < 2) {
+        throw;
+      }
+
+      // Hide the neighbors, solve with the remaining dimensions and
+      // restore the neighbors, also if solving fails.
+      auto hidden = array<pair<array<int32_t, N>, T>, 2>();
+      auto hidden_count = size_t{0};
+      for (auto const offset : {int32_t{-1}, int32_t{1}}) {
+        auto neighbor_index = index;
+        neighbor_index[drop_dimension] += offset;
+        if (Inside(neighbor_index, time_grid_->size())) {
+          auto& neighbor_time = time_grid_->Cell(neighbor_index);
+          hidden[hidden_count++] = {neighbor_index, neighbor_time};
+          neighbor_time = numeric_limits<T>::max();
+        }
+      }
+      auto const restore = [&]() {
+        for (auto i = size_t{0}; i < hidden_count; ++i) {
+          time_grid_->Cell(hidden[i].first) = hidden[i].second;
+        }
+      };
+
+      auto arrival_time = T{0};
+      try {
+        arrival_time = Solve(index, time_grid);
+      }
+      catch (...) {
+        restore();
+        throw;
+      }
+      restore();
+      return arrival_time;
+    }
+  }
+
+private:
+  E const& eikonal_solver_;
+  Grid<T, N>* const time_grid_;
+};
+
+
+//! Value accumulator for ValueExtendingEikonalSolver. Returns the weighted
+//! average of the values of the upwind neighbors passed to it.
+template<typename T, std::size_t N, typename V>
+class ExtendedValueAccumulator
+{
+public:
+  explicit ExtendedValueAccumulator(Grid<V, N> const& value_grid)
+    : value_grid_(value_grid)
+    , weight_sum_(T{0})
+    , weighted_value_sum_()
+  {}
+
+  void operator()(
+    std::array<std::int32_t, N> const& neighbor_index,
+    T const weight)
+  {
+    // Start from the first weighted value rather than V{}, which need not
+    // be zero for all value types.
+    weighted_value_sum_ = weight_sum_ == T{0} ?
+      value_grid_.Cell(neighbor_index) * weight :
+      weighted_value_sum_ + value_grid_.Cell(neighbor_index) * weight;
+    weight_sum_ += weight;
+  }
+
+  //! Preconditions:
+  //! - At least one upwind neighbor was passed to this accumulator.
+  V value() const
+  {
+    assert(weight_sum_ > T{0} && "Precondition");
+    return weighted_value_sum_ * (T{1} / weight_sum_);
+  }
+
+private:
+  Grid<V, N> const& value_grid_;
+  T weight_sum_;
+  V weighted_value_sum_;
+};
+
+
+//! Eikonal solver that extends values from frozen cells while marching.
+//! Each time a cell is solved the upwind weights of the wrapped solver are
+//! used to set the value of the cell in @a value_grid to the weighted
+//! average of the values of its upwind neighbors, such that the gradient
+//! of the values is orthogonal to the gradient of the arrival times.
+//!
+//! The last time a cell is solved before it is frozen is the solve that
+//! gave its frozen time, since every solve after the first one adds an
+//! upwind neighbor frozen before the cell, which can only lower the time.
+//! So the value of a frozen cell is that of its frozen time, without
+//! storing tentative values for narrow band cells. With second order
+//! solvers this holds up to the second order correction.
+template <typename T, std::size_t N, typename E, typename V>
+class ValueExtendingEikonalSolver
+{
+public:
+  typedef T ScalarType;
+  static std::size_t const kDimension = N;
+
+  ValueExtendingEikonalSolver(
+    E const& eikonal_solver,
+    Grid<V, N>* const value_grid)
+    : eikonal_solver_(eikonal_solver)
+    , value_grid_(value_grid)
+  {
+    assert(value_grid != nullptr && "Precondition");
+  }
+
+  template<typename G>
+  T Solve(
+    std::array<std::int32_t, N> const& index,
+    G const& time_grid) const
+  {
+    auto value_accumulator = ExtendedValueAccumulator<T, N, V>(*value_grid_);
+    auto const time =
+      eikonal_solver_.Solve(index, time_grid, value_accumulator);
+    value_grid_->Cell(index) = value_accumulator.value();
+    return time;
+  }
+
+private:
+  E const& eikonal_solver_;
+  Grid<V, N>* const value_grid_;
+};
+
+
+//! Returns the IEEE 754 binary16 (half precision) bit pattern closest to
+//! @a f. Rounds to nearest even. Values too large to be represented become
+//! infinity, NaN is preserved.
+inline std::uint16_t HalfFromFloat(float const f)
+{
+  using namespace std;
+
+  static_assert(sizeof(float) == sizeof(uint32_t), "unexpected float size");
+  static_assert(numeric_limits<float>::is_iec559, "float is not IEEE 754");
+
+  auto x = uint32_t{0};
+  memcpy(&x, &f, sizeof(float));
+  auto const sign = static_cast<uint32_t>((x >> 16) & 0x8000u);
+  auto const abs_x = x & 0x7fffffffu;
+
+  if (abs_x >= 0x7f800000u) {
+    // Infinity or NaN, keep a NaN quiet.
+    return static_cast<uint16_t>(
+      sign | 0x7c00u | (abs_x > 0x7f800000u ? 0x0200u : 0u));
+  }
+  if (abs_x >= 0x477ff000u) {
+    // Rounds to a value larger than the largest half, 65504.
+    return static_cast<uint16_t>(sign | 0x7c00u);
+  }
+  if (abs_x < 0x38800000u) {
+    // Smaller than the smallest normal half, 2^-14.
+    if (abs_x < 0x33000000u) {
+      // Rounds to zero.
+      return static_cast<uint16_t>(sign);
+    }
+    auto const exponent = abs_x >> 23;
+    auto const mantissa = (abs_x & 0x007fffffu) | 0x00800000u;
+    auto const shift = 126u - exponent;
+    auto h = mantissa >> shift;
+    auto const remainder = mantissa & ((1u << shift) - 1u);
+    auto const halfway = 1u << (shift - 1u);
+    if (remainder > halfway || (remainder == halfway && (h & 1u))) {
+      ++h;
+    }
+    return static_cast<uint16_t>(sign | h);
+  }
+
+  // Normal half, re-bias the exponent from 127 to 15. Rounding may carry
+  // into the exponent, which is the correct behavior.
+  auto h = (abs_x - 0x38000000u) >> 13;
+  auto const remainder = abs_x & 0x1fffu;
+  if (remainder > 0x1000u || (remainder == 0x1000u && (h & 1u))) {
+    ++h;
+  }
+  return static_cast<uint16_t>(sign | h);
+}
+
+
+//! Returns the float value of the IEEE 754 binary16 bit pattern @a h.
+//! The conversion is exact.
+inline float FloatFromHalf(std::uint16_t const h)
+{
+  using namespace std;
+
+  auto const sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+  auto exponent = static_cast<uint32_t>((h >> 10) & 0x1fu);
+  auto mantissa = static_cast<uint32_t>(h & 0x03ffu);
+
+  auto x = uint32_t{0};
+  if (exponent == 0u) {
+    if (mantissa == 0u) {
+      x = sign; // Signed zero.
+    }
+    else {
+      // Subnormal half, normalize.
+      exponent = 113u;
+      while (!(mantissa & 0x0400u)) {
+        mantissa <<= 1;
+        --exponent;
+      }
+      mantissa &= 0x03ffu;
+      x = sign | (exponent << 23) | (mantissa << 13);
+    }
+  }
+  else if (exponent == 0x1fu) {
+    x = sign | 0x7f800000u | (mantissa << 13); // Infinity or NaN.
+  }
+  else {
+    x = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+  }
+
+  auto f = 0.f;
+  memcpy(&f, &x, sizeof(float));
+  return f;
+}
+
+
+//! Returns the type code stored in grid files for cells of type T.
+template<typename T>
+std::uint32_t GridFileScalarType()
+{
+  static_assert(std::is_floating_point<T>::value,
+                "scalar type must be floating point");
+  static_assert(sizeof(T) == 4 || sizeof(T) == 8,
+                "scalar type must be 32 or 64 bits");
+
+  return sizeof(T) == 4 ? 1u : 2u;
+}
+
+
+//! Fields of a grid file header. On disk the header is, in native byte
+//! order:
+//!
+//!   magic           8 bytes, "FMMGRID" followed by a zero byte
+//!   version         uint32
+//!   byte order mark uint32, 0x01020304
+//!   scalar type     uint32, 1 for 32-bit and 2 for 64-bit floating point
+//!   dimension       uint32
+//!   compression     uint32, see GridFileCompression
+//!   complete        uint32, 1 if all cells were written
+//!   tile cell count uint64
+//!   grid size       N x uint64
+//!   grid spacing    N x float64
+//!
+//! padded with zeros to a multiple of 64 bytes, so that cells stored
+//! directly after the header are aligned when the file is memory-mapped.
+//! Compressed files store a table of (offset, byte count) pairs, both
+//! uint64, for each tile after the header.
+template<std::size_t N>
+struct GridFileHeader
+{
+  std::uint32_t scalar_type;
+  GridFileCompression compression;
+  bool complete;
+  std::size_t tile_cell_count;
+  std::array<std::size_t, N> grid_size;
+  std::array<double, N> grid_spacing;
+};
+
+
+//! Returns the first bytes of every grid file, including a zero byte.
+inline char const* GridFileMagic()
+{
+  return "FMMGRID";
+}
+
+
+//! Returns the version of the grid file format written by this library.
+inline std::uint32_t GridFileVersion()
+{
+  return 1u;
+}
+
+
+//! Returns a value whose bytes, as stored in a grid file, identify the byte
+//! order used by the writer.
+inline std::uint32_t GridFileByteOrderMark()
+{
+  return 0x01020304u;
+}
+
+
+//! Returns the size in bytes of the header of an N-dimensional grid file.
+template<std::size_t N>
+std::size_t GridFileHeaderByteCount()
+{
+  auto const byte_count = 8 + 6 * 4 + 8 + N * (8 + 8);
+  return (byte_count + 63) / 64 * 64;
+}
+
+
+//! Returns the number of tiles in a grid file with @a cell_count cells.
+inline std::size_t GridFileTileCount(
+  std::size_t const cell_count,
+  std::size_t const tile_cell_count)
+{
+  return (cell_count + tile_cell_count - 1) / tile_cell_count;
+}
+
+
+//! Append the bytes of @a value to @a bytes.
+template<typename U>
+void AppendBytes(U const value, std::vector<char>* const bytes)
+{
+  assert(bytes != nullptr);
+
+  auto const begin = reinterpret_cast<char const*>(&value);
+  bytes->insert(bytes->end(), begin, begin + sizeof(U));
+}
+
+
+//! Returns the value of type U stored at @a *bytes, and advances @a *bytes
+//! past it.
+template<typename U>
+U ConsumeBytes(char const** const bytes)
+{
+  assert(bytes != nullptr);
+
+  auto value = U();
+  std::memcpy(&value, *bytes, sizeof(U));
+  *bytes += sizeof(U);
+  return value;
+}
+
+
+//! Throws an std::runtime_error exception for the invalid grid file at
+//! @a path, with @a what describing the problem.
+[[noreturn]] inline void ThrowInvalidGridFile(
+  std::string const& path,
+  std::string const& what)
+{
+  using namespace std;
+
+  auto ss = stringstream();
+  ss << "invalid grid file '" << path << "': " << what;
+  throw runtime_error(ss.str());
+}
+
+
+//! Returns the serialized @a header, see GridFileHeader.
+template<std::size_t N>
+std::vector<char> GridFileHeaderBytes(GridFileHeader<N> const& header)
+{
+  using namespace std;
+
+  auto bytes = vector<char>(GridFileMagic(), GridFileMagic() + 8);
+  AppendBytes(GridFileVersion(), &bytes);
+  AppendBytes(GridFileByteOrderMark(), &bytes);
+  AppendBytes(header.scalar_type, &bytes);
+  AppendBytes(static_cast<uint32_t>(N), &bytes);
+  AppendBytes(static_cast<uint32_t>(header.compression), &bytes);
+  AppendBytes(static_cast<uint32_t>(header.complete ? 1 : 0), &bytes);
+  AppendBytes(static_cast<uint64_t>(header.tile_cell_count), &bytes);
+  for (auto const size : header.grid_size) {
+    AppendBytes(static_cast<uint64_t>(size), &bytes);
+  }
+  for (auto const spacing : header.grid_spacing) {
+    AppendBytes(spacing, &bytes);
+  }
+  bytes.resize(GridFileHeaderByteCount<N>(), 0);
+  return bytes;
+}
+
+
+//! Returns the header stored in the first @a byte_count bytes of the grid
+//! file at @a path, for cells of type T.
+//!
+//! Throws std::runtime_error if the header is not that of a complete
+//! N-dimensional grid file with cells of type T, written with the same
+//! byte order.
+template<typename T, std::size_t N>
+GridFileHeader<N> ParseGridFileHeader(
+  char const* bytes,
+  std::size_t const byte_count,
+  std::string const& path)
+{
+  using namespace std;
+
+  if (byte_count < GridFileHeaderByteCount<N>() ||
+      memcmp(bytes, GridFileMagic(), 8) != 0) {
+    ThrowInvalidGridFile(path, "not a grid file");
+  }
+  bytes += 8;
+
+  if (ConsumeBytes<uint32_t>(&bytes) != GridFileVersion()) {
+    ThrowInvalidGridFile(path, "unsupported version");
+  }
+  if (ConsumeBytes<uint32_t>(&bytes) != GridFileByteOrderMark()) {
+    ThrowInvalidGridFile(path, "byte order mismatch");
+  }
+
+  auto header = GridFileHeader<N>();
+  header.scalar_type = ConsumeBytes<uint32_t>(&bytes);
+  if (header.scalar_type != GridFileScalarType<T>()) {
+    ThrowInvalidGridFile(path, "scalar type mismatch");
+  }
+  if (ConsumeBytes<uint32_t>(&bytes) != N) {
+    ThrowInvalidGridFile(path, "dimension mismatch");
+  }
+  auto const compression = ConsumeBytes<uint32_t>(&bytes);
+  if (compression != static_cast<uint32_t>(GridFileCompression::kNone) &&
+      compression != static_cast<uint32_t>(GridFileCompression::kRunLength)) {
+    ThrowInvalidGridFile(path, "unsupported compression");
+  }
+  header.compression = static_cast<GridFileCompression>(compression);
+  header.complete = ConsumeBytes<uint32_t>(&bytes) == 1;
+  if (!header.complete) {
+    ThrowInvalidGridFile(path, "incomplete");
+  }
+  header.tile_cell_count =
+    static_cast<size_t>(ConsumeBytes<uint64_t>(&bytes));
+  for (auto& size : header.grid_size) {
+    size = static_cast<size_t>(ConsumeBytes<uint64_t>(&bytes));
+  }
+  for (auto& spacing : header.grid_spacing) {
+    spacing = ConsumeBytes<double>(&bytes);
+  }
+  if (header.tile_cell_count == 0) {
+    ThrowInvalidGridFile(path, "invalid tile cell count");
+  }
+  try {
+    ThrowIfInvalidSize(header.grid_size);
+  }
+  catch (invalid_argument const& ex) {
+    ThrowInvalidGridFile(path, ex.what());
+  }
+  return header;
+}
+
+
+//! Returns the cells in @a tile_cells, encoded as runs of bitwise equal
+//! cells. Each run is stored as a uint32 count followed by the cell value.
+template<typename T>
+std::vector<char> RunLengthEncodedTile(std::vector<T> const& tile_cells)
+{
+  using namespace std;
+
+  auto bytes = vector<char>();
+  auto i = size_t{0};
+  while (i < tile_cells.size()) {
+    auto run_length = uint32_t{1};
+    while (i + run_length < tile_cells.size() &&
+           run_length < numeric_limits<uint32_t>::max() &&
+           memcmp(
+             &tile_cells[i], &tile_cells[i + run_length], sizeof(T)) == 0) {
+      ++run_length;
+    }
+    AppendBytes(run_length, &bytes);
+    AppendBytes(tile_cells[i], &bytes);
+    i += run_length;
+  }
+  return bytes;
+}
+
+
+//! Decode the @a byte_count bytes at @a bytes, see RunLengthEncodedTile,
+//! into @a tile_cell_count cells at @a tile_cells.
+//!
+//! Throws std::runtime_error if the runs do not add up to exactly
+//! @a tile_cell_count cells.
+template<typename T>
+void DecodeRunLengthTile(
+  char const* bytes,
+  std::size_t const byte_count,
+  std::size_t const tile_cell_count,
+  std::string const& path,
+  T* const tile_cells)
+{
+  using namespace std;
+
+  assert(tile_cells != nullptr);
+
+  auto const bytes_end = bytes + byte_count;
+  auto i = size_t{0};
+  while (bytes_end - bytes >=
+         static_cast<ptrdiff_t>(sizeof(uint32_t) + sizeof(T))) {
+    auto const run_length = ConsumeBytes<uint32_t>(&bytes);
+    auto const value = ConsumeBytes<T>(&bytes);
+    if (run_length > tile_cell_count - i) {
+      ThrowInvalidGridFile(path, "corrupt tile");
+    }
+    fill(tile_cells + i, tile_cells + i + run_length, value);
+    i += run_length;
+  }
+  if (bytes != bytes_end || i != tile_cell_count) {
+    ThrowInvalidGridFile(path, "corrupt tile");
+  }
+}
+
+
+//! Throws an std::runtime_error exception with the message @a what,
+//! followed by @a path (if not empty) and a description of
+//! @a error_number. Callers that make other system calls after the failing
+//! one, e.g. closing a file, must save errno first and pass it here.
+[[noreturn]] inline void ThrowSystemError(
+  std::string const& what,
+  std::string const& path,
+  int const error_number = errno)
+{
+  using namespace std;
+
+  auto ss = stringstream();
+  ss << what;
+  if (!path.empty()) {
+    ss << " '" << path << "'";
+  }
+  ss << ": " << strerror(error_number);
+  throw runtime_error(ss.str());
+}
+
+} // namespace detail
+
+
+#if defined(__unix__) || defined(__APPLE__)
+
+//! Grid cell storage backed by a memory-mapped file, for grids that are
+//! larger than the available memory. Cells are stored in the same order as
+//! in the std::vector buffers used elsewhere. Pages are read and written
+//! back by the operating system as cells are accessed, so the resident
+//! memory is bounded by the recently accessed pages, e.g. the slabs of the
+//! grid around the marching front, rather than by the grid size.
+//!
+//! Mapped grids can store arrival times, see SignedArrivalTime and
+//! GeodesicArrivalTime, and speeds, see VaryingSpeedEikonalSolver.
+template<typename T, std::size_t N>
+class MappedGrid
+{
+public:
+  typedef T CellType;
+  typedef std::array<std::size_t, N> SizeType;
+
+  //! Map the file at @a path, holding the cells of a grid of size @a size.
+  //! The file is created if it does not exist and resized to hold exactly
+  //! the cells of the grid. Existing file contents are kept, so that cells
+  //! written previously, e.g. speeds, can be re-used.
+  //!
+  //! Throws std::invalid_argument if @a size is invalid.
+  //!
+  //! Throws std::runtime_error if the file cannot be opened, resized or
+  //! mapped.
+  MappedGrid(std::string const& path, SizeType const& size)
+    : size_(size)
+    , cell_count_(detail::LinearSize(size))
+    , cells_(nullptr)
+  {
+    using namespace std;
+
+    static_assert(is_trivially_copyable<T>::value,
+                  "cell type must be trivially copyable");
+
+    if (cell_count_ > numeric_limits<size_t>::max() / sizeof(T)) {
+      auto ss = stringstream();
+      ss << "invalid size: " << detail::ToString(size);
+      throw invalid_argument(ss.str());
+    }
+
+    auto const file_descriptor = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (file_descriptor == -1) {
+      detail::ThrowSystemError("failed to open grid file", path);
+    }
+    if (::ftruncate(file_descriptor, static_cast<off_t>(byte_count())) != 0) {
+      auto const error_number = errno;
+      ::close(file_descriptor);
+      detail::ThrowSystemError(
+        "failed to resize grid file", path, error_number);
+    }
+    auto const address = ::mmap(
+      nullptr,
+      byte_count(),
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED,
+      file_descriptor,
+      0);
+    auto const error_number = errno;
+    // The mapping keeps a reference to the file.
+    ::close(file_descriptor);
+    if (address == MAP_FAILED) {
+      detail::ThrowSystemError("failed to map grid file", path, error_number);
+    }
+    cells_ = static_cast<T*>(address);
+  }
+
+  ~MappedGrid()
+  {
+    ::munmap(cells_, byte_count());
+  }
+
+  MappedGrid(MappedGrid const&) = delete;
+  MappedGrid& operator=(MappedGrid const&) = delete;
+
+  //! Returns the size of the grid.
+  SizeType size() const
+  {
+    return size_;
+  }
+
+  //! Returns the number of cells in the grid.
+  std::size_t cell_count() const
+  {
+    return cell_count_;
+  }
+
+  //! Returns a pointer to the first cell. Cells are laid out as in a
+  //! std::vector buffer for a grid of the same size.
+  T* data()
+  {
+    return cells_;
+  }
+
+  //! Returns a pointer to the first cell, see above.
+  T const* data() const
+  {
+    return cells_;
+  }
+
+  //! Write modified cells back to the file, blocking until done.
+  //!
+  //! Throws std::runtime_error if writing fails.
+  void Flush()
+  {
+    if (::msync(cells_, byte_count(), MS_SYNC) != 0) {
+      detail::ThrowSystemError("failed to flush grid file", "");
+    }
+  }
+
+private:
+  std::size_t byte_count() const
+  {
+    return cell_count_ * sizeof(T);
+  }
+
+  SizeType const size_;
+  std::size_t const cell_count_;
+  T* cells_;
+};
+
+#endif // defined(__unix__) || defined(__APPLE__)
+
+
+//! Sparse grid cell storage, for arrival times that are only computed in a
+//! band around the boundary, see SparseGeodesicArrivalTime. Cells are
+//! grouped into leaves of kLeafWidth cells in each dimension. A leaf is
+//! allocated the first time one of its cells is accessed for writing, and
+//! leaves are found through a hash map keyed on their position. Memory use
+//! is thereby proportional to the number of touched leaves, i.e. to the
+//! area of the boundary times the band width, rather than to the grid
+//! size.
+//!
+//! Cells that have not been written have the value
+//! numeric_limits<T>::max(), i.e. they are not frozen. The grid can be used
+//! in place of a dense grid by the eikonal solvers.
+template<typename T, std::size_t N>
+class SparseGrid
+{
+public:
+  typedef T CellType;
+  typedef std::array<std::size_t, N> SizeType;
+  typedef std::array<std::int32_t, N> IndexType;
+
+  //! Number of cells in each dimension of a leaf.
+  static std::int32_t const kLeafWidth = 8;
+
+  //! Construct an empty grid of size @a size, no leaves are allocated.
+  //!
+  //! Throws std::invalid_argument if @a size is invalid.
+  explicit SparseGrid(SizeType const& size)
+    : size_(size)
+    , leaf_grid_size_()
+    , leaf_grid_strides_()
+    , leaf_strides_(
+        detail::GridStrides(
+          detail::FilledArray<std::size_t, N>(kLeafWidth)))
+    , unset_cell_(std::numeric_limits<T>::max())
+  {
+    detail::ThrowIfInvalidSize(size);
+
+    for (auto i = std::size_t{0}; i < N; ++i) {
+      leaf_grid_size_[i] = (size_[i] + kLeafWidth - 1) / kLeafWidth;
+    }
+    leaf_grid_strides_ = detail::GridStrides(leaf_grid_size_);
+  }
+
+  //! Returns the size of the grid.
+  SizeType size() const
+  {
+    return size_;
+  }
+
+  //! Returns the number of allocated leaves.
+  std::size_t leaf_count() const
+  {
+    return leaves_.size();
+  }
+
+  //! Returns the number of cells in a leaf.
+  static std::size_t LeafCellCount()
+  {
+    return detail::LinearSize(detail::FilledArray<std::size_t, N>(kLeafWidth));
+  }
+
+  //! Returns a reference to the cell at @a index, allocating its leaf if
+  //! needed. References remain valid when other leaves are allocated.
+  //!
+  //! Preconditions:
+  //! - @a index is inside the grid.
+  T& Cell(IndexType const& index)
+  {
+    assert(detail::Inside(index, size_) && "Precondition");
+
+    auto leaf_iter = leaves_.find(LeafKey(index));
+    if (leaf_iter == leaves_.end()) {
+      leaf_iter = leaves_.emplace(
+        LeafKey(index),
+        std::vector<T>(LeafCellCount(), unset_cell_)).first;
+    }
+    return leaf_iter->second[LeafCellIndex(index)];
+  }
+
+  //! Returns a const reference to the cell at @a index. Never allocates
+  //! leaves, cells in unallocated leaves are not frozen.
+  //!
+  //! Preconditions:
+  //! - @a index is inside the grid.
+  T const& Cell(IndexType const& index) const
+  {
+    assert(detail::Inside(index, size_) && "Precondition");
+
+    auto const leaf_iter = leaves_.find(LeafKey(index));
+    if (leaf_iter == leaves_.end()) {
+      return unset_cell_;
+    }
+    return leaf_iter->second[LeafCellIndex(index)];
+  }
+
+  //! Returns the integer coordinates of the first cell in each allocated
+  //! leaf, in the order of the cells in a dense buffer.
+  std::vector<IndexType> LeafOrigins() const
+  {
+    using namespace std;
+
+    auto leaf_keys = vector<size_t>();
+    leaf_keys.reserve(leaves_.size());
+    for (auto const& leaf : leaves_) {
+      leaf_keys.push_back(leaf.first);
+    }
+    sort(begin(leaf_keys), end(leaf_keys));
+
+    auto leaf_origins = vector<IndexType>();
+    leaf_origins.reserve(leaf_keys.size());
+    for (auto const leaf_key : leaf_keys) {
+      leaf_origins.push_back(LeafOrigin(leaf_key));
+    }
+    return leaf_origins;
+  }
+
+  //! Call @a visitor as visitor(index, time) for every frozen cell, i.e.
+  //! every cell whose arrival time has been set. Cells are visited leaf by
+  //! leaf, in no particular order.
+  template<typename V>
+  void ForEachFrozenCell(V&& visitor) const
+  {
+    using namespace std;
+
+    auto const leaf_size = detail::FilledArray<size_t, N>(kLeafWidth);
+    for (auto const& leaf : leaves_) {
+      auto const leaf_origin = LeafOrigin(leaf.first);
+      for (auto i = size_t{0}; i < leaf.second.size(); ++i) {
+        auto const time = leaf.second[i];
+        if (!detail::Frozen(time)) {
+          continue;
+        }
+        auto index = detail::GridIndex(i, leaf_size);
+        for (auto j = size_t{0}; j < N; ++j) {
+          index[j] += leaf_origin[j];
+        }
+        // Leaves at the upper grid faces are not frozen outside the grid.
+        assert(detail::Inside(index, size_));
+        visitor(index, time);
+      }
+    }
+  }
+
+  //! Returns the cells in a dense buffer, laid out as for the other arrival
+  //! time functions. Cells that have not been set are given @a unset_time.
+  std::vector<T> DenseBuffer(
+    T const unset_time = std::numeric_limits<T>::max()) const
+  {
+    using namespace std;
+
+    auto buffer = vector<T>(detail::LinearSize(size_), unset_time);
+    auto const strides = detail::GridStrides(size_);
+    ForEachFrozenCell([&](auto const& index, auto const time) {
+      buffer[detail::GridLinearIndex(index, strides)] = time;
+    });
+    return buffer;
+  }
+
+private:
+  std::size_t LeafKey(IndexType const& index) const
+  {
+    auto leaf_index = index;
+    for (auto i = std::size_t{0}; i < N; ++i) {
+      leaf_index[i] /= kLeafWidth;
+    }
+    return detail::GridLinearIndex(leaf_index, leaf_grid_strides_);
+  }
+
+  std::size_t LeafCellIndex(IndexType const& index) const
+  {
+    auto cell_index = index;
+    for (auto i = std::size_t{0}; i < N; ++i) {
+      cell_index[i] %= kLeafWidth;
+    }
+    return detail::GridLinearIndex(cell_index, leaf_strides_);
+  }
+
+  IndexType LeafOrigin(std::size_t const leaf_key) const
+  {
+    auto leaf_origin = detail::GridIndex(leaf_key, leaf_grid_size_);
+    for (auto i = std::size_t{0}; i < N; ++i) {
+      leaf_origin[i] *= kLeafWidth;
+    }
+    return leaf_origin;
+  }
+
+  SizeType size_;
+  SizeType leaf_grid_size_;
+  std::array<std::size_t, N - 1> leaf_grid_strides_;
+  std::array<std::size_t, N - 1> leaf_strides_;
+  T unset_cell_;
+  std::unordered_map<std::size_t, std::vector<T>> leaves_;
+};
+
+
+//! Writes the cells of a grid to a self-describing binary file, which
+//! stores the grid size, grid spacing, scalar type and byte order along
+//! with the cells. Files can be read with ReadGridFile, and uncompressed
+//! files can be memory-mapped with GridFileView.
+//!
+//! Cells are grouped into tiles of consecutive cells, in the order of the
+//! cells in a std::vector buffer. Each tile is written, optionally
+//! run-length encoded, as soon as all of its cells have been set, after
+//! which its memory is released. Cells can be set in any order, so a writer
+//! can be passed directly as the frozen cell visitor when marching, e.g. to
+//! GeodesicArrivalTime. Memory use is then bounded by the tiles that the
+//! front has entered but not yet passed. When cells are written in order,
+//! see Write, at most one tile is held in memory.
+//!
+//! The file is complete only once Close has returned.
+template<typename T, std::size_t N>
+class GridFileWriter
+{
+public:
+  typedef std::array<std::size_t, N> SizeType;
+  typedef std::array<std::int32_t, N> IndexType;
+
+  //! Create (or truncate) the file at @a path for a grid of size @a size.
+  //!
+  //! Throws std::invalid_argument if @a size or @a grid_spacing is invalid,
+  //! or if @a tile_cell_count is zero.
+  //!
+  //! Throws std::runtime_error if the file cannot be created.
+  GridFileWriter(
+    std::string const& path,
+    SizeType const& size,
+    std::array<T, N> const& grid_spacing,
+    GridFileCompression const compression = GridFileCompression::kNone,
+    std::size_t const tile_cell_count = std::size_t{1} << 16)
+    : path_(path)
+    , strides_(detail::GridStrides(size))
+    , cell_count_(detail::LinearSize(size))
+    , tile_count_(0)
+    , set_cell_count_(0)
+    , next_linear_index_(0)
+    , next_tile_offset_(0)
+    , header_()
+  {
+    using namespace std;
+
+    detail::ThrowIfInvalidGridSpacing(grid_spacing);
+    if (tile_cell_count == 0) {
+      auto ss = stringstream();
+      ss << "invalid tile cell count: " << tile_cell_count;
+      throw invalid_argument(ss.str());
+    }
+
+    header_.scalar_type = detail::GridFileScalarType<T>();
+    header_.compression = compression;
+    header_.complete = false;
+    header_.tile_cell_count = tile_cell_count;
+    header_.grid_size = size;
+    for (auto i = size_t{0}; i < N; ++i) {
+      header_.grid_spacing[i] = static_cast<double>(grid_spacing[i]);
+    }
+    tile_count_ = detail::GridFileTileCount(cell_count_, tile_cell_count);
+
+    file_.open(path, ios::binary | ios::trunc);
+    if (!file_) {
+      detail::ThrowSystemError("failed to create grid file", path_);
+    }
+    WriteHeader();
+    if (compression == GridFileCompression::kRunLength) {
+      // Reserve space for the tile table, written when closing.
+      tile_table_.resize(tile_count_);
+      next_tile_offset_ =
+        detail::GridFileHeaderByteCount<N>() + 2 * 8 * tile_count_;
+    }
+  }
+
+  GridFileWriter(GridFileWriter const&) = delete;
+  GridFileWriter& operator=(GridFileWriter const&) = delete;
+
+  //! Set the cell at @a index to @a value. Allows the writer to be used as
+  //! a frozen cell visitor.
+  //!
+  //! Preconditions:
+  //! - @a index is inside the grid.
+  //! - Each cell is set exactly once.
+  void operator()(IndexType const& index, T const value)
+  {
+    assert(detail::Inside(index, header_.grid_size) && "Precondition");
+    SetCell(detail::GridLinearIndex(index, strides_), value);
+  }
+
+  //! Set the next @a cell_count cells in buffer order from @a cells,
+  //! starting after the cells set by previous calls.
+  //!
+  //! Preconditions:
+  //! - Cells are not also set using operator().
+  //! - There are at least @a cell_count cells left to set.
+  void Write(T const* const cells, std::size_t const cell_count)
+  {
+    assert(cells != nullptr && "Precondition");
+    assert(next_linear_index_ + cell_count <= cell_count_ && "Precondition");
+
+    for (auto i = std::size_t{0}; i < cell_count; ++i) {
+      SetCell(next_linear_index_++, cells[i]);
+    }
+  }
+
+  //! Write the tile table, if any, and mark the file as complete.
+  //!
+  //! Throws std::runtime_error if not all cells have been set, or if
+  //! writing to the file fails.
+  void Close()
+  {
+    using namespace std;
+
+    if (set_cell_count_ != cell_count_) {
+      auto ss = stringstream();
+      ss << "incomplete grid file '" << path_ << "': " << set_cell_count_
+         << " of " << cell_count_ << " cells set";
+      throw runtime_error(ss.str());
+    }
+    assert(open_tiles_.empty());
+
+    header_.complete = true;
+    WriteHeader();
+    for (auto const& tile_entry : tile_table_) {
+      file_.write(
+        reinterpret_cast<char const*>(&tile_entry.first),
+        sizeof(tile_entry.first));
+      file_.write(
+        reinterpret_cast<char const*>(&tile_entry.second),
+        sizeof(tile_entry.second));
+    }
+    file_.close();
+    if (!file_) {
+      detail::ThrowSystemError("failed to write grid file", path_);
+    }
+  }
+
+private:
+  //! Set the cell at @a linear_index, and write its tile if the tile is
+  //! complete.
+  void SetCell(std::size_t const linear_index, T const value)
+  {
+    using namespace std;
+
+    auto const tile_index = linear_index / header_.tile_cell_count;
+    auto tile_iter = open_tiles_.find(tile_index);
+    if (tile_iter == open_tiles_.end()) {
+      tile_iter = open_tiles_.emplace(
+        tile_index,
+        make_pair(size_t{0}, vector<T>(TileCellCount(tile_index)))).first;
+    }
+
+    auto& tile = tile_iter->second;
+    tile.second[linear_index - tile_index * header_.tile_cell_count] = value;
+    ++tile.first;
+    ++set_cell_count_;
+    if (tile.first == tile.second.size()) {
+      WriteTile(tile_index, tile.second);
+      open_tiles_.erase(tile_iter);
+    }
+  }
+
+  //! Returns the number of cells in the tile at @a tile_index. Only the
+  //! last tile can have fewer cells than the others.
+  std::size_t TileCellCount(std::size_t const tile_index) const
+  {
+    return std::min(
+      header_.tile_cell_count,
+      cell_count_ - tile_index * header_.tile_cell_count);
+  }
+
+  void WriteTile(std::size_t const tile_index, std::vector<T> const& tile_cells)
+  {
+    using namespace std;
+
+    if (header_.compression == GridFileCompression::kNone) {
+      // Uncompressed tiles are stored in order, so that the cells can be
+      // memory-mapped as a single buffer.
+      file_.seekp(static_cast<streamoff>(
+        detail::GridFileHeaderByteCount<N>() +
+        tile_index * header_.tile_cell_count * sizeof(T)));
+      file_.write(
+        reinterpret_cast<char const*>(tile_cells.data()),
+        static_cast<streamsize>(tile_cells.size() * sizeof(T)));
+    }
+    else {
+      // Compressed tiles are stored in the order they are completed.
+      auto const bytes = detail::RunLengthEncodedTile(tile_cells);
+      file_.seekp(static_cast<streamoff>(next_tile_offset_));
+      file_.write(bytes.data(), static_cast<streamsize>(bytes.size()));
+      tile_table_[tile_index] = {next_tile_offset_, bytes.size()};
+      next_tile_offset_ += bytes.size();
+    }
+    if (!file_) {
+      detail::ThrowSystemError("failed to write grid file", path_);
+    }
+  }
+
+  void WriteHeader()
+  {
+    auto const bytes = detail::GridFileHeaderBytes(header_);
+    file_.seekp(0);
+    file_.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!file_) {
+      detail::ThrowSystemError("failed to write grid file", path_);
+    }
+  }
+
+  std::string const path_;
+  std::array<std::size_t, N - 1> const strides_;
+  std::size_t const cell_count_;
+  std::size_t tile_count_;
+  std::size_t set_cell_count_;
+  std::size_t next_linear_index_;
+  std::uint64_t next_tile_offset_;
+  detail::GridFileHeader<N> header_;
+  std::unordered_map<std::size_t, std::pair<std::size_t, std::vector<T>>>
+    open_tiles_;
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> tile_table_;
+  std::ofstream file_;
+};
+
+
+//! The contents of a grid file, see ReadGridFile.
+template<typename T, std::size_t N>
+struct GridFileContents
+{
+  std::array<std::size_t, N> grid_size;
+  std::array<T, N> grid_spacing;
+  std::vector<T> cells;
+};
+
+
+//! Returns the contents of the grid file at @a path, see GridFileWriter.
+//! The file is read one tile at a time, decompressing tiles as needed.
+//!
+//! Throws std::runtime_error if the file cannot be read, or if it is not a
+//! complete N-dimensional grid file with cells of type T written with the
+//! same byte order.
+template<typename T, std::size_t N>
+GridFileContents<T, N> ReadGridFile(std::string const& path)
+{
+  using namespace std;
+  using namespace detail;
+
+  auto file = ifstream(path, ios::binary);
+  if (!file) {
+    ThrowSystemError("failed to open grid file", path);
+  }
+  auto const header_byte_count = GridFileHeaderByteCount<N>();
+  auto header_bytes = vector<char>(header_byte_count);
+  file.read(header_bytes.data(), static_cast<streamsize>(header_byte_count));
+  auto const header = ParseGridFileHeader<T, N>(
+    header_bytes.data(),
+    static_cast<size_t>(file.gcount()),
+    path);
+
+  auto contents = GridFileContents<T, N>();
+  contents.grid_size = header.grid_size;
+  for (auto i = size_t{0}; i < N; ++i) {
+    contents.grid_spacing[i] = static_cast<T>(header.grid_spacing[i]);
+  }
+  auto const cell_count = LinearSize(header.grid_size);
+  contents.cells.resize(cell_count);
+
+  auto const tile_count =
+    GridFileTileCount(cell_count, header.tile_cell_count);
+  auto tile_table = vector<pair<uint64_t, uint64_t>>(tile_count);
+  if (header.compression == GridFileCompression::kRunLength) {
+    for (auto& tile_entry : tile_table) {
+      file.read(
+        reinterpret_cast<char*>(&tile_entry.first),
+        sizeof(tile_entry.first));
+      file.read(
+        reinterpret_cast<char*>(&tile_entry.second),
+        sizeof(tile_entry.second));
+    }
+    if (!file) {
+      ThrowInvalidGridFile(path, "truncated");
+    }
+  }
+
+  auto tile_bytes = vector<char>();
+  for (auto tile_index = size_t{0}; tile_index < tile_count; ++tile_index) {
+    auto const first_cell = tile_index * header.tile_cell_count;
+    auto const tile_cell_count =
+      min(header.tile_cell_count, cell_count - first_cell);
+    auto const tile_cells = contents.cells.data() + first_cell;
+    if (header.compression == GridFileCompression::kNone) {
+      file.read(
+        reinterpret_cast<char*>(tile_cells),
+        static_cast<streamsize>(tile_cell_count * sizeof(T)));
+      if (!file) {
+        ThrowInvalidGridFile(path, "truncated");
+      }
+    }
+    else {
+      // Encoded tiles are never larger than one run per cell.
+      if (tile_table[tile_index].second >
+          tile_cell_count * (sizeof(uint32_t) + sizeof(T))) {
+        ThrowInvalidGridFile(path, "corrupt tile");
+      }
+      tile_bytes.resize(static_cast<size_t>(tile_table[tile_index].second));
+      file.seekg(static_cast<streamoff>(tile_table[tile_index].first));
+      file.read(tile_bytes.data(), static_cast<streamsize>(tile_bytes.size()));
+      if (!file) {
+        ThrowInvalidGridFile(path, "truncated");
+      }
+      DecodeRunLengthTile(
+        tile_bytes.data(),
+        tile_bytes.size(),
+        tile_cell_count,
+        path,
+        tile_cells);
+    }
+  }
+  return contents;
+}
+
+
+#if defined(__unix__) || defined(__APPLE__)
+
+//! Read-only view of the cells in an uncompressed grid file, see
+//! GridFileWriter. The file is memory-mapped, so cells are not copied and
+//! are paged in by the operating system as they are accessed. The view can
+//! be used as the speed grid of the varying speed eikonal solvers.
+template<typename T, std::size_t N>
+class GridFileView
+{
+public:
+  typedef T CellType;
+  typedef std::array<std::size_t, N> SizeType;
+
+  //! Map the grid file at @a path.
+  //!
+  //! Throws std::runtime_error if the file cannot be opened or mapped, if
+  //! it is compressed, or if it is not a complete N-dimensional grid file
+  //! with cells of type T written with the same byte order.
+  explicit GridFileView(std::string const& path)
+    : header_()
+    , file_byte_count_(0)
+    , file_bytes_(nullptr)
+  {
+    using namespace std;
+    using namespace detail;
+
+    auto const file_descriptor = ::open(path.c_str(), O_RDONLY);
+    if (file_descriptor == -1) {
+      ThrowSystemError("failed to open grid file", path);
+    }
+
+    // Check the header before mapping the file.
+    auto header_bytes = vector<char>(GridFileHeaderByteCount<N>());
+    auto const header_byte_count = ::pread(
+      file_descriptor, header_bytes.data(), header_bytes.size(), 0);
+    struct stat file_status;
+    if (header_byte_count == -1 ||
+        ::fstat(file_descriptor, &file_status) != 0) {
+      auto const error_number = errno;
+      ::close(file_descriptor);
+      ThrowSystemError("failed to read grid file", path, error_number);
+    }
+    try {
+      header_ = ParseGridFileHeader<T, N>(
+        header_bytes.data(),
+        static_cast<size_t>(header_byte_count),
+        path);
+      if (header_.compression != GridFileCompression::kNone) {
+        ThrowInvalidGridFile(path, "compressed files cannot be mapped");
+      }
+      file_byte_count_ = static_cast<size_t>(file_status.st_size);
+      if (file_byte_count_ < GridFileHeaderByteCount<N>() +
+                             cell_count() * sizeof(T)) {
+        ThrowInvalidGridFile(path, "truncated");
+      }
+    }
+    catch (...) {
+      ::close(file_descriptor);
+      throw;
+    }
+
+    auto const address = ::mmap(
+      nullptr,
+      file_byte_count_,
+      PROT_READ,
+      MAP_SHARED,
+      file_descriptor,
+      0);
+    auto const error_number = errno;
+    // The mapping keeps a reference to the file.
+    ::close(file_descriptor);
+    if (address == MAP_FAILED) {
+      ThrowSystemError("failed to map grid file", path, error_number);
+    }
+    file_bytes_ = static_cast<char const*>(address);
+  }
+
+  ~GridFileView()
+  {
+    ::munmap(const_cast<char*>(file_bytes_), file_byte_count_);
+  }
+
+  GridFileView(GridFileView const&) = delete;
+  GridFileView& operator=(GridFileView const&) = delete;
+
+  //! Returns the size of the grid.
+  SizeType size() const
+  {
+    return header_.grid_size;
+  }
+
+  //! Returns the grid spacing stored in the file.
+  std::array<T, N> grid_spacing() const
+  {
+    auto grid_spacing = std::array<T, N>();
+    for (auto i = std::size_t{0}; i < N; ++i) {
+      grid_spacing[i] = static_cast<T>(header_.grid_spacing[i]);
+    }
+    return grid_spacing;
+  }
+
+  //! Returns the number of cells in the grid.
+  std::size_t cell_count() const
+  {
+    return detail::LinearSize(header_.grid_size);
+  }
+
+  //! Returns a pointer to the first cell. Cells are laid out as in a
+  //! std::vector buffer for a grid of the same size.
+  T const* data() const
+  {
+    return reinterpret_cast<T const*>(
+      file_bytes_ + detail::GridFileHeaderByteCount<N>());
+  }
+
+private:
+  detail::GridFileHeader<N> header_;
+  std::size_t file_byte_count_;
+  char const* file_bytes_;
+};
+
+#endif // defined(__unix__) || defined(__APPLE__)
+
+
+//! Provides methods for solving the eikonal equation for a single grid cell
+//! at a time using the current distance grid. Uses a uniform speed for
+//! the entire grid.
+//!
+//! Arrival times are stored using type T, while the eikonal equation is
+//! solved using type C (defaults to T). For instance, using float for T and
+//! double for C gives double precision solves at the memory cost of float
+//! arrival time grids.
+template<typename T, std::size_t N, typename C = T>
+class UniformSpeedEikonalSolver :
+  public detail::UniformSpeedEikonalSolverBase<T, N>
+{
+public:
+  typedef C ComputeType;
+
+  //! Solve only reads face-neighbors, see UpdateGeodesicArrivalTime.
+  static std::size_t const kStencilReach = 1;
+
+  explicit UniformSpeedEikonalSolver(
+    std::array<T, N> const& grid_spacing,
+    T const uniform_speed = T{1})
+    : detail::UniformSpeedEikonalSolverBase<T, N>(grid_spacing, uniform_speed)
+  {}
+
+  //! Returns the distance for grid cell at @a index given the current
+  //! distances (@a distance_grid) of other cells.
+  template<typename G>
+  T Solve(
+    std::array<std::int32_t, N> const& index,
+    G const& distance_grid) const
+  {
+    auto value_accumulator = detail::NullValueAccumulator();
+    return Solve(index, distance_grid, value_accumulator);
+  }
+
+  //! Same as above, also passing the upwind weights of the solution to
+  //! @a value_accumulator, see ExtendedSignedArrivalTime.
+  template<typename G, typename A>
+  T Solve(
+    std::array<std::int32_t, N> const& index,
+    G const& distance_grid,
+    A& value_accumulator) const
+  {
+    return detail::SolveEikonal<T, N, C>(
+      index,
+      distance_grid,
+      this->uniform_speed(),
+      this->grid_spacing(),
+      value_accumulator);
+  }
+};
+
+
+//! Provides methods for solving the eikonal equation for a single grid cell
+//! at a time using the current distance grid. Uses a uniform speed for
+//! the entire grid. When possible uses second order derivates to achieve
+//! better accuracy.
+//!
+//! Arrival times are stored using type T, while the eikonal equation is
+//! solved using type C (defaults to T).
+template <typename T, std::size_t N, typename C = T>
+class HighAccuracyUniformSpeedEikonalSolver :
+  public detail::UniformSpeedEikonalSolverBase<T, N>
+{
+public:
+  typedef C ComputeType;
+
+  //! Solve also reads cells two steps away along each dimension.
+  static std::size_t const kStencilReach = 2;
+
+  explicit HighAccuracyUniformSpeedEikonalSolver(
+    std::array<T, N> const& grid_spacing,
+    T const uniform_speed = T{1})
+    : detail::UniformSpeedEikonalSolverBase<T, N>(grid_spacing, uniform_speed)
+  {}
+
+  //! Returns the distance for grid cell at @a index given the current
+  //! distances (@a distance_grid) of other cells.
+  template<typename G>
+  T Solve(
+    std::array<std::int32_t, N> const& index,
+    G const& distance_grid) const
+  {
+    auto value_accumulator = detail::NullValueAccumulator();
+    return Solve(index, distance_grid, value_accumulator);
+  }
+
+  //! Same as above, also passing the upwind weights of the solution to
+  //! @a value_accumulator, see ExtendedSignedArrivalTime.
+  template<typename G, typename A>
+  T Solve(
+    std::array<std::int32_t, N> const& index,
+    G const& distance_grid,
+    A& value_accumulator) const
+  {
+    return detail::HighAccuracySolveEikonal<T, N, C>(
+      index,
+      distance_grid,
+      this->uniform_speed(),
+      this->grid_spacing(),
+      value_accumulator);
+  }
+};
+
+
+//! Provides methods for solving the eikonal equation for a single grid cell
+//! at a time using the current distance grid. A speed grid must be provided
+//! and that grid must cover the arrival time grid.
+//!
+//! Arrival times and speeds are stored using type T, while the eikonal
+//! equation is solved using type C (defaults to T).
+template <typename T, std::size_t N, typename C = T>
+class VaryingSpeedEikonalSolver :
+  public detail::VaryingSpeedEikonalSolverBase<T, N>
+{
+public:
+  typedef C ComputeType;
+
+  //! Solve only reads face-neighbors, see UpdateGeodesicArrivalTime.
+  static std::size_t const kStencilReach = 1;
+
+  VaryingSpeedEikonalSolver(
+    std::array<T, N> const& grid_spacing,
+    std::array<std::size_t, N> const& speed_grid_size,
+    std::vector<T> const& speed_buffer)
+    : detail::VaryingSpeedEikonalSolverBase<T, N>(
+        grid_spacing, speed_grid_size, speed_buffer)
+  {}
+
+#if defined(__unix__) || defined(__APPLE__)
+  //! Use the speeds in @a speed_grid, which must outlive the solver. The
+  //! speeds are not copied.
+  VaryingSpeedEikonalSolver(
+    std::array<T, N> const& grid_spacing,
+    MappedGrid<T, N> const& speed_grid)
+    : detail::VaryingSpeedEikonalSolverBase<T, N>(
+        grid_spacing,
+        speed_grid.size(),
+        speed_grid.data(),
+        speed_grid.cell_count())
+  {}
+
+  //! Use the speeds and grid spacing in the grid file viewed by
+  //! @a speed_file, which must outlive the solver.
+  explicit VaryingSpeedEikonalSolver(GridFileView<T, N> const& speed_file)
+    : detail::VaryingSpeedEikonalSolverBase<T, N>(
+        speed_file.grid_spacing(),
+        speed_file.size(),
+        speed_file.data(),
+        speed_file.cell_count())
+  {}
+#endif
+
+  //! Returns the distance for grid cell at @a index given the current
+  //! distances (@a distance_grid) of other cells.
+  template<typename G>
+  T Solve(
+    std::array<std::int32_t, N> const& index,
+    G const& distance_grid) const
+  {
+    auto value_accumulator = detail::NullValueAccumulator();
+    return Solve(index, distance_grid, value_accumulator);
+  }
+
+  //! Same as above, also passing the upwind weights of the solution to
+  //! @a value_accumulator, see ExtendedSignedArrivalTime.
+  template<typename G, typename A>
+  T Solve(
+    std::array<std::int32_t, N> const& index,
+    G const& distance_grid,
+    A& value_accumulator) const
+  {
+    return detail::SolveEikonal<T, N, C>(
+      index,
+      distance_grid,
+      this->Speed(index),
+      this->grid_spacing(),
+      value_accumulator);
+  }
+};
+
+
+//! Provides methods for solving the eikonal equation for a single grid cell
+//! at a time using the current distance grid. A speed grid must be provided
+//! and that grid must cover the arrival time grid. When possible uses second
+//! order derivates to achieve better accuracy.
+//!
+//! Arrival times and speeds are stored using type T, while the eikonal
+//! equation is solved using type C (defaults to T).
+template <typename T, std::size_t N, typename C = T>
+class HighAccuracyVaryingSpeedEikonalSolver :
+  public detail::VaryingSpeedEikonalSolverBase<T, N>
+{
+public:
+  typedef C ComputeType;
+
+  //! Solve also reads cells two steps away along each dimension.
+  static std::size_t const kStencilReach = 2;
+
+  HighAccuracyVaryingSpeedEikonalSolver(
+    std::array<T, N> const& grid_spacing,
+    std::array<std::size_t, N> const& speed_grid_size,
+    std::vector<T> const& speed_buffer)
+    : detail::VaryingSpeedEikonalSolverBase<T, N>(
+        grid_spacing, speed_grid_size, speed_buffer)
+  {}
+
+#if defined(__unix__) || defined(__APPLE__)
+  //! Use the speeds in @a speed_grid, which must outlive the solver. The
+  //! speeds are not copied.
+  HighAccuracyVaryingSpeedEikonalSolver(
+    std::array<T, N> const& grid_spacing,
+    MappedGrid<T, N> const& speed_grid)
+    : detail::VaryingSpeedEikonalSolverBase<T, N>(
+        grid_spacing,
+        speed_grid.size(),
+        speed_grid.data(),
+        speed_grid.cell_count())
+  {}
+
+  //! Use the speeds and grid spacing in the grid file viewed by
+  //! @a speed_file, which must outlive the solver.
+  explicit HighAccuracyVaryingSpeedEikonalSolver(
+    GridFileView<T, N> const& speed_file)
+    : detail::VaryingSpeedEikonalSolverBase<T, N>(
+        speed_file.grid_spacing(),
+        speed_file.size(),
+        speed_file.data(),
+        speed_file.cell_count())
+  {}
+#endif
+
+  //! Returns the distance for grid cell at @a index given the current
+  //! distances (@a distance_grid) of other cells.
+  template<typename G>
+  T Solve(
+    std::array<std::int32_t, N> const& index,
+    G const& distance_grid) const
+  {
+    auto value_accumulator = detail::NullValueAccumulator();
+    return Solve(index, distance_grid, value_accumulator);
+  }
+
+  //! Same as above, also passing the upwind weights of the solution to
+  //! @a value_accumulator, see ExtendedSignedArrivalTime.
+  template<typename G, typename A>
+  T Solve(
+    std::array<std::int32_t, N> const& index,
+    G const& distance_grid,
+    A& value_accumulator) const
+  {
+    return detail::HighAccuracySolveEikonal<T, N, C>(
+      index,
+      distance_grid,
+      this->Speed(index),
+      this->grid_spacing(),
+      value_accumulator);
+  }
+};
+
+
+//! Provides methods for solving the eikonal equation for a single grid cell
+//! at a time using the current distance grid. The speed is assumed to be
+//! one for the entire grid, meaning that arrival time can be interpreted
+//! as distance.
+//!
+//! Note: Currently only supports uniform grid spacing.
+template<typename T, std::size_t N>
+class DistanceSolver
+{
+public:
+  typedef T ScalarType;
+  static std::size_t const kDimension = N;
+
+  //! Solve only reads face-neighbors, see UpdateGeodesicArrivalTime.
+  static std::size_t const kStencilReach = 1;
+
+  explicit DistanceSolver(T const dx)
+    : dx_(dx)
+  {
+    detail::ThrowIfInvalidGridSpacing(detail::FilledArray<T, N>(dx_));
+  }
+
+  //! Returns the distance for grid cell at @a index given the current
+  //! distances (@a distance_grid) of other cells.
+  template<typename G>
+  T Solve(
+    std::array<std::int32_t, N> const& index,
+    G const& distance_grid) const
+  {
+    auto value_accumulator = detail::NullValueAccumulator();
+    return Solve(index, distance_grid, value_accumulator);
+  }
+
+  //! Same as above, also passing the upwind weights of the solution to
+  //! @a value_accumulator, see ExtendedSignedArrivalTime.
+  template<typename G, typename A>
+  T Solve(
+    std::array<std::int32_t, N> const& index,
+    G const& distance_grid,
+    A& value_accumulator) const
+  {
+    return detail::SolveDistance(
+      index,
+      distance_grid,
+      dx_,
+      value_accumulator);
+  }
+
+private:
+  T const dx_;
+};
+
+
+//! Admissible heuristic for HeuristicTargetArrivalTime. Returns the
+//! euclidean distance from a cell to the target cell divided by the
+//! maximum speed in the grid, which is a lower bound on the arrival time
+//! difference between the two cells, scaled by a weight in [0, 1].
+//!
+//! The default weight of zero freezes cells in order of arrival time, so
+//! that the result is exactly that of TargetArrivalTime. Larger weights
+//! are opt-in and freeze fewer cells, but then cells close to the line
+//! towards the target are often frozen before their upwind neighbors on
+//! the sides, which makes the eikonal solver fall back to fewer dimensions
+//! and the arrival time at the target too large. A weight of one half
+//! typically keeps the result within a fraction of a percent of plain
+//! marching while freezing half as many cells.
+template<typename T, std::size_t N>
+class DistanceHeuristic
+{
+public:
+  typedef T ScalarType;
+  static std::size_t const kDimension = N;
+
+  //! Throws std::invalid_argument if:
+  //! - Any element of @a grid_spacing is zero, negative or NaN, or
+  //! - @a max_speed is zero, negative or NaN, or
+  //! - @a weight is not in [0, 1].
+  DistanceHeuristic(
+    std::array<std::int32_t, N> const& target_index,
+    std::array<T, N> const& grid_spacing,
+    T const max_speed,
+    T const weight = T{0})
+    : target_index_(target_index)
+    , grid_spacing_(grid_spacing)
+    , max_speed_(max_speed)
+    , weight_(weight)
+  {
+    using namespace std;
+
+    detail::ThrowIfInvalidGridSpacing(grid_spacing_);
+    detail::ThrowIfZeroOrNegativeOrNanSpeed(max_speed_);
+    if (!(T{0} <= weight_ && weight_ <= T{1})) {
+      auto ss = stringstream();
+      ss << "invalid heuristic weight: " << weight_;
+      throw invalid_argument(ss.str());
+    }
+  }
+
+  //! Returns a lower bound on the arrival time difference between the cell
+  //! at @a index and the target cell.
+  T operator()(std::array<std::int32_t, N> const& index) const
+  {
+    using namespace std;
+
+    auto sum = T{0};
+    for (auto i = size_t{0}; i < N; ++i) {
+      auto const d = (index[i] - target_index_[i]) * grid_spacing_[i];
+      sum += d * d;
+    }
+    return weight_ * sqrt(sum) / max_speed_;
+  }
+
+private:
+  std::array<std::int32_t, N> const target_index_;
+  std::array<T, N> const grid_spacing_;
+  T const max_speed_;
+  T const weight_;
+};
+
+
+//! Encodes arrival times as IEEE 754 half precision floating point values,
+//! stored as their 16-bit patterns. Half precision has 11 significant bits,
+//! which gives a relative precision of about 5e-4. Arrival times larger
+//! than 65504 are encoded as infinity.
+template<typename T>
+class HalfPrecisionEncoder
+{
+public:
+  typedef std::uint16_t ValueType;
+
+  //! Returns the half precision bit pattern closest to @a time.
+  ValueType operator()(T const time) const
+  {
+    return detail::HalfFromFloat(static_cast<float>(time));
+  }
+
+  //! Returns the arrival time represented by the bit pattern @a value.
+  T Decode(ValueType const value) const
+  {
+    return static_cast<T>(detail::FloatFromHalf(value));
+  }
+};
+
+
+//! Encodes arrival times as 16-bit fixed point values, where one unit
+//! corresponds to @a scale. Times are clamped to the band
+//! [-clamp_time, clamp_time] before being encoded, so that times far from
+//! the interface saturate instead of wrapping around.
+template<typename T>
+class FixedPointEncoder
+{
+public:
+  typedef std::int16_t ValueType;
+
+  //! Throws an std::invalid_argument exception if:
+  //! - @a scale is not strictly positive, or
+  //! - @a clamp_time is not strictly positive, or
+  //! - @a clamp_time cannot be represented using @a scale.
+  FixedPointEncoder(T const scale, T const clamp_time)
+    : scale_(scale)
+    , clamp_time_(clamp_time)
+  {
+    using namespace std;
+
+    static_assert(is_floating_point<T>::value,
+                  "scalar type must be floating point");
+
+    if (!(scale_ > T{0} && detail::Frozen(scale_))) {
+      auto ss = stringstream();
+      ss << "invalid fixed point scale: " << scale_;
+      throw invalid_argument(ss.str());
+    }
+    if (!(clamp_time_ > T{0} &&
+          clamp_time_ / scale_ <= T{numeric_limits<ValueType>::max()})) {
+      auto ss = stringstream();
+      ss << "invalid fixed point clamp time: " << clamp_time_;
+      throw invalid_argument(ss.str());
+    }
+  }
+
+  //! Returns the fixed point value closest to @a time, after clamping.
+  ValueType operator()(T const time) const
+  {
+    using namespace std;
+
+    auto const clamped_time = max(-clamp_time_, min(clamp_time_, time));
+    return static_cast<ValueType>(lround(clamped_time / scale_));
+  }
+
+  //! Returns the arrival time represented by the fixed point @a value.
+  T Decode(ValueType const value) const
+  {
+    return value * scale_;
+  }
+
+private:
+  T const scale_;
+  T const clamp_time_;
+};
+
+
+//! Compute the signed distance on a grid.
+//!
+//! Input:
+//!   grid_size          - Number of grid cells in each dimension.
+//!   boundary_indices   - Integer coordinates of cells with provided distances.
+//!   boundary_distances - Signed distances assigned to boundary cells.
+//!
+//! Preconditions:
+//!   - grid_size may not have a zero element.
+//!   - frozen_indices, frozen_distances and normals must have the same size.
+//!   - frozen_indices must all be within size.
+//!
+//! TODO - example usage!
+template<typename T, std::size_t N, typename EikonalSolverType>
+std::vector<T> SignedArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver)
+{
+  using namespace std;
+  using namespace detail;
+
+  typedef T TimeType;
+
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t);
+  };
+  auto constexpr negative_inside = true;
+  auto frozen_cell_visitor = NullFrozenCellVisitor();
+  return ArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    boundary_time_predicate,
+    negative_inside,
+    numeric_limits<T>::max(), // max_time
+    numeric_limits<T>::max(), // far_time
+    frozen_cell_visitor);
+#if 0
+
+  detail::ThrowIfInvalidSize(grid_size);
+  detail::ThrowIfEmptyBoundaryIndices(boundary_indices);
+  std::for_each(
+    begin(boundary_indices),
+    end(boundary_indices),
+    [=](auto const& boundary_index) {
+      detail::ThrowIfBoundaryIndexOutsideGrid(boundary_index, grid_size);
+  });
+
+  auto narrow_band_indices = detail::OutsideInsideNarrowBandIndices(
+    boundary_indices,
+    grid_size);
+  auto outside_narrow_band_indices = narrow_band_indices.first;
+  auto inside_narrow_band_indices = narrow_band_indices.second;
+
+  return detail::SignedDistance(
+    grid_size,
+    boundary_indices,
+    boundary_distances,
+    inside_narrow_band_indices,
+    outside_narrow_band_indices,
+    eikonal_solver);
+#endif
+}
+
+
+//! Compute the signed arrival time on a grid, see SignedArrivalTime, but
+//! only march the cells with arrival times (in absolute value) up to
+//! @a max_time. All other cells are assigned @a far_time, with negative sign
+//! for inside cells. Since marching stops as soon as the smallest time in
+//! the narrow band exceeds @a max_time, the number of eikonal solves is
+//! proportional to the volume of the band around the boundary rather than
+//! the volume of the grid.
+//!
+//! Throws std::invalid_argument if:
+//! - @a max_time is NaN or negative, or
+//! - @a far_time is not finite or not larger than @a max_time.
+template<typename T, std::size_t N, typename EikonalSolverType>
+std::vector<T> SignedArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  T const max_time,
+  T const far_time)
+{
+  using namespace std;
+  using namespace detail;
+
+  ThrowIfInvalidMaxTime(max_time, far_time);
+
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t);
+  };
+  auto constexpr negative_inside = true;
+  auto frozen_cell_visitor = NullFrozenCellVisitor();
+  return ArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    boundary_time_predicate,
+    negative_inside,
+    max_time,
+    far_time,
+    frozen_cell_visitor);
+}
+
+
+//! Compute the signed arrival time on a grid from an existing level set
+//! @a phi, e.g. to reinitialize a level set that is no longer a signed
+//! distance. Cells where @a phi is negative are inside.
+//!
+//! Input:
+//!   grid_size      - Number of grid cells in each dimension.
+//!   grid_spacing   - Grid cell size in each dimension.
+//!   phi            - Level set values, one per grid cell.
+//!   eikonal_solver - Solver used to propagate arrival times.
+//!
+//! The boundary cells are the cells next to a zero crossing of @a phi.
+//! Their times are set to the distance to the zero crossing, found by
+//! linear interpolation of @a phi, so to get a signed distance the
+//! @a eikonal_solver should use unit speed and the same grid spacing.
+//! Since every cell next to the zero level set is a boundary cell, there
+//! is no need for the inside/outside analysis done by SignedArrivalTime,
+//! inside and outside cells are marched together and given the sign of
+//! @a phi.
+//!
+//! Throws std::invalid_argument if:
+//! - The size of @a phi does not match @a grid_size, or
+//! - Any element in @a grid_spacing is invalid, or
+//! - Any value of @a phi is NaN, or
+//! - There are no zero crossings in @a phi.
+template<typename T, std::size_t N, typename EikonalSolverType>
+std::vector<T> ReinitializedSignedArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::array<T, N> const& grid_spacing,
+  std::vector<T> const& phi,
+  EikonalSolverType const& eikonal_solver)
+{
+  using namespace std;
+  using namespace detail;
+
+  return ReinitializedArrivalTime(
+    grid_size,
+    grid_spacing,
+    phi,
+    eikonal_solver,
+    numeric_limits<T>::max(), // max_time
+    numeric_limits<T>::max()); // far_time
+}
+
+
+//! Compute the signed arrival time on a grid from an existing level set
+//! @a phi, see ReinitializedSignedArrivalTime, but only march the cells
+//! with arrival times (in absolute value) up to @a max_time. All other
+//! cells are assigned @a far_time with the sign of @a phi. Only a band
+//! around the zero level set is marched, which is typically all that is
+//! needed when reinitializing level sets.
+//!
+//! Throws std::invalid_argument if:
+//! - @a max_time is NaN or negative, or
+//! - @a far_time is not finite or not larger than @a max_time, or
+//! - Any of the conditions in ReinitializedSignedArrivalTime.
+template<typename T, std::size_t N, typename EikonalSolverType>
+std::vector<T> ReinitializedSignedArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::array<T, N> const& grid_spacing,
+  std::vector<T> const& phi,
+  EikonalSolverType const& eikonal_solver,
+  T const max_time,
+  T const far_time)
+{
+  using namespace std;
+  using namespace detail;
+
+  ThrowIfInvalidMaxTime(max_time, far_time);
+
+  return ReinitializedArrivalTime(
+    grid_size,
+    grid_spacing,
+    phi,
+    eikonal_solver,
+    max_time,
+    far_time);
+}
+
+
+//! Compute the signed arrival time on a grid, see SignedArrivalTime, and
+//! call @a frozen_cell_visitor as frozen_cell_visitor(index, time) for
+//! every cell in the grid as soon as its final signed time is known. This
+//! allows post-processing, e.g. thresholding or histogramming, to be fused
+//! into the march instead of making another pass over the returned times.
+//! Each cell is visited exactly once. Inside cells are visited before
+//! outside cells, and within each of these in order of increasing absolute
+//! time, except for the boundary cells, which are visited first.
+template<
+  typename T,
+  std::size_t N,
+  typename EikonalSolverType,
+  typename FrozenCellVisitorType>
+std::vector<T> SignedArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  FrozenCellVisitorType&& frozen_cell_visitor)
+{
+  using namespace std;
+  using namespace detail;
+
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t);
+  };
+  auto constexpr negative_inside = true;
+  return ArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    boundary_time_predicate,
+    negative_inside,
+    numeric_limits<T>::max(), // max_time
+    numeric_limits<T>::max(), // far_time
+    frozen_cell_visitor);
+}
+
+
+//! Compute the signed arrival time on a grid up to @a max_time, see
+//! SignedArrivalTime, and call @a frozen_cell_visitor for every cell in the
+//! grid as soon as its final signed time is known. Cells that are not
+//! reached are visited with @a far_time (negated inside) after the cells
+//! that were reached.
+//!
+//! Throws std::invalid_argument if:
+//! - @a max_time is NaN or negative, or
+//! - @a far_time is not finite or not larger than @a max_time.
+template<
+  typename T,
+  std::size_t N,
+  typename EikonalSolverType,
+  typename FrozenCellVisitorType>
+std::vector<T> SignedArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  T const max_time,
+  T const far_time,
+  FrozenCellVisitorType&& frozen_cell_visitor)
+{
+  using namespace std;
+  using namespace detail;
+
+  ThrowIfInvalidMaxTime(max_time, far_time);
+
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t);
+  };
+  auto constexpr negative_inside = true;
+  return ArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    boundary_time_predicate,
+    negative_inside,
+    max_time,
+    far_time,
+    frozen_cell_visitor);
+}
+
+
+//! Compute the signed arrival time on a grid, see SignedArrivalTime, and
+//! add the time spent in each phase and counts of the marching work to
+//! @a stats. Counting is only compiled into this overload, the overloads
+//! without stats have no overhead.
+//!
+//! Preconditions:
+//! - @a stats is not null.
+template<typename T, std::size_t N, typename EikonalSolverType>
+std::vector<T> SignedArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  ArrivalTimeStats* const stats)
+{
+  using namespace std;
+  using namespace detail;
+
+  assert(stats != nullptr && "Precondition");
+
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t);
+  };
+  auto constexpr negative_inside = true;
+  auto frozen_cell_visitor = NullFrozenCellVisitor();
+  auto narrow_band = NarrowBandStore<T, N>();
+  auto time_buffer = vector<T>(LinearSize(grid_size));
+  auto stats_recorder = ArrivalTimeStatsRecorder(stats);
+  ArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    boundary_time_predicate,
+    negative_inside,
+    numeric_limits<T>::max(), // max_time
+    numeric_limits<T>::max(), // far_time
+    frozen_cell_visitor,
+    &narrow_band,
+    time_buffer.data(),
+    stats_recorder);
+  return time_buffer;
+}
+
+
+#if defined(__unix__) || defined(__APPLE__)
+
+//! Compute the signed arrival time on a grid, see SignedArrivalTime, and
+//! store the times in the memory-mapped @a arrival_times, for grids that
+//! are larger than the available memory. Note that the inside/outside
+//! analysis of the boundary uses in-memory label grids with one byte per
+//! cell.
+//!
+//! Throws std::invalid_argument if:
+//! - The size of @a arrival_times does not match @a grid_size, or
+//! - The input is invalid, see SignedArrivalTime.
+//!
+//! Preconditions:
+//! - @a arrival_times is not null.
+template<typename T, std::size_t N, typename EikonalSolverType>
+void SignedArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  MappedGrid<T, N>* const arrival_times)
+{
+  using namespace std;
+  using namespace detail;
+
+  assert(arrival_times != nullptr && "Precondition");
+
+  ThrowIfInvalidCellBufferSize(grid_size, arrival_times->cell_count());
+
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t);
+  };
+  auto constexpr negative_inside = true;
+  auto frozen_cell_visitor = NullFrozenCellVisitor();
+  auto narrow_band = NarrowBandStore<T, N>();
+  auto stats_recorder = NullArrivalTimeStatsRecorder();
+  ArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    boundary_time_predicate,
+    negative_inside,
+    numeric_limits<T>::max(), // max_time
+    numeric_limits<T>::max(), // far_time
+    frozen_cell_visitor,
+    &narrow_band,
+    arrival_times->data(),
+    stats_recorder);
+}
+
+#endif // defined(__unix__) || defined(__APPLE__)
+
+
+//! Input for one of many independent signed arrival time computations,
+//! see BatchSignedArrivalTime.
+template<typename T, std::size_t N, typename EikonalSolverType>
+struct ArrivalTimeProblem
+{
+  std::array<std::size_t, N> grid_size;
+  std::vector<std::array<std::int32_t, N>> boundary_indices;
+  std::vector<T> boundary_times;
+  EikonalSolverType eikonal_solver;
+};
+
+
+//! Compute signed arrival times for many independent @a problems, see
+//! SignedArrivalTime, using up to @a thread_count threads.
+//!
+//! Returns one arrival time grid for each problem, in the same order as
+//! @a problems. Problems are handed out to threads one at a time, so that
+//! threads that finish early take on remaining problems. Each thread
+//! re-uses the memory of its narrow band for all problems it solves.
+//!
+//! Throws std::invalid_argument if:
+//! - @a thread_count is zero, or
+//! - Any of the problems is invalid, see SignedArrivalTime. An exception
+//!   thrown when solving a problem is re-thrown after all threads have
+//!   finished.
+template<typename T, std::size_t N, typename EikonalSolverType>
+std::vector<std::vector<T>> BatchSignedArrivalTime(
+  std::vector<ArrivalTimeProblem<T, N, EikonalSolverType>> const& problems,
+  std::size_t const thread_count)
+{
+  using namespace std;
+  using namespace detail;
+
+  ThrowIfZeroThreadCount(thread_count);
+
+  auto arrival_times = vector<vector<T>>(problems.size());
+  atomic<size_t> next_problem_index(0);
+  auto const solve_problems = [&]() {
+    auto const boundary_time_predicate = [](auto const t) {
+      return !isnan(t) && Frozen(t);
+    };
+    auto constexpr negative_inside = true;
+    auto frozen_cell_visitor = NullFrozenCellVisitor();
+    auto narrow_band = NarrowBandStore<T, N>();
+    for (auto i = next_problem_index++; i < problems.size();
+         i = next_problem_index++) {
+      auto const& problem = problems[i];
+      arrival_times[i] = ArrivalTime(
+        problem.grid_size,
+        problem.boundary_indices,
+        problem.boundary_times,
+        problem.eikonal_solver,
+        boundary_time_predicate,
+        negative_inside,
+        numeric_limits<T>::max(), // max_time
+        numeric_limits<T>::max(), // far_time
+        frozen_cell_visitor,
+        &narrow_band);
+    }
+  };
+
+  RunOnThreads(
+    max(min(thread_count, problems.size()), size_t{1}),
+    solve_problems);
+  return arrival_times;
+}
+
+
+//! Compute the signed arrival time on a grid, see SignedArrivalTime,
+//! together with values extended from the boundary cells, e.g. extension
+//! velocities for level set methods.
+//!
+//! Input:
+//!   grid_size        - Number of grid cells in each dimension.
+//!   boundary_indices - Integer coordinates of cells with provided times.
+//!   boundary_times   - Signed times assigned to boundary cells.
+//!   boundary_values  - Values assigned to boundary cells.
+//!   eikonal_solver   - Solver used to propagate arrival times.
+//!
+//! Returns the signed arrival times and the extended values, in the same
+//! layout. The values are extended in the same pass as the times are
+//! marched, so that the gradient of the values is orthogonal to the
+//! gradient of the arrival times. Each time a cell is solved its value is
+//! set to a weighted average of the values of its upwind face-neighbors,
+//! with the weights of the quadratic solved by the @a eikonal_solver, so
+//! that the grid spacing is that of the solver. Boundary cells keep their
+//! given values. Apart from the narrow band, no memory is used beyond the
+//! returned times and values.
+//!
+//! The @a eikonal_solver must provide the Solve overload that takes a value
+//! accumulator, as the solvers in this library do.
+//!
+//! The value type V may be a scalar or a small vector type, it must be
+//! default constructible and support addition with V and multiplication
+//! with T.
+//!
+//! Throws std::invalid_argument if:
+//! - Any of the conditions in SignedArrivalTime, or
+//! - The number of boundary values is not the same as the number of
+//!   boundary indices.
+template<typename T, std::size_t N, typename V, typename EikonalSolverType>
+std::pair<std::vector<T>, std::vector<V>> ExtendedSignedArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  std::vector<V> const& boundary_values,
+  EikonalSolverType const& eikonal_solver)
+{
+  using namespace std;
+  using namespace detail;
+
+  static_assert(!is_same<V, bool>::value,
+                "values cannot be stored in std::vector<bool>");
+
+  // Check input. Other checks are done when computing arrival times.
+  ThrowIfBoundaryIndicesValuesSizeMismatch(boundary_indices, boundary_values);
+  ThrowIfInvalidSize(grid_size);
+
+  auto value_buffer = vector<V>(LinearSize(grid_size));
+  auto value_grid = Grid<V, N>(grid_size, value_buffer);
+  for (auto i = size_t{0}; i < boundary_indices.size(); ++i) {
+    if (Inside(boundary_indices[i], grid_size)) {
+      value_grid.Cell(boundary_indices[i]) = boundary_values[i];
+    }
+  }
+
+  auto const value_extending_eikonal_solver =
+    ValueExtendingEikonalSolver<T, N, EikonalSolverType, V>(
+      eikonal_solver, &value_grid);
+  auto frozen_cell_visitor = NullFrozenCellVisitor();
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t);
+  };
+  auto constexpr negative_inside = true;
+  auto signed_times = ArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    value_extending_eikonal_solver,
+    boundary_time_predicate,
+    negative_inside,
+    numeric_limits<T>::max(), // max_time
+    numeric_limits<T>::max(), // far_time
+    frozen_cell_visitor);
+  return {move(signed_times), move(value_buffer)};
+}
+
+
+//! Compute the signed arrival time on a grid, see SignedArrivalTime, and
+//! return the times encoded using @a encoder, e.g. HalfPrecisionEncoder or
+//! FixedPointEncoder. Arrival times are computed using the scalar type of
+//! the @a eikonal_solver, but are encoded as soon as the corresponding cells
+//! are frozen during marching, so there is no separate encoding pass.
+//!
+//! Note that the eikonal solver reads the full precision times of frozen
+//! cells, so marching still needs a full precision time grid of the same
+//! size as the returned grid. This grid is scratch memory that is released
+//! before returning, the peak memory use is not reduced by encoding.
+template<
+  typename T,
+  std::size_t N,
+  typename EikonalSolverType,
+  typename EncoderType>
+std::vector<typename EncoderType::ValueType> EncodedSignedArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  EncoderType const& encoder)
+{
+  using namespace std;
+  using namespace detail;
+
+  typedef typename EncoderType::ValueType ValueType;
+
+  auto encoded_buffer = vector<ValueType>(LinearSize(grid_size));
+  auto encoded_grid = Grid<ValueType, N>(grid_size, encoded_buffer);
+
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t);
+  };
+  auto constexpr negative_inside = true;
+  auto frozen_cell_visitor =
+    [&encoded_grid, &encoder](
+      array<int32_t, N> const& index,
+      T const time) {
+      encoded_grid.Cell(index) = encoder(time);
+    };
+  auto narrow_band = NarrowBandStore<T, N>();
+  auto stats_recorder = NullArrivalTimeStatsRecorder();
+  // Scratch times read by the eikonal solver while marching.
+  auto time_buffer = vector<T>(LinearSize(grid_size));
+  ArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    boundary_time_predicate,
+    negative_inside,
+    numeric_limits<T>::max(), // max_time
+    numeric_limits<T>::max(), // far_time
+    frozen_cell_visitor,
+    &narrow_band,
+    time_buffer.data(),
+    stats_recorder);
+  return encoded_buffer;
+}
+
+
+//! Compute arrival times at a set of target cells on a grid.
+//!
+//! Input:
+//!   grid_size        - Number of grid cells in each dimension.
+//!   boundary_indices - Integer coordinates of source cells.
+//!   boundary_times   - Non-negative arrival times at source cells.
+//!   eikonal_solver   - Solver used to propagate arrival times.
+//!   target_indices   - Integer coordinates of cells for which arrival times
+//!                      are requested.
+//!   marched_times    - If not null, receives the partially marched grid.
+//!                      Cells that were not reached are set to
+//!                      numeric_limits<T>::max().
+//!
+//! Returns the arrival times at @a target_indices, in the same order.
+//!
+//! A single front is marched outward from all boundary cells. There is no
+//! inside/outside analysis of the boundary and no sign on the returned
+//! times. Marching stops as soon as all target cells are frozen, so that
+//! only cells with arrival times smaller than the largest target time are
+//! visited. This makes queries for targets close to the sources
+//! much cheaper than computing arrival times for the whole grid.
+//!
+//! Throws std::invalid_argument if:
+//! - The boundary condition is invalid (see SignedArrivalTime), or
+//! - Any boundary time is negative, or
+//! - Any target index is outside the grid.
+template<typename T, std::size_t N, typename EikonalSolverType>
+std::vector<T> TargetArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  std::vector<std::array<std::int32_t, N>> const& target_indices,
+  std::vector<T>* const marched_times = nullptr)
+{
+  using namespace std;
+  using namespace detail;
+
+  static_assert(N >= 2, "dimensions must be >= 2");
+  static_assert(N == EikonalSolverType::kDimension,
+                "mismatching eikonal solver dimension");
+
+  // Check input.
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t) && t >= T{0};
+  };
+  ThrowIfInvalidBoundaryCondition(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    boundary_time_predicate);
+  for_each(
+    begin(target_indices),
+    end(target_indices),
+    [=](auto const& target_index) {
+      ThrowIfTargetIndexOutsideGrid(target_index, grid_size);
+    });
+
+  auto time_buffer =
+    vector<T>(LinearSize(grid_size), numeric_limits<T>::max());
+  auto time_grid = Grid<T, N>(grid_size, time_buffer);
+  auto const check_duplicate_indices = true;
+  SetBoundaryCondition(
+    boundary_indices,
+    boundary_times,
+    T{1}, // Multiplier.
+    check_duplicate_indices,
+    &time_grid);
+
+  // Mark targets that are not already frozen, i.e. not boundary cells.
+  // Duplicate target indices are only counted once.
+  auto target_mask_buffer =
+    vector<uint8_t>(LinearSize(grid_size), uint8_t{0});
+  auto target_mask_grid = Grid<uint8_t, N>(grid_size, target_mask_buffer);
+  auto remaining_target_count = size_t{0};
+  for (auto const& target_index : target_indices) {
+    auto& target_mask_cell = target_mask_grid.Cell(target_index);
+    if (target_mask_cell == uint8_t{0} &&
+        !Frozen(time_grid.Cell(target_index))) {
+      target_mask_cell = uint8_t{1};
+      ++remaining_target_count;
+    }
+  }
+
+  if (remaining_target_count > 0) {
+    // Since the boundary cells do not cover the whole grid there is at least
+    // one non-frozen face-neighbor.
+    auto const narrow_band_indices =
+      FaceNeighborNarrowBandIndices(boundary_indices, time_grid);
+    assert(!narrow_band_indices.empty());
+    auto narrow_band = InitializedNarrowBand(
+      narrow_band_indices,
+      time_grid,
+      eikonal_solver);
+    auto frozen_cell_visitor =
+      [&target_mask_grid, &remaining_target_count](
+        array<int32_t, N> const& index,
+        T const /*time*/) {
+        if (target_mask_grid.Cell(index) != uint8_t{0}) {
+          assert(remaining_target_count > 0);
+          --remaining_target_count;
+        }
+      };
+    auto const stop_predicate = [&remaining_target_count]() {
+      return remaining_target_count == 0;
+    };
+    MarchNarrowBand(
+      eikonal_solver,
+      narrow_band.get(),
+      &time_grid,
+      numeric_limits<T>::max(), // max_time
+      frozen_cell_visitor,
+      stop_predicate);
+  }
+
+  // The grid is face-connected, so every cell can be reached from the
+  // boundary and all targets must be frozen at this point.
+  assert(remaining_target_count == 0);
+
+  auto target_times = vector<T>();
+  target_times.reserve(target_indices.size());
+  for (auto const& target_index : target_indices) {
+    assert(Frozen(time_grid.Cell(target_index)));
+    target_times.push_back(time_grid.Cell(target_index));
+  }
+
+  if (marched_times != nullptr) {
+    *marched_times = move(time_buffer);
+  }
+
+  return target_times;
+}
+
+
+//! Compute the arrival time from @a source_index to @a target_index on
+//! a grid using bidirectional marching.
+//!
+//! Input:
+//!   grid_size      - Number of grid cells in each dimension.
+//!   source_index   - Integer coordinates of the source cell.
+//!   target_index   - Integer coordinates of the target cell.
+//!   eikonal_solver - Solver used to propagate arrival times.
+//!
+//! Returns a pair with the arrival time at the target cell and the index
+//! of the cell where the two fronts met.
+//!
+//! Two fronts are grown, one from the source and one from the target, each
+//! with its own narrow band and time grid. At each step the front with the
+//! smaller narrow band time is advanced. When a cell has been frozen by
+//! both fronts the sum of its two times is a candidate arrival time.
+//! Marching stops when the sum of the smallest times in the two narrow
+//! bands is no smaller than the best candidate. Since each front only
+//! has to reach roughly half way, the number of visited cells is
+//! significantly smaller than for a single front, in particular in
+//! higher dimensions.
+//!
+//! Note that the speed is assumed to be isotropic, so that the arrival time
+//! from the target to the source is the same as that from the source to the
+//! target. Also note that discretization errors close to point sources are
+//! larger than elsewhere. Since these errors are picked up at both ends, the
+//! returned time is typically somewhat larger than the time at the target
+//! computed by TargetArrivalTime.
+//!
+//! Throws std::invalid_argument if:
+//! - @a grid_size has a zero element, or
+//! - @a source_index is outside the grid, or
+//! - @a target_index is outside the grid.
+template<std::size_t N, typename EikonalSolverType>
+std::pair<typename EikonalSolverType::ScalarType, std::array<std::int32_t, N>>
+BidirectionalArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::array<std::int32_t, N> const& source_index,
+  std::array<std::int32_t, N> const& target_index,
+  EikonalSolverType const& eikonal_solver)
+{
+  using namespace std;
+  using namespace detail;
+
+  typedef typename EikonalSolverType::ScalarType T;
+
+  static_assert(N >= 2, "dimensions must be >= 2");
+  static_assert(N == EikonalSolverType::kDimension,
+                "mismatching eikonal solver dimension");
+
+  // Check input.
+  ThrowIfInvalidSize(grid_size);
+  ThrowIfBoundaryIndexOutsideGrid(source_index, grid_size);
+  ThrowIfTargetIndexOutsideGrid(target_index, grid_size);
+
+  if (source_index == target_index) {
+    return {T{0}, source_index};
+  }
+
+  // Since source and target are different cells the grid has at least two
+  // cells, so both narrow bands are non-empty initially.
+  auto source_time_buffer =
+    vector<T>(LinearSize(grid_size), numeric_limits<T>::max());
+  auto target_time_buffer =
+    vector<T>(LinearSize(grid_size), numeric_limits<T>::max());
+  auto source_time_grid = Grid<T, N>(grid_size, source_time_buffer);
+  auto target_time_grid = Grid<T, N>(grid_size, target_time_buffer);
+  source_time_grid.Cell(source_index) = T{0};
+  target_time_grid.Cell(target_index) = T{0};
+
+  auto source_narrow_band = InitializedNarrowBand(
+    FaceNeighborNarrowBandIndices(
+      vector<array<int32_t, N>>(1, source_index),
+      source_time_grid),
+    source_time_grid,
+    eikonal_solver);
+  auto target_narrow_band = InitializedNarrowBand(
+    FaceNeighborNarrowBandIndices(
+      vector<array<int32_t, N>>(1, target_index),
+      target_time_grid),
+    target_time_grid,
+    eikonal_solver);
+
+  auto best_time = numeric_limits<T>::max();
+  auto meeting_index = source_index;
+  auto source_visitor =
+    [&target_time_grid, &best_time, &meeting_index](
+      array<int32_t, N> const& index,
+      T const time) {
+      auto const target_time = target_time_grid.Cell(index);
+      if (Frozen(target_time) && time + target_time < best_time) {
+        best_time = time + target_time;
+        meeting_index = index;
+      }
+    };
+  auto target_visitor =
+    [&source_time_grid, &best_time, &meeting_index](
+      array<int32_t, N> const& index,
+      T const time) {
+      auto const source_time = source_time_grid.Cell(index);
+      if (Frozen(source_time) && time + source_time < best_time) {
+        best_time = time + source_time;
+        meeting_index = index;
+      }
+    };
+
+  while (!source_narrow_band->empty() && !target_narrow_band->empty()) {
+    auto const source_top_time = source_narrow_band->Top().first;
+    auto const target_top_time = target_narrow_band->Top().first;
+    if (best_time < numeric_limits<T>::max() &&
+        source_top_time + target_top_time >= best_time) {
+      // No cell that is yet to be frozen can give a smaller sum.
+      break;
+    }
+
+    if (source_top_time <= target_top_time) {
+      FreezeNarrowBandCell(
+        eikonal_solver,
+        source_narrow_band.get(),
+        &source_time_grid,
+        source_visitor);
+    }
+    else {
+      FreezeNarrowBandCell(
+        eikonal_solver,
+        target_narrow_band.get(),
+        &target_time_grid,
+        target_visitor);
+    }
+  }
+
+  // A front can only run out of cells after freezing every cell in the
+  // grid, including the other front's seed cell.
+  assert(best_time < numeric_limits<T>::max());
+
+  return {best_time, meeting_index};
+}
+
+
+//! Compute the arrival time at a single target cell on a grid, using
+//! heuristic-guided marching.
+//!
+//! Input:
+//!   grid_size        - Number of grid cells in each dimension.
+//!   boundary_indices - Integer coordinates of source cells.
+//!   boundary_times   - Non-negative arrival times at source cells.
+//!   eikonal_solver   - Solver used to propagate arrival times.
+//!   target_index     - Integer coordinates of the target cell.
+//!   heuristic        - Function object returning a lower bound on the
+//!                      arrival time difference between a cell and the
+//!                      target cell, see DistanceHeuristic.
+//!   marched_times    - If not null, receives the partially marched grid.
+//!                      Cells that were not reached are set to
+//!                      numeric_limits<T>::max().
+//!
+//! This is the same as TargetArrivalTime for a single target, except that
+//! narrow band cells are frozen in order of arrival time plus heuristic,
+//! rather than in order of arrival time. Cells in directions away from the
+//! target are then postponed, and typically never frozen before the target
+//! is. Since cells are then no longer frozen in strict order of arrival
+//! time, cells may be solved using fewer upwind dimensions (see
+//! DimensionDroppingEikonalSolver) and the result at the target is not
+//! guaranteed to be identical to that of TargetArrivalTime, although it is
+//! typically very close. A zero heuristic, e.g. DistanceHeuristic with its
+//! default weight, gives exactly the same result as TargetArrivalTime.
+//!
+//! Throws std::invalid_argument if:
+//! - The boundary condition is invalid (see SignedArrivalTime), or
+//! - Any boundary time is negative, or
+//! - @a target_index is outside the grid.
+template<
+  typename T,
+  std::size_t N,
+  typename EikonalSolverType,
+  typename HeuristicType>
+T HeuristicTargetArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  std::array<std::int32_t, N> const& target_index,
+  HeuristicType const& heuristic,
+  std::vector<T>* const marched_times = nullptr)
+{
+  using namespace std;
+  using namespace detail;
+
+  static_assert(N >= 2, "dimensions must be >= 2");
+  static_assert(N == EikonalSolverType::kDimension,
+                "mismatching eikonal solver dimension");
+
+  // Check input.
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t) && t >= T{0};
+  };
+  ThrowIfInvalidBoundaryCondition(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    boundary_time_predicate);
+  ThrowIfTargetIndexOutsideGrid(target_index, grid_size);
+
+  auto time_buffer =
+    vector<T>(LinearSize(grid_size), numeric_limits<T>::max());
+  auto time_grid = Grid<T, N>(grid_size, time_buffer);
+  auto const check_duplicate_indices = true;
+  SetBoundaryCondition(
+    boundary_indices,
+    boundary_times,
+    T{1}, // Multiplier.
+    check_duplicate_indices,
+    &time_grid);
+
+  if (!Frozen(time_grid.Cell(target_index))) {
+    auto const dropping_eikonal_solver =
+      DimensionDroppingEikonalSolver<T, N, EikonalSolverType>(
+        eikonal_solver, &time_grid);
+
+    // Since the boundary cells do not cover the whole grid there is at least
+    // one non-frozen face-neighbor.
+    auto const narrow_band_indices =
+      FaceNeighborNarrowBandIndices(boundary_indices, time_grid);
+    assert(!narrow_band_indices.empty());
+    auto narrow_band =
+      HeuristicNarrowBandStore<T, N, HeuristicType>(heuristic);
+    for (auto const& narrow_band_index : narrow_band_indices) {
+      narrow_band.Push({
+        dropping_eikonal_solver.Solve(narrow_band_index, time_grid),
+        narrow_band_index});
+    }
+
+    auto frozen_cell_visitor = NullFrozenCellVisitor();
+    auto const stop_predicate = [&time_grid, &target_index]() {
+      return Frozen(time_grid.Cell(target_index));
+    };
+    MarchNarrowBand(
+      dropping_eikonal_solver,
+      &narrow_band,
+      &time_grid,
+      numeric_limits<T>::max(), // max_time
+      frozen_cell_visitor,
+      stop_predicate);
+  }
+
+  // The grid is face-connected, so the target can always be reached.
+  assert(Frozen(time_grid.Cell(target_index)));
+  auto const target_time = time_grid.Cell(target_index);
+
+  if (marched_times != nullptr) {
+    *marched_times = move(time_buffer);
+  }
+
+  return target_time;
+}
+
+
+//! Compute arrival times for all cells on a grid by marching a single front
+//! outward from the boundary cells.
+//!
+//! Input:
+//!   grid_size           - Number of grid cells in each dimension.
+//!   boundary_indices    - Integer coordinates of source cells.
+//!   boundary_times      - Non-negative arrival times at source cells.
+//!   eikonal_solver      - Solver used to propagate arrival times.
+//!   frozen_cell_visitor - Called as frozen_cell_visitor(index, time) for
+//!                         every cell as soon as its final time is known.
+//!                         Boundary cells are visited first, then the
+//!                         other cells in order of increasing time. This
+//!                         allows post-processing to be fused into the
+//!                         march.
+//!
+//! Unlike SignedArrivalTime there is no inside/outside analysis of the
+//! boundary, all arrival times are non-negative. This is typically what is
+//! needed for geodesic distances and cost maps, where boundary cells are
+//! sources rather than an interface. The result can be updated with
+//! UpdateGeodesicArrivalTime when the boundary cells change.
+//!
+//! Throws std::invalid_argument if:
+//! - The boundary condition is invalid (see SignedArrivalTime), or
+//! - Any boundary time is negative.
+template<
+  typename T,
+  std::size_t N,
+  typename EikonalSolverType,
+  typename FrozenCellVisitorType>
+std::vector<T> GeodesicArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  FrozenCellVisitorType&& frozen_cell_visitor)
+{
+  auto time_buffer = std::vector<T>(detail::LinearSize(grid_size));
+  auto stats_recorder = detail::NullArrivalTimeStatsRecorder();
+  detail::SingleFrontArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    frozen_cell_visitor,
+    time_buffer.data(),
+    stats_recorder);
+  return time_buffer;
+}
+
+
+//! Compute arrival times for all cells on a grid by marching a single front
+//! outward from the boundary cells, see GeodesicArrivalTime above, without
+//! visiting the frozen cells.
+template<typename T, std::size_t N, typename EikonalSolverType>
+std::vector<T> GeodesicArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver)
+{
+  return GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    detail::NullFrozenCellVisitor());
+}
+
+
+//! Compute arrival times for all cells on a grid by marching a single front
+//! outward from the boundary cells, see GeodesicArrivalTime above, and add
+//! the time spent in each phase and counts of the marching work to
+//! @a stats.
+//!
+//! Preconditions:
+//! - @a stats is not null.
+template<typename T, std::size_t N, typename EikonalSolverType>
+std::vector<T> GeodesicArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  ArrivalTimeStats* const stats)
+{
+  assert(stats != nullptr && "Precondition");
+
+  auto time_buffer = std::vector<T>(detail::LinearSize(grid_size));
+  auto frozen_cell_visitor = detail::NullFrozenCellVisitor();
+  auto stats_recorder = detail::ArrivalTimeStatsRecorder(stats);
+  detail::SingleFrontArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    frozen_cell_visitor,
+    time_buffer.data(),
+    stats_recorder);
+  return time_buffer;
+}
+
+
+#if defined(__unix__) || defined(__APPLE__)
+
+//! Compute arrival times for all cells on a grid by marching a single
+//! front, see GeodesicArrivalTime, and store the times in the
+//! memory-mapped @a arrival_times, for grids that are larger than the
+//! available memory. Apart from the mapped grid, memory use is
+//! proportional to the size of the narrow band. Speeds can be
+//! memory-mapped as well, see VaryingSpeedEikonalSolver.
+//!
+//! Throws std::invalid_argument if:
+//! - The size of @a arrival_times does not match @a grid_size, or
+//! - The input is invalid, see GeodesicArrivalTime.
+//!
+//! Preconditions:
+//! - @a arrival_times is not null.
+template<typename T, std::size_t N, typename EikonalSolverType>
+void GeodesicArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  MappedGrid<T, N>* const arrival_times)
+{
+  using namespace detail;
+
+  assert(arrival_times != nullptr && "Precondition");
+
+  ThrowIfInvalidCellBufferSize(grid_size, arrival_times->cell_count());
+
+  auto frozen_cell_visitor = NullFrozenCellVisitor();
+  auto stats_recorder = NullArrivalTimeStatsRecorder();
+  SingleFrontArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    frozen_cell_visitor,
+    arrival_times->data(),
+    stats_recorder);
+}
+
+#endif // defined(__unix__) || defined(__APPLE__)
+
+
+//! Compute arrival times by marching a single front outward from the
+//! boundary cells, see GeodesicArrivalTime, but only for the cells with
+//! arrival times up to @a max_time. Times are stored in a sparse grid,
+//! so that memory use is proportional to the volume of the band around
+//! the boundary rather than to the grid size. Cells that were not reached
+//! are not frozen in the returned grid, i.e. they have the value
+//! numeric_limits<T>::max(). Use SparseGrid::DenseBuffer to get a dense
+//! buffer.
+//!
+//! Throws std::invalid_argument if:
+//! - The input is invalid, see GeodesicArrivalTime, or
+//! - @a max_time is NaN or negative.
+template<typename T, std::size_t N, typename EikonalSolverType>
+SparseGrid<T, N> SparseGeodesicArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver,
+  T const max_time)
+{
+  using namespace std;
+  using namespace detail;
+
+  static_assert(N >= 2, "dimensions must be >= 2");
+  static_assert(N == EikonalSolverType::kDimension,
+                "mismatching eikonal solver dimension");
+
+  ThrowIfInvalidMaxTime(max_time);
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t) && t >= T{0};
+  };
+  ThrowIfInvalidBoundaryCondition(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    boundary_time_predicate);
+
+  auto time_grid = SparseGrid<T, N>(grid_size);
+  auto const check_duplicate_indices = true;
+  SetBoundaryCondition(
+    boundary_indices,
+    boundary_times,
+    T{1}, // Multiplier.
+    check_duplicate_indices,
+    &time_grid);
+
+  // Since the boundary cells do not cover the whole grid there is at least
+  // one non-frozen face-neighbor.
+  auto narrow_band = NarrowBandStore<T, N>();
+  InitializeNarrowBand(
+    FaceNeighborNarrowBandIndices(boundary_indices, time_grid),
+    time_grid,
+    eikonal_solver,
+    &narrow_band);
+  auto frozen_cell_visitor = NullFrozenCellVisitor();
+  MarchNarrowBand(
+    eikonal_solver,
+    &narrow_band,
+    &time_grid,
+    max_time,
+    frozen_cell_visitor);
+  return time_grid;
+}
+
+
+//! Compute arrival times for all cells on a grid, see GeodesicArrivalTime,
+//! together with a label for each cell, e.g. to find the nearest of a set
+//! of facilities (a discrete Voronoi diagram) in a single march.
+//!
+//! Input:
+//!   grid_size        - Number of grid cells in each dimension.
+//!   boundary_indices - Integer coordinates of source cells.
+//!   boundary_times   - Non-negative arrival times at source cells.
+//!   boundary_labels  - Labels of source cells, e.g. source ids.
+//!   eikonal_solver   - Solver used to propagate arrival times.
+//!
+//! Returns the arrival times and the labels, in the same layout. Boundary
+//! cells keep their given labels. Other cells get the label of the
+//! face-neighbor with the smallest time when they are frozen, i.e. the
+//! upwind neighbor that contributes most to their time. Several cells may
+//! share a label, e.g. when a source covers more than one cell.
+//!
+//! Throws std::invalid_argument if:
+//! - The boundary condition is invalid (see GeodesicArrivalTime), or
+//! - The number of boundary labels is not the same as the number of
+//!   boundary indices.
+template<typename T, std::size_t N, typename L, typename EikonalSolverType>
+std::pair<std::vector<T>, std::vector<L>> LabelledGeodesicArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  std::vector<L> const& boundary_labels,
+  EikonalSolverType const& eikonal_solver)
+{
+  using namespace std;
+  using namespace detail;
+
+  static_assert(N >= 2, "dimensions must be >= 2");
+  static_assert(N == EikonalSolverType::kDimension,
+                "mismatching eikonal solver dimension");
+  static_assert(!is_same<L, bool>::value,
+                "labels cannot be stored in std::vector<bool>");
+
+  // Check input.
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t) && t >= T{0};
+  };
+  ThrowIfInvalidBoundaryCondition(
+    grid_size,
     boundary_indices,
-    grid_size);
-  auto outside_narrow_band_indices = narrow_band_indices.first;
-  auto inside_narrow_band_indices = narrow_band_indices.second;
+    boundary_times,
+    boundary_time_predicate);
+  ThrowIfBoundaryIndicesLabelsSizeMismatch(boundary_indices, boundary_labels);
+
+  auto time_buffer =
+    vector<T>(LinearSize(grid_size), numeric_limits<T>::max());
+  auto time_grid = Grid<T, N>(grid_size, time_buffer);
+  auto const check_duplicate_indices = true;
+  SetBoundaryCondition(
+    boundary_indices,
+    boundary_times,
+    T{1}, // Multiplier.
+    check_duplicate_indices,
+    &time_grid);
 
-  return detail::SignedDistance(
+  auto label_buffer = vector<L>(LinearSize(grid_size));
+  auto label_grid = Grid<L, N>(grid_size, label_buffer);
+  for (auto i = size_t{0}; i < boundary_indices.size(); ++i) {
+    label_grid.Cell(boundary_indices[i]) = boundary_labels[i];
+  }
+
+  // Since the boundary cells do not cover the whole grid there is at least
+  // one non-frozen face-neighbor.
+  auto narrow_band = InitializedNarrowBand(
+    FaceNeighborNarrowBandIndices(boundary_indices, time_grid),
+    time_grid,
+    eikonal_solver);
+
+  // The visitor is called after the frozen cell has been written to the
+  // time grid, and before any of its non-frozen neighbors are frozen. Thus,
+  // the frozen neighbors have times less than or equal to the frozen cell.
+  auto label_visitor =
+    [&time_grid, &label_grid](array<int32_t, N> const& index, T const) {
+      auto min_neighbor_time = numeric_limits<T>::max();
+      for (auto i = size_t{0}; i < N; ++i) {
+        for (auto const neighbor_offset : {int32_t{-1}, int32_t{1}}) {
+          auto neighbor_index = index;
+          neighbor_index[i] += neighbor_offset;
+          if (Inside(neighbor_index, time_grid.size())) {
+            auto const neighbor_time = time_grid.Cell(neighbor_index);
+            if (neighbor_time < min_neighbor_time) {
+              min_neighbor_time = neighbor_time;
+              label_grid.Cell(index) = label_grid.Cell(neighbor_index);
+            }
+          }
+        }
+      }
+      assert(Frozen(min_neighbor_time));
+    };
+  MarchNarrowBand(
+    eikonal_solver,
+    narrow_band.get(),
+    &time_grid,
+    numeric_limits<T>::max(), // max_time
+    label_visitor);
+
+  assert(all_of(begin(time_buffer), end(time_buffer),
+                [](T const t) { return Frozen(t); }));
+
+  return {time_buffer, label_buffer};
+}
+
+
+//! Compute arrival times for all cells on a grid, see GeodesicArrivalTime,
+//! together with the index of the closest boundary cell for each cell,
+//! i.e. a discrete feature transform.
+//!
+//! Returns the arrival times and the closest boundary indices, in the same
+//! layout. Closest boundary indices are propagated while marching, each
+//! frozen cell inheriting the closest boundary index of its upwind
+//! neighbor, see LabelledGeodesicArrivalTime. Boundary cells are their own
+//! closest boundary cells.
+//!
+//! Throws std::invalid_argument if:
+//! - The boundary condition is invalid (see GeodesicArrivalTime).
+template<typename T, std::size_t N, typename EikonalSolverType>
+std::pair<std::vector<T>, std::vector<std::array<std::int32_t, N>>>
+ClosestBoundaryGeodesicArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  EikonalSolverType const& eikonal_solver)
+{
+  return LabelledGeodesicArrivalTime(
     grid_size,
     boundary_indices,
-    boundary_distances,
-    inside_narrow_band_indices,
-    outside_narrow_band_indices,
+    boundary_times,
+    boundary_indices, // Labels.
     eikonal_solver);
-#endif
 }
 
+
+//! Extract minimal paths by backtracking along the gradient of arrival
+//! times, e.g. computed by GeodesicArrivalTime.
+//!
+//! Input:
+//!   grid_size       - Number of grid cells in each dimension.
+//!   grid_spacing    - Grid cell size in each dimension.
+//!   arrival_times   - Arrival times for all grid cells.
+//!   start_positions - Positions where paths start. Cell centers are at
+//!                     (index[i] + 0.5) * grid_spacing[i].
+//!   step_length     - Distance between consecutive path positions.
+//!   thread_count    - Number of threads used to trace paths.
+//!
+//! Returns one path for each start position, in the same order. Paths start
+//! at the start position and end at the center of the cell where the
+//! arrival time is locally minimal, typically a boundary cell. Steps are
+//! taken with the midpoint (second order Runge-Kutta) method. Directions
+//! are interpolated from discrete upwind gradients, which are computed
+//! once and shared by all paths. The speed is not needed, since the paths
+//! follow the gradient of the arrival times.
+//!
+//! Throws std::invalid_argument if:
+//! - The size of @a arrival_times does not match @a grid_size, or
+//! - Any element in @a grid_spacing is invalid, or
+//! - Any start position is outside the grid, or
+//! - @a step_length is not positive or larger than half the grid spacing,
+//!   or
+//! - @a thread_count is zero.
+template<typename T, std::size_t N>
+std::vector<std::vector<std::array<T, N>>> GeodesicPaths(
+  std::array<std::size_t, N> const& grid_size,
+  std::array<T, N> const& grid_spacing,
+  std::vector<T> const& arrival_times,
+  std::vector<std::array<T, N>> const& start_positions,
+  T const step_length,
+  std::size_t const thread_count)
+{
+  using namespace std;
+  using namespace detail;
+
+  // Check input.
+  auto const time_grid = ConstGrid<T, N>(grid_size, arrival_times);
+  ThrowIfInvalidGridSpacing(grid_spacing);
+  for_each(
+    begin(start_positions),
+    end(start_positions),
+    [&](auto const& start_position) {
+      ThrowIfPositionOutsideGrid(start_position, grid_size, grid_spacing);
+    });
+  ThrowIfInvalidStepLength(step_length, grid_spacing);
+  ThrowIfZeroThreadCount(thread_count);
+
+  // Paths shorter than the sum of the grid dimensions times a safety
+  // factor are expected to terminate.
+  auto path_length_bound = T{0};
+  for (auto i = size_t{0}; i < N; ++i) {
+    path_length_bound += grid_size[i] * grid_spacing[i];
+  }
+  auto const max_step_count =
+    static_cast<size_t>(T{4} * path_length_bound / step_length);
+
+  auto const gradients = ArrivalTimeGradients(time_grid, grid_spacing);
+  auto paths = vector<vector<array<T, N>>>(start_positions.size());
+  atomic<size_t> next_path_index(0);
+  RunOnThreads(
+    max(min(thread_count, start_positions.size()), size_t{1}),
+    [&]() {
+      for (auto i = next_path_index++; i < start_positions.size();
+           i = next_path_index++) {
+        paths[i] = TracePath(
+          start_positions[i],
+          time_grid,
+          gradients,
+          grid_spacing,
+          step_length,
+          max_step_count);
+      }
+    });
+  return paths;
+}
+
+
+//! Extract a single minimal path, see GeodesicPaths.
+template<typename T, std::size_t N>
+std::vector<std::array<T, N>> GeodesicPath(
+  std::array<std::size_t, N> const& grid_size,
+  std::array<T, N> const& grid_spacing,
+  std::vector<T> const& arrival_times,
+  std::array<T, N> const& start_position,
+  T const step_length)
+{
+  return GeodesicPaths(
+    grid_size,
+    grid_spacing,
+    arrival_times,
+    std::vector<std::array<T, N>>(1, start_position),
+    step_length,
+    std::size_t{1}).front();
+}
+
+
+//! Compute arrival times from many point sources through the same medium,
+//! e.g. traveltime tables for seismic tomography, but only store the times
+//! at a list of receiver cells.
+//!
+//! Input:
+//!   grid_size        - Number of grid cells in each dimension.
+//!   source_indices   - Integer coordinates of source cells. Sources have
+//!                      arrival time zero.
+//!   receiver_indices - Integer coordinates of receiver cells.
+//!   eikonal_solver   - Determines grid spacing and speed. Shared by all
+//!                      threads, so a varying speed solver holds a single
+//!                      (read-only) speed grid for all sources.
+//!   thread_count     - Number of threads marching sources.
+//!
+//! Returns a table with one row for each source, in the same order as
+//! @a source_indices, holding the arrival times at the receivers, in the
+//! same order as @a receiver_indices. Each source is marched by a single
+//! front, see GeodesicArrivalTime, until all receivers have been frozen.
+//! Each thread re-uses a single time grid for all the sources it marches,
+//! so memory use is proportional to the number of sources times the
+//! number of receivers, plus the grid size times the number of threads.
+//!
+//! Throws std::invalid_argument if:
+//! - @a grid_size has a zero element or only one cell, or
+//! - Any source or receiver index is outside the grid, or
+//! - @a thread_count is zero.
+template<std::size_t N, typename EikonalSolverType>
+std::vector<std::vector<typename EikonalSolverType::ScalarType>>
+TravelTimeTable(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& source_indices,
+  std::vector<std::array<std::int32_t, N>> const& receiver_indices,
+  EikonalSolverType const& eikonal_solver,
+  std::size_t const thread_count)
+{
+  using namespace std;
+  using namespace detail;
+
+  typedef typename EikonalSolverType::ScalarType T;
+
+  static_assert(N >= 2, "dimensions must be >= 2");
+  static_assert(N == EikonalSolverType::kDimension,
+                "mismatching eikonal solver dimension");
+
+  // Check input.
+  ThrowIfInvalidSources(grid_size, source_indices, thread_count);
+  for_each(
+    begin(receiver_indices),
+    end(receiver_indices),
+    [&](auto const& receiver_index) {
+      ThrowIfReceiverIndexOutsideGrid(receiver_index, grid_size);
+    });
+
+  // Receivers are counted once, even if listed more than once.
+  auto const strides = GridStrides(grid_size);
+  auto is_receiver = vector<bool>(LinearSize(grid_size), false);
+  auto receiver_count = size_t{0};
+  for (auto const& receiver_index : receiver_indices) {
+    auto const linear_index = GridLinearIndex(receiver_index, strides);
+    if (!is_receiver[linear_index]) {
+      is_receiver[linear_index] = true;
+      ++receiver_count;
+    }
+  }
+
+  auto table = vector<vector<T>>(source_indices.size());
+  atomic<size_t> next_source_index(0);
+  RunOnThreads(
+    max(min(thread_count, source_indices.size()), size_t{1}),
+    [&]() {
+      auto time_buffer = vector<T>(LinearSize(grid_size));
+      auto narrow_band = NarrowBandStore<T, N>();
+      for (auto i = next_source_index++; i < source_indices.size();
+           i = next_source_index++) {
+        fill(begin(time_buffer), end(time_buffer), numeric_limits<T>::max());
+        auto time_grid = Grid<T, N>(grid_size, time_buffer);
+        auto remaining_receiver_count = receiver_count;
+        auto frozen_cell_visitor =
+          [&](array<int32_t, N> const& index, T const) {
+            if (is_receiver[GridLinearIndex(index, strides)]) {
+              --remaining_receiver_count;
+            }
+          };
+        MarchPointSource(
+          source_indices[i],
+          eikonal_solver,
+          &narrow_band,
+          &time_grid,
+          frozen_cell_visitor,
+          [&]() { return remaining_receiver_count == 0; });
+
+        auto& receiver_times = table[i];
+        receiver_times.reserve(receiver_indices.size());
+        for (auto const& receiver_index : receiver_indices) {
+          receiver_times.push_back(time_grid.Cell(receiver_index));
+        }
+      }
+    });
+  return table;
+}
+
+
+//! Compute arrival times for all grid cells from many point sources
+//! through the same medium, see TravelTimeTable. Returns one arrival time
+//! grid for each source, in the same order as @a source_indices.
+//!
+//! Throws std::invalid_argument if:
+//! - @a grid_size has a zero element or only one cell, or
+//! - Any source index is outside the grid, or
+//! - @a thread_count is zero.
+template<std::size_t N, typename EikonalSolverType>
+std::vector<std::vector<typename EikonalSolverType::ScalarType>>
+TravelTimeVolumes(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& source_indices,
+  EikonalSolverType const& eikonal_solver,
+  std::size_t const thread_count)
+{
+  using namespace std;
+  using namespace detail;
+
+  typedef typename EikonalSolverType::ScalarType T;
+
+  static_assert(N >= 2, "dimensions must be >= 2");
+  static_assert(N == EikonalSolverType::kDimension,
+                "mismatching eikonal solver dimension");
+
+  // Check input.
+  ThrowIfInvalidSources(grid_size, source_indices, thread_count);
+
+  auto volumes = vector<vector<T>>(source_indices.size());
+  atomic<size_t> next_source_index(0);
+  RunOnThreads(
+    max(min(thread_count, source_indices.size()), size_t{1}),
+    [&]() {
+      auto narrow_band = NarrowBandStore<T, N>();
+      for (auto i = next_source_index++; i < source_indices.size();
+           i = next_source_index++) {
+        auto& time_buffer = volumes[i];
+        time_buffer.assign(LinearSize(grid_size), numeric_limits<T>::max());
+        auto time_grid = Grid<T, N>(grid_size, time_buffer);
+        auto frozen_cell_visitor = NullFrozenCellVisitor();
+        MarchPointSource(
+          source_indices[i],
+          eikonal_solver,
+          &narrow_band,
+          &time_grid,
+          frozen_cell_visitor,
+          []() { return false; });
+        assert(all_of(begin(time_buffer), end(time_buffer),
+                      [](T const t) { return Frozen(t); }));
+      }
+    });
+  return volumes;
+}
+
+
+//! Update arrival times computed by GeodesicArrivalTime after the boundary
+//! cells have changed, without marching the whole grid again.
+//!
+//! Input:
+//!   grid_size                - Number of grid cells in each dimension.
+//!   boundary_indices         - Integer coordinates of all current source
+//!                              cells, i.e. after the change.
+//!   boundary_times           - Non-negative arrival times at all current
+//!                              source cells.
+//!   removed_boundary_indices - Integer coordinates of previous source cells
+//!                              that are no longer sources.
+//!   eikonal_solver           - Solver used to propagate arrival times.
+//!   arrival_times            - Arrival times for the previous boundary
+//!                              cells, updated in place.
+//!
+//! Boundary cells that were added, or whose times changed, are detected
+//! by comparing @a boundary_times with @a arrival_times. Cells whose times
+//! depended on removed sources, or on sources with increased times, are
+//! reset (raised) and the surrounding cells propagate times back into the
+//! reset region. Lowered times from new sources, or sources with decreased
+//! times, are propagated outward until they no longer improve on the
+//! previous times. Only the affected region is visited, and the result is
+//! the same as marching the whole grid with the new boundary cells, up to
+//! rounding errors.
+//!
+//! This only holds for solvers that read the times of face-neighbors, which
+//! declare a kStencilReach of one (e.g. UniformSpeedEikonalSolver). Other
+//! solvers, such as the high accuracy solvers that read cells two steps
+//! away, can have times beyond the affected region both raised and
+//! lowered. For these solvers, and for solvers that do not declare a
+//! stencil reach, the whole grid is marched again instead, writing the
+//! result to @a arrival_times.
+//!
+//! Removed boundary indices that are also in @a boundary_indices are
+//! ignored.
+//!
+//! Throws std::invalid_argument if:
+//! - The boundary condition is invalid (see SignedArrivalTime), or
+//! - Any boundary time is negative, or
+//! - Any duplicate in @a boundary_indices, or
+//! - Any removed boundary index is outside the grid, or
+//! - The size of @a arrival_times does not match @a grid_size.
+//!
+//! Preconditions:
+//! - @a arrival_times is not null and holds the result of
+//!   GeodesicArrivalTime, or a previous update, for the same grid size and
+//!   solver.
+template<typename T, std::size_t N, typename EikonalSolverType>
+void UpdateGeodesicArrivalTime(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  std::vector<std::array<std::int32_t, N>> const& removed_boundary_indices,
+  EikonalSolverType const& eikonal_solver,
+  std::vector<T>* const arrival_times)
+{
+  using namespace std;
+  using namespace detail;
+
+  static_assert(N >= 2, "dimensions must be >= 2");
+  static_assert(N == EikonalSolverType::kDimension,
+                "mismatching eikonal solver dimension");
+
+  assert(arrival_times != nullptr && "Precondition");
+
+  // Check input.
+  auto const boundary_time_predicate = [](auto const t) {
+    return !isnan(t) && Frozen(t) && t >= T{0};
+  };
+  ThrowIfInvalidBoundaryCondition(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    boundary_time_predicate);
+  for_each(
+    begin(removed_boundary_indices),
+    end(removed_boundary_indices),
+    [=](auto const& removed_boundary_index) {
+      ThrowIfBoundaryIndexOutsideGrid(removed_boundary_index, grid_size);
+    });
+  auto time_grid = Grid<T, N>(grid_size, *arrival_times);
+
+  if (!FaceNeighborEikonalSolver<EikonalSolverType>::value) {
+    auto frozen_cell_visitor = NullFrozenCellVisitor();
+    auto stats_recorder = NullArrivalTimeStatsRecorder();
+    SingleFrontArrivalTime(
+      grid_size,
+      boundary_indices,
+      boundary_times,
+      eikonal_solver,
+      frozen_cell_visitor,
+      arrival_times->data(),
+      stats_recorder);
+    return;
+  }
+
+  auto const strides = GridStrides(grid_size);
+  auto const boundary_linear_indices =
+    BoundaryLinearIndices(boundary_indices, grid_size);
+  auto const is_boundary =
+    [&boundary_linear_indices, &strides](array<int32_t, N> const& index) {
+      return boundary_linear_indices.count(
+        GridLinearIndex(index, strides)) > 0;
+    };
+
+  // Removed sources and sources with increased times are seeds for
+  // resetting cells. New sources and sources with changed times are pushed
+  // to the narrow band with their new times.
+  auto raised_seeds = vector<pair<T, array<int32_t, N>>>();
+  for (auto const& removed_boundary_index : removed_boundary_indices) {
+    if (!is_boundary(removed_boundary_index)) {
+      auto& time_cell = time_grid.Cell(removed_boundary_index);
+      if (Frozen(time_cell)) {
+        raised_seeds.push_back({time_cell, removed_boundary_index});
+        time_cell = numeric_limits<T>::max();
+      }
+    }
+  }
+  auto narrow_band = NarrowBandStore<T, N>();
+  for (auto i = size_t{0}; i < boundary_indices.size(); ++i) {
+    auto const boundary_index = boundary_indices[i];
+    auto const boundary_time = boundary_times[i];
+    auto& time_cell = time_grid.Cell(boundary_index);
+    if (boundary_time != time_cell) {
+      if (boundary_time > time_cell) {
+        raised_seeds.push_back({time_cell, boundary_index});
+      }
+      time_cell = boundary_time;
+      narrow_band.Push({boundary_time, boundary_index});
+    }
+  }
+
+  UpdateArrivalTimes(
+    eikonal_solver,
+    raised_seeds,
+    is_boundary,
+    &narrow_band,
+    &time_grid);
+
+  assert(all_of(begin(*arrival_times), end(*arrival_times),
+                [](T const t) { return Frozen(t); }));
+}
+
+
+//! Update arrival times computed by GeodesicArrivalTime after the speeds
+//! of some cells have changed, without marching the whole grid again.
+//!
+//! Input:
+//!   grid_size             - Number of grid cells in each dimension.
+//!   boundary_indices      - Integer coordinates of source cells.
+//!   changed_speed_indices - Integer coordinates of cells whose speed has
+//!                           changed. For a box of cells, list all cells
+//!                           inside the box.
+//!   eikonal_solver        - Solver using the new speeds, e.g. a
+//!                           VaryingSpeedEikonalSolver constructed with the
+//!                           new speed buffer.
+//!   arrival_times         - Arrival times computed with the previous
+//!                           speeds, updated in place.
+//!
+//! The times of the changed cells and all cells downstream of them, i.e.
+//! cells whose times were computed from the changed cells, are reset and
+//! re-marched from the surrounding cells. If the new times are lower they
+//! are propagated further out, only as long as they improve on the
+//! previous times. Cells upstream of the changed cells are not visited.
+//! Changed cells that are boundary cells keep their times.
+//!
+//! As for UpdateGeodesicArrivalTime, this requires a solver with a
+//! kStencilReach of one. For other solvers the whole grid is marched again
+//! from the boundary cells, with the times they have in @a arrival_times.
+//!
+//! Throws std::invalid_argument if:
+//! - Any element of @a grid_size is zero, or
+//! - Any boundary index is outside the grid, or
+//! - Any duplicate in @a boundary_indices, or
+//! - Any changed speed index is outside the grid, or
+//! - The size of @a arrival_times does not match @a grid_size.
+//!
+//! Preconditions:
+//! - @a arrival_times is not null and holds the result of
+//!   GeodesicArrivalTime, or a previous update, for the same grid size and
+//!   boundary cells.
+template<typename T, std::size_t N, typename EikonalSolverType>
+void UpdateGeodesicArrivalTimeForSpeedChange(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<std::array<std::int32_t, N>> const& changed_speed_indices,
+  EikonalSolverType const& eikonal_solver,
+  std::vector<T>* const arrival_times)
+{
+  using namespace std;
+  using namespace detail;
+
+  static_assert(N >= 2, "dimensions must be >= 2");
+  static_assert(N == EikonalSolverType::kDimension,
+                "mismatching eikonal solver dimension");
+
+  assert(arrival_times != nullptr && "Precondition");
+
+  // Check input.
+  ThrowIfInvalidSize(grid_size);
+  for_each(
+    begin(boundary_indices),
+    end(boundary_indices),
+    [=](auto const& boundary_index) {
+      ThrowIfBoundaryIndexOutsideGrid(boundary_index, grid_size);
+    });
+  for_each(
+    begin(changed_speed_indices),
+    end(changed_speed_indices),
+    [=](auto const& changed_speed_index) {
+      ThrowIfSpeedIndexOutsideGrid(changed_speed_index, grid_size);
+    });
+  auto time_grid = Grid<T, N>(grid_size, *arrival_times);
+
+  if (!FaceNeighborEikonalSolver<EikonalSolverType>::value) {
+    // Boundary cells keep their times.
+    auto boundary_times = vector<T>();
+    boundary_times.reserve(boundary_indices.size());
+    for (auto const& boundary_index : boundary_indices) {
+      boundary_times.push_back(time_grid.Cell(boundary_index));
+    }
+    auto frozen_cell_visitor = NullFrozenCellVisitor();
+    auto stats_recorder = NullArrivalTimeStatsRecorder();
+    SingleFrontArrivalTime(
+      grid_size,
+      boundary_indices,
+      boundary_times,
+      eikonal_solver,
+      frozen_cell_visitor,
+      arrival_times->data(),
+      stats_recorder);
+    return;
+  }
+
+  auto const strides = GridStrides(grid_size);
+  auto const boundary_linear_indices =
+    BoundaryLinearIndices(boundary_indices, grid_size);
+  auto const is_boundary =
+    [&boundary_linear_indices, &strides](array<int32_t, N> const& index) {
+      return boundary_linear_indices.count(
+        GridLinearIndex(index, strides)) > 0;
+    };
+
+  // Whether the speed of a cell increased or decreased, its time and the
+  // times downstream of it are recomputed. Lowered times are then
+  // propagated when re-marching.
+  auto raised_seeds = vector<pair<T, array<int32_t, N>>>();
+  for (auto const& changed_speed_index : changed_speed_indices) {
+    if (!is_boundary(changed_speed_index)) {
+      auto& time_cell = time_grid.Cell(changed_speed_index);
+      if (Frozen(time_cell)) {
+        raised_seeds.push_back({time_cell, changed_speed_index});
+        time_cell = numeric_limits<T>::max();
+      }
+    }
+  }
+
+  auto narrow_band = NarrowBandStore<T, N>();
+  UpdateArrivalTimes(
+    eikonal_solver,
+    raised_seeds,
+    is_boundary,
+    &narrow_band,
+    &time_grid);
+
+  assert(all_of(begin(*arrival_times), end(*arrival_times),
+                [](T const t) { return Frozen(t); }));
+}
+
+
+//! Marches arrival times outward from a set of source cells, see
+//! GeodesicArrivalTime, in steps that can be interleaved with other work.
+//! The marcher owns the arrival time grid and the narrow band, so marching
+//! can be suspended after any step and resumed later. Marching the whole
+//! grid in steps solves exactly the same Eikonal equations as marching it
+//! in a single call.
+//!
+//! Usage:
+//!   Marcher<float, 2, EikonalSolverType> marcher(
+//!     grid_size, boundary_indices, boundary_times, eikonal_solver);
+//!   while (!marcher.done()) {
+//!     marcher.Step(1000); // Freeze at most 1000 cells per frame.
+//!     // Do other work, e.g. render marcher.arrival_times().
+//!   }
+template<typename T, std::size_t N, typename EikonalSolverType>
+class Marcher
+{
+public:
+  typedef T TimeType;
+  typedef std::array<std::int32_t, N> IndexType;
+
+  //! Set up marching from the boundary cells. No cells other than the
+  //! boundary cells are frozen until Step or MarchUntil is called.
+  //!
+  //! Throws std::invalid_argument if:
+  //! - The boundary condition is invalid (see SignedArrivalTime), or
+  //! - Any boundary time is negative.
+  Marcher(
+    std::array<std::size_t, N> const& grid_size,
+    std::vector<IndexType> const& boundary_indices,
+    std::vector<T> const& boundary_times,
+    EikonalSolverType const& eikonal_solver)
+    : eikonal_solver_(eikonal_solver)
+    , time_buffer_(
+        detail::LinearSize(grid_size),
+        std::numeric_limits<T>::max())
+    , time_grid_(grid_size, time_buffer_)
+  {
+    using namespace std;
+    using namespace detail;
+
+    static_assert(N >= 2, "dimensions must be >= 2");
+    static_assert(N == EikonalSolverType::kDimension,
+                  "mismatching eikonal solver dimension");
+
+    // Check input.
+    auto const boundary_time_predicate = [](auto const t) {
+      return !isnan(t) && Frozen(t) && t >= T{0};
+    };
+    ThrowIfInvalidBoundaryCondition(
+      grid_size,
+      boundary_indices,
+      boundary_times,
+      boundary_time_predicate);
+
+    auto const check_duplicate_indices = true;
+    SetBoundaryCondition(
+      boundary_indices,
+      boundary_times,
+      T{1}, // Multiplier.
+      check_duplicate_indices,
+      &time_grid_);
+
+    // Since the boundary cells do not cover the whole grid there is at
+    // least one non-frozen face-neighbor.
+    narrow_band_ = InitializedNarrowBand(
+      FaceNeighborNarrowBandIndices(boundary_indices, time_grid_),
+      time_grid_,
+      eikonal_solver_);
+  }
+
+  // The time grid refers to the time buffer, so copying is not allowed.
+  Marcher(Marcher const&) = delete;
+  Marcher& operator=(Marcher const&) = delete;
+
+  //! Freeze at most @a max_cell_count cells, in order of arrival time.
+  //! Returns the number of cells that were frozen, which is less than
+  //! @a max_cell_count only if marching is done.
+  std::size_t Step(std::size_t const max_cell_count)
+  {
+    auto frozen_cell_count = std::size_t{0};
+    auto frozen_cell_visitor = detail::NullFrozenCellVisitor();
+    while (frozen_cell_count < max_cell_count && !narrow_band_->empty()) {
+      if (detail::FreezeNarrowBandCell(
+            eikonal_solver_,
+            narrow_band_.get(),
+            &time_grid_,
+            frozen_cell_visitor)) {
+        ++frozen_cell_count;
+      }
+    }
+    return frozen_cell_count;
+  }
+
+  //! Freeze all cells with arrival times less than or equal to @a time.
+  //! Returns the number of cells that were frozen.
+  std::size_t MarchUntil(T const time)
+  {
+    auto frozen_cell_count = std::size_t{0};
+    auto frozen_cell_visitor = detail::NullFrozenCellVisitor();
+    while (!narrow_band_->empty() && narrow_band_->Top().first <= time) {
+      if (detail::FreezeNarrowBandCell(
+            eikonal_solver_,
+            narrow_band_.get(),
+            &time_grid_,
+            frozen_cell_visitor)) {
+        ++frozen_cell_count;
+      }
+    }
+    return frozen_cell_count;
+  }
+
+  //! Returns true if all cells reachable from the boundary cells have been
+  //! frozen, otherwise false.
+  bool done() const
+  {
+    return narrow_band_->empty();
+  }
+
+  //! Returns the arrival times of the grid cells. Cells that have not yet
+  //! been frozen have the time numeric_limits<T>::max().
+  std::vector<T> const& arrival_times() const
+  {
+    return time_buffer_;
+  }
+
+private:
+  EikonalSolverType const eikonal_solver_;
+  std::vector<T> time_buffer_;
+  detail::Grid<T, N> time_grid_;
+  std::unique_ptr<detail::NarrowBandStore<T, N>> narrow_band_;
+};
+
 } // namespace fast_marching_method
 } // namespace thinks
 
@@ -0,0 +1,1481 @@
+// Copyright 2017 Tommy Hinks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+#include <chrono>
+#include <random>
+#include <set>
+
+#include <gtest/gtest.h>
+
+#include "../include/thinks/fast_marching_method/fast_marching_method.hpp"
+#include "util.hpp"
+
+namespace {
+
+// Fixtures.
+
+template<typename T>
+class GeodesicArrivalTimeTest : public ::testing::Test {
+protected:
+  virtual ~GeodesicArrivalTimeTest() {}
+};
+
+template<typename T>
+class LabelledGeodesicArrivalTimeTest : public ::testing::Test {
+protected:
+  virtual ~LabelledGeodesicArrivalTimeTest() {}
+};
+
+template<typename T>
+class MarcherTest : public ::testing::Test {
+protected:
+  virtual ~MarcherTest() {}
+};
+
+template<typename T>
+class GeodesicPathTest : public ::testing::Test {
+protected:
+  virtual ~GeodesicPathTest() {}
+};
+
+template<typename T>
+class TravelTimeTableTest : public ::testing::Test {
+protected:
+  virtual ~TravelTimeTableTest() {}
+};
+
+template<typename T>
+class SparseGeodesicArrivalTimeTest : public ::testing::Test {
+protected:
+  virtual ~SparseGeodesicArrivalTimeTest() {}
+};
+
+
+// Associate types with fixtures.
+
+typedef ::testing::Types<
+  util::ScalarDimensionPair<float, 2>,
+  util::ScalarDimensionPair<float, 3>,
+  util::ScalarDimensionPair<float, 4>,
+  util::ScalarDimensionPair<double, 2>,
+  util::ScalarDimensionPair<double, 3>,
+  util::ScalarDimensionPair<double, 4>> GeodesicArrivalTimeTypes;
+
+TYPED_TEST_CASE(GeodesicArrivalTimeTest, GeodesicArrivalTimeTypes);
+TYPED_TEST_CASE(LabelledGeodesicArrivalTimeTest, GeodesicArrivalTimeTypes);
+TYPED_TEST_CASE(MarcherTest, GeodesicArrivalTimeTypes);
+TYPED_TEST_CASE(GeodesicPathTest, GeodesicArrivalTimeTypes);
+TYPED_TEST_CASE(TravelTimeTableTest, GeodesicArrivalTimeTypes);
+TYPED_TEST_CASE(SparseGeodesicArrivalTimeTest, GeodesicArrivalTimeTypes);
+
+
+//! Returns the largest absolute difference between arrival times computed
+//! by updating the times for @a previous_boundary_indices and
+//! @a previous_boundary_times, and arrival times computed by marching the
+//! whole grid with @a boundary_indices and @a boundary_times.
+template<typename T, std::size_t N, typename E>
+T MaxUpdateError(
+  std::array<std::size_t, N> const& grid_size,
+  std::vector<std::array<std::int32_t, N>> const& previous_boundary_indices,
+  std::vector<T> const& previous_boundary_times,
+  std::vector<std::array<std::int32_t, N>> const& boundary_indices,
+  std::vector<T> const& boundary_times,
+  std::vector<std::array<std::int32_t, N>> const& removed_boundary_indices,
+  E const& eikonal_solver)
+{
+  using namespace std;
+  namespace fmm = thinks::fast_marching_method;
+
+  auto updated_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    previous_boundary_indices,
+    previous_boundary_times,
+    eikonal_solver);
+  fmm::UpdateGeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    removed_boundary_indices,
+    eikonal_solver,
+    &updated_times);
+  auto const expected_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+
+  auto max_error = T{0};
+  for (auto i = size_t{0}; i < expected_times.size(); ++i) {
+    max_error = max(max_error, abs(expected_times[i] - updated_times[i]));
+  }
+  return max_error;
+}
+
+
+//! Eikonal solver that forwards to another solver, as user-defined solvers
+//! wrapping the solvers in the library do. Does not declare a stencil
+//! reach.
+template<typename E>
+class ForwardingEikonalSolver
+{
+public:
+  typedef typename E::ScalarType ScalarType;
+  static std::size_t const kDimension = E::kDimension;
+
+  explicit ForwardingEikonalSolver(E const& eikonal_solver)
+    : eikonal_solver_(eikonal_solver)
+  {}
+
+  template<typename G>
+  ScalarType Solve(
+    std::array<std::int32_t, kDimension> const& index,
+    G const& time_grid) const
+  {
+    return eikonal_solver_.Solve(index, time_grid);
+  }
+
+private:
+  E const eikonal_solver_;
+};
+
+
+// GeodesicArrivalTime fixture.
+
+TYPED_TEST(GeodesicArrivalTimeTest, NegativeBoundaryTimeThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{-1});
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const arrival_times = fmm::GeodesicArrivalTime(
+        grid_size,
+        boundary_indices,
+        boundary_times,
+        EikonalSolverType(grid_spacing, uniform_speed));
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ("invalid boundary time: -1", ft.second);
+}
+
+TYPED_TEST(GeodesicArrivalTimeTest, FrozenCellVisitor)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+
+  // Histogram of arrival times with unit bins, computed while marching.
+  auto histogram = vector<size_t>();
+  auto previous_time = ScalarType{0};
+  auto increasing = true;
+
+  // Act.
+  auto const arrival_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    [&](array<int32_t, kDimension> const&, ScalarType const time) {
+      auto const bin = static_cast<size_t>(time);
+      if (bin >= histogram.size()) {
+        histogram.resize(bin + 1, size_t{0});
+      }
+      ++histogram[bin];
+      increasing = increasing && previous_time <= time;
+      previous_time = time;
+    });
+
+  // Assert.
+  // Cells are visited in order of increasing time, and the histogram is
+  // the same as when computed from the returned times.
+  ASSERT_TRUE(increasing);
+  auto expected_histogram = vector<size_t>(histogram.size(), size_t{0});
+  for (auto const time : arrival_times) {
+    ++expected_histogram[static_cast<size_t>(time)];
+  }
+  ASSERT_EQ(expected_histogram, histogram);
+}
+
+TYPED_TEST(GeodesicArrivalTimeTest, PhaseTimes)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto stats = fmm::ArrivalTimeStats();
+
+  // Act.
+  auto const expected_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+  auto const times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    &stats);
+
+  // Assert.
+  // A single front is marched as outside cells.
+  ASSERT_EQ(expected_times, times);
+  ASSERT_LT(0, stats.validation.count());
+  ASSERT_EQ(0, stats.topology.count());
+  ASSERT_EQ(0, stats.inside_march.count());
+  ASSERT_LT(0, stats.outside_march.count());
+}
+
+TYPED_TEST(GeodesicArrivalTimeTest, MarchCounts)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  // Not value initialized, all times and counts start at zero anyway.
+  fmm::ArrivalTimeStats stats;
+
+  // Act.
+  fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    &stats);
+  auto const first_stats = stats;
+  fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    &stats);
+
+  // Assert.
+  // No topology analysis for a single front. Counts are added by the second
+  // call, except the peak narrow band size.
+  auto const frozen_count = util::LinearSize(grid_size) - size_t{1};
+  ASSERT_EQ(size_t{0}, first_stats.connected_component_count);
+  ASSERT_EQ(size_t{0}, first_stats.dilation_band_count);
+  ASSERT_EQ(first_stats.push_count, first_stats.solve_count);
+  ASSERT_EQ(
+    frozen_count + first_stats.stale_pop_count,
+    first_stats.push_count);
+  ASSERT_LT(size_t{0}, first_stats.stale_pop_count);
+  ASSERT_EQ(2 * first_stats.push_count, stats.push_count);
+  ASSERT_EQ(2 * first_stats.stale_pop_count, stats.stale_pop_count);
+  ASSERT_EQ(first_stats.peak_narrow_band_size, stats.peak_narrow_band_size);
+}
+
+TYPED_TEST(GeodesicArrivalTimeTest, UpdateArrivalTimesSizeMismatchThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const removed_boundary_indices = vector<array<int32_t, kDimension>>();
+
+  auto expected_reason = stringstream();
+  expected_reason << "grid size " << util::ToString(grid_size)
+                  << " does not match cell buffer size "
+                  << util::LinearSize(grid_size) - 1;
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto arrival_times = vector<ScalarType>(
+        util::LinearSize(grid_size) - 1, ScalarType{0});
+      fmm::UpdateGeodesicArrivalTime(
+        grid_size,
+        boundary_indices,
+        boundary_times,
+        removed_boundary_indices,
+        EikonalSolverType(grid_spacing, uniform_speed),
+        &arrival_times);
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ(expected_reason.str(), ft.second);
+}
+
+TYPED_TEST(GeodesicArrivalTimeTest, RemovedBoundaryIndexOutsideGridThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const removed_boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{10}));
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+  auto const arrival_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+
+  auto expected_reason = stringstream();
+  expected_reason << "boundary index outside grid - "
+                  << "index: " << util::ToString(removed_boundary_indices[0])
+                  << ", grid size: " << util::ToString(grid_size);
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto updated_times = arrival_times;
+      fmm::UpdateGeodesicArrivalTime(
+        grid_size,
+        boundary_indices,
+        boundary_times,
+        removed_boundary_indices,
+        eikonal_solver,
+        &updated_times);
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ(expected_reason.str(), ft.second);
+}
+
+TYPED_TEST(GeodesicArrivalTimeTest, UpdateMatchesFullGrid)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+
+  auto const a = util::FilledArray<kDimension>(int32_t{3});
+  auto b = util::FilledArray<kDimension>(int32_t{12});
+  b[0] = int32_t{9};
+  auto const a_indices = vector<array<int32_t, kDimension>>{a};
+  auto const b_indices = vector<array<int32_t, kDimension>>{b};
+  auto const ab_indices = vector<array<int32_t, kDimension>>{a, b};
+  auto const a_times = vector<ScalarType>{ScalarType{0}};
+  auto const ab_times = vector<ScalarType>{ScalarType{0}, ScalarType{0}};
+  auto const ab_raised_times =
+    vector<ScalarType>{ScalarType{0}, ScalarType{7}};
+  auto const no_indices = vector<array<int32_t, kDimension>>();
+
+  // Act.
+  auto const add_error = MaxUpdateError(
+    grid_size, a_indices, a_times, ab_indices, ab_times, no_indices,
+    eikonal_solver);
+  auto const remove_error = MaxUpdateError(
+    grid_size, ab_indices, ab_times, a_indices, a_times, b_indices,
+    eikonal_solver);
+  auto const raise_error = MaxUpdateError(
+    grid_size, ab_indices, ab_times, ab_indices, ab_raised_times, no_indices,
+    eikonal_solver);
+  auto const lower_error = MaxUpdateError(
+    grid_size, ab_indices, ab_raised_times, ab_indices, ab_times, no_indices,
+    eikonal_solver);
+
+  // Assert.
+  // First order solvers give the same times as marching the whole grid,
+  // up to rounding errors from solving in a different order.
+  auto const tolerance = ScalarType{256} *
+    numeric_limits<ScalarType>::epsilon() * ScalarType(grid_size[0]);
+  ASSERT_LE(add_error, tolerance);
+  ASSERT_LE(remove_error, tolerance);
+  ASSERT_LE(raise_error, tolerance);
+  ASSERT_LE(lower_error, tolerance);
+}
+
+TYPED_TEST(GeodesicArrivalTimeTest, HighAccuracyUpdateMatchesFullGrid)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::HighAccuracyUniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+
+  auto const a = util::FilledArray<kDimension>(int32_t{3});
+  auto b = util::FilledArray<kDimension>(int32_t{12});
+  b[0] = int32_t{9};
+  auto const a_indices = vector<array<int32_t, kDimension>>{a};
+  auto const b_indices = vector<array<int32_t, kDimension>>{b};
+  auto const ab_indices = vector<array<int32_t, kDimension>>{a, b};
+  auto const a_times = vector<ScalarType>{ScalarType{0}};
+  auto const ab_times = vector<ScalarType>{ScalarType{0}, ScalarType{0}};
+  auto const no_indices = vector<array<int32_t, kDimension>>();
+
+  // Act.
+  auto const add_error = MaxUpdateError(
+    grid_size, a_indices, a_times, ab_indices, ab_times, no_indices,
+    eikonal_solver);
+  auto const remove_error = MaxUpdateError(
+    grid_size, ab_indices, ab_times, a_indices, a_times, b_indices,
+    eikonal_solver);
+
+  // Assert.
+  ASSERT_EQ(ScalarType{0}, add_error);
+  ASSERT_EQ(ScalarType{0}, remove_error);
+}
+
+TYPED_TEST(GeodesicArrivalTimeTest, WrappedHighAccuracyUpdateMatchesFullGrid)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::HighAccuracyUniformSpeedEikonalSolver<ScalarType, kDimension>
+    WrappedEikonalSolverType;
+  typedef ForwardingEikonalSolver<WrappedEikonalSolverType> EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const eikonal_solver = EikonalSolverType(
+    WrappedEikonalSolverType(grid_spacing, uniform_speed));
+
+  auto const a = util::FilledArray<kDimension>(int32_t{3});
+  auto b = util::FilledArray<kDimension>(int32_t{12});
+  b[0] = int32_t{9};
+  auto const a_indices = vector<array<int32_t, kDimension>>{a};
+  auto const b_indices = vector<array<int32_t, kDimension>>{b};
+  auto const ab_indices = vector<array<int32_t, kDimension>>{a, b};
+  auto const a_times = vector<ScalarType>{ScalarType{0}};
+  auto const ab_times = vector<ScalarType>{ScalarType{0}, ScalarType{0}};
+  auto const no_indices = vector<array<int32_t, kDimension>>();
+
+  // Act.
+  auto const add_error = MaxUpdateError(
+    grid_size, a_indices, a_times, ab_indices, ab_times, no_indices,
+    eikonal_solver);
+  auto const remove_error = MaxUpdateError(
+    grid_size, ab_indices, ab_times, a_indices, a_times, b_indices,
+    eikonal_solver);
+
+  // Assert.
+  // Solvers that do not declare a stencil reach are not updated
+  // incrementally.
+  ASSERT_EQ(ScalarType{0}, add_error);
+  ASSERT_EQ(ScalarType{0}, remove_error);
+}
+
+TYPED_TEST(GeodesicArrivalTimeTest, SpeedIndexOutsideGridThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const changed_speed_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{-1}));
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+  auto const arrival_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+
+  auto expected_reason = stringstream();
+  expected_reason << "speed index outside grid - "
+                  << "index: " << util::ToString(changed_speed_indices[0])
+                  << ", grid size: " << util::ToString(grid_size);
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto updated_times = arrival_times;
+      fmm::UpdateGeodesicArrivalTimeForSpeedChange(
+        grid_size,
+        boundary_indices,
+        changed_speed_indices,
+        eikonal_solver,
+        &updated_times);
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ(expected_reason.str(), ft.second);
+}
+
+TYPED_TEST(GeodesicArrivalTimeTest, SpeedChangeMatchesFullGrid)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::VaryingSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{3}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+
+  auto random_engine = mt19937();
+  auto distribution =
+    uniform_real_distribution<ScalarType>(ScalarType{0.5}, ScalarType{1});
+  auto speed_buffer = vector<ScalarType>(util::LinearSize(grid_size));
+  for (auto& speed : speed_buffer) {
+    speed = distribution(random_engine);
+  }
+  auto arrival_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, grid_size, speed_buffer));
+
+  // Slow down cells in one box and speed up cells in another box, touching
+  // the boundary cell.
+  auto changed_speed_indices = vector<array<int32_t, kDimension>>();
+  for (auto i = size_t{0}; i < speed_buffer.size(); ++i) {
+    auto index = array<int32_t, kDimension>();
+    auto linear_index = i;
+    for (auto j = size_t{0}; j < kDimension; ++j) {
+      index[j] = static_cast<int32_t>(linear_index % grid_size[j]);
+      linear_index /= grid_size[j];
+    }
+    auto const in_slow_box = all_of(begin(index), end(index),
+      [](auto const x) { return 6 <= x && x < 9; });
+    auto const in_fast_box = all_of(begin(index), end(index),
+      [](auto const x) { return 2 <= x && x < 5; });
+    if (in_slow_box || in_fast_box) {
+      speed_buffer[i] = in_slow_box ? ScalarType{0.1} : ScalarType{2};
+      changed_speed_indices.push_back(index);
+    }
+  }
+
+  // Act.
+  auto const eikonal_solver =
+    EikonalSolverType(grid_spacing, grid_size, speed_buffer);
+  fmm::UpdateGeodesicArrivalTimeForSpeedChange(
+    grid_size,
+    boundary_indices,
+    changed_speed_indices,
+    eikonal_solver,
+    &arrival_times);
+  auto const expected_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+
+  // Assert.
+  ASSERT_EQ(expected_times.size(), arrival_times.size());
+  for (auto i = size_t{0}; i < expected_times.size(); ++i) {
+    ASSERT_NEAR(
+      expected_times[i],
+      arrival_times[i],
+      ScalarType{256} * numeric_limits<ScalarType>::epsilon() *
+        max(ScalarType{1}, expected_times[i]));
+  }
+}
+
+TYPED_TEST(GeodesicArrivalTimeTest, HighAccuracySpeedChangeMatchesFullGrid)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::HighAccuracyVaryingSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{3}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+
+  // Smooth speeds, so that the high accuracy solver does not fail.
+  auto speed_buffer = vector<ScalarType>(util::LinearSize(grid_size));
+  auto indices = vector<array<int32_t, kDimension>>();
+  for (auto i = size_t{0}; i < speed_buffer.size(); ++i) {
+    auto index = array<int32_t, kDimension>();
+    auto linear_index = i;
+    for (auto j = size_t{0}; j < kDimension; ++j) {
+      index[j] = static_cast<int32_t>(linear_index % grid_size[j]);
+      linear_index /= grid_size[j];
+    }
+    speed_buffer[i] = ScalarType{1} + ScalarType(0.2) *
+      sin(ScalarType(0.5) * index[0]) * cos(ScalarType(0.5) * index[1]);
+    indices.push_back(index);
+  }
+  auto arrival_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, grid_size, speed_buffer));
+
+  // Slow down cells in one box and speed up cells in another box.
+  auto changed_speed_indices = vector<array<int32_t, kDimension>>();
+  for (auto i = size_t{0}; i < speed_buffer.size(); ++i) {
+    auto const& index = indices[i];
+    auto const in_slow_box = all_of(begin(index), end(index),
+      [](auto const x) { return 6 <= x && x < 9; });
+    auto const in_fast_box = all_of(begin(index), end(index),
+      [](auto const x) { return 10 <= x && x < 13; });
+    if (in_slow_box || in_fast_box) {
+      speed_buffer[i] = in_slow_box ? ScalarType(0.7) : ScalarType(1.3);
+      changed_speed_indices.push_back(index);
+    }
+  }
+
+  // Act.
+  auto const eikonal_solver =
+    EikonalSolverType(grid_spacing, grid_size, speed_buffer);
+  fmm::UpdateGeodesicArrivalTimeForSpeedChange(
+    grid_size,
+    boundary_indices,
+    changed_speed_indices,
+    eikonal_solver,
+    &arrival_times);
+  auto const expected_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+
+  // Assert.
+  // High accuracy solvers are not updated incrementally, since changed
+  // times are read two steps away.
+  ASSERT_EQ(expected_times, arrival_times);
+}
+
+
+// LabelledGeodesicArrivalTime fixture.
+
+TYPED_TEST(LabelledGeodesicArrivalTimeTest, LabelsSizeMismatchThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const boundary_labels = vector<int>(2, 1);
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const result = fmm::LabelledGeodesicArrivalTime(
+        grid_size,
+        boundary_indices,
+        boundary_times,
+        boundary_labels,
+        EikonalSolverType(grid_spacing, uniform_speed));
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ("boundary indices[1] / boundary labels[2] size mismatch",
+            ft.second);
+}
+
+TYPED_TEST(LabelledGeodesicArrivalTimeTest, NearestSource)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+
+  auto const a = util::FilledArray<kDimension>(int32_t{3});
+  auto b = util::FilledArray<kDimension>(int32_t{12});
+  b[0] = int32_t{9};
+  auto const c = util::FilledArray<kDimension>(int32_t{13});
+  auto const boundary_indices = vector<array<int32_t, kDimension>>{a, b, c};
+  auto const boundary_times =
+    vector<ScalarType>{ScalarType{0}, ScalarType{0}, ScalarType{0}};
+  auto const boundary_labels = vector<int>{7, 8, 9};
+
+  // Act.
+  auto const result = fmm::LabelledGeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    boundary_labels,
+    eikonal_solver);
+
+  // Assert.
+  // Times are the same as without labels. Labels are those of the nearest
+  // source, except close to the boundaries between the regions of
+  // different sources.
+  auto const& arrival_times = result.first;
+  auto const& labels = result.second;
+  ASSERT_EQ(
+    fmm::GeodesicArrivalTime(
+      grid_size, boundary_indices, boundary_times, eikonal_solver),
+    arrival_times);
+  auto labels_copy = labels;
+  auto const label_grid =
+    util::Grid<int, kDimension>(grid_size, labels_copy.front());
+  auto index_iter = util::IndexIterator<kDimension>(grid_size);
+  auto checked_count = size_t{0};
+  while (index_iter.has_next()) {
+    auto const index = index_iter.index();
+    auto distances = vector<pair<ScalarType, int>>();
+    for (auto i = size_t{0}; i < boundary_indices.size(); ++i) {
+      distances.push_back({
+        util::Distance(
+          util::CellCenter(index, grid_spacing),
+          util::CellCenter(boundary_indices[i], grid_spacing)),
+        boundary_labels[i]});
+    }
+    sort(begin(distances), end(distances));
+    if (distances[1].first - distances[0].first > ScalarType{1.5}) {
+      ASSERT_EQ(distances[0].second, label_grid.Cell(index));
+      ++checked_count;
+    }
+    index_iter.Next();
+  }
+  ASSERT_GT(checked_count, arrival_times.size() / 2);
+}
+
+
+TYPED_TEST(LabelledGeodesicArrivalTimeTest, ClosestBoundaryIndices)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+
+  auto boundary_indices = vector<array<int32_t, kDimension>>();
+  auto boundary_times = vector<ScalarType>();
+  util::BoxBoundaryCells(
+    util::FilledArray<kDimension>(int32_t{4}),
+    util::FilledArray<kDimension>(size_t{6}),
+    grid_size,
+    &boundary_indices,
+    &boundary_times);
+  for (auto& boundary_time : boundary_times) {
+    boundary_time = abs(boundary_time);
+  }
+
+  // Act.
+  auto const result = fmm::ClosestBoundaryGeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed));
+
+  // Assert.
+  // Closest boundary indices are boundary cells, and boundary cells are
+  // their own closest boundary cells. The distance to the closest boundary
+  // cell is close to the arrival time, since the speed is one. First order
+  // times are somewhat too large along diagonals.
+  auto arrival_times = result.first;
+  auto closest_indices = result.second;
+  auto const time_grid =
+    util::Grid<ScalarType, kDimension>(grid_size, arrival_times.front());
+  auto const closest_grid =
+    util::Grid<array<int32_t, kDimension>, kDimension>(
+      grid_size, closest_indices.front());
+  auto const boundary_set = set<array<int32_t, kDimension>>(
+    begin(boundary_indices), end(boundary_indices));
+  for (auto const& boundary_index : boundary_indices) {
+    ASSERT_EQ(boundary_index, closest_grid.Cell(boundary_index));
+  }
+  auto index_iter = util::IndexIterator<kDimension>(grid_size);
+  while (index_iter.has_next()) {
+    auto const index = index_iter.index();
+    auto const closest_index = closest_grid.Cell(index);
+    ASSERT_EQ(size_t{1}, boundary_set.count(closest_index));
+    auto const distance = util::Distance(
+      util::CellCenter(index, grid_spacing),
+      util::CellCenter(closest_index, grid_spacing));
+    ASSERT_NEAR(distance, time_grid.Cell(index), ScalarType{2});
+    index_iter.Next();
+  }
+}
+
+
+// Marcher fixture.
+
+TYPED_TEST(MarcherTest, NegativeBoundaryTimeThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{-1});
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      fmm::Marcher<ScalarType, kDimension, EikonalSolverType> marcher(
+        grid_size,
+        boundary_indices,
+        boundary_times,
+        EikonalSolverType(grid_spacing, uniform_speed));
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ("invalid boundary time: -1", ft.second);
+}
+
+TYPED_TEST(MarcherTest, StepsMatchGeodesicArrivalTime)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::HighAccuracyUniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const step_size = size_t{100};
+
+  // Act.
+  auto const expected_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+  fmm::Marcher<ScalarType, kDimension, EikonalSolverType> marcher(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+  auto step_count = size_t{0};
+  auto frozen_cell_count = size_t{0};
+  while (!marcher.done()) {
+    auto const step_frozen_cell_count = marcher.Step(step_size);
+    ASSERT_LE(step_frozen_cell_count, step_size);
+    frozen_cell_count += step_frozen_cell_count;
+    ++step_count;
+  }
+
+  // Assert.
+  // Step-wise marching gives exactly the same times as a single call.
+  ASSERT_EQ(expected_times, marcher.arrival_times());
+  ASSERT_EQ(util::LinearSize(grid_size) - boundary_indices.size(),
+            frozen_cell_count);
+  ASSERT_GT(step_count, size_t{1});
+  ASSERT_EQ(size_t{0}, marcher.Step(step_size));
+}
+
+TYPED_TEST(MarcherTest, MarchUntil)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const until_time = ScalarType{4};
+
+  // Act.
+  auto const expected_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+  fmm::Marcher<ScalarType, kDimension, EikonalSolverType> marcher(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+  marcher.MarchUntil(until_time);
+  auto const until_times = marcher.arrival_times();
+  marcher.MarchUntil(numeric_limits<ScalarType>::max());
+
+  // Assert.
+  // Cells up to the time are frozen with their final times, other cells
+  // are not frozen. Marching can be resumed afterwards.
+  for (auto i = size_t{0}; i < expected_times.size(); ++i) {
+    if (expected_times[i] <= until_time) {
+      ASSERT_EQ(expected_times[i], until_times[i]);
+    }
+    else {
+      ASSERT_EQ(numeric_limits<ScalarType>::max(), until_times[i]);
+    }
+  }
+  ASSERT_TRUE(marcher.done());
+  ASSERT_EQ(expected_times, marcher.arrival_times());
+}
+
+
+
+// GeodesicPath fixture.
+
+TYPED_TEST(GeodesicPathTest, StartPositionOutsideGridThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const arrival_times =
+    vector<ScalarType>(util::LinearSize(grid_size), ScalarType{1});
+  auto const start_position = util::FilledArray<kDimension>(ScalarType{10});
+  auto const step_length = ScalarType{0.25};
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const path = fmm::GeodesicPath(
+        grid_size,
+        grid_spacing,
+        arrival_times,
+        start_position,
+        step_length);
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  auto ss = stringstream();
+  ss << "position outside grid - "
+     << "position: " << util::ToString(start_position) << ", "
+     << "grid size: " << util::ToString(grid_size);
+  ASSERT_EQ(ss.str(), ft.second);
+}
+
+TYPED_TEST(GeodesicPathTest, InvalidStepLengthThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const arrival_times =
+    vector<ScalarType>(util::LinearSize(grid_size), ScalarType{1});
+  auto const start_position = util::FilledArray<kDimension>(ScalarType{5});
+  auto const invalid_step_lengths = array<ScalarType, 3>{{
+    ScalarType{0},
+    ScalarType{1},
+    numeric_limits<ScalarType>::quiet_NaN()}};
+
+  for (auto const invalid_step_length : invalid_step_lengths) {
+    // Act.
+    auto const ft = util::FunctionThrows<invalid_argument>(
+      [=]() {
+        auto const path = fmm::GeodesicPath(
+          grid_size,
+          grid_spacing,
+          arrival_times,
+          start_position,
+          invalid_step_length);
+      });
+
+    // Assert.
+    ASSERT_TRUE(ft.first);
+    auto ss = stringstream();
+    ss << "invalid step length: " << invalid_step_length;
+    ASSERT_EQ(ss.str(), ft.second);
+  }
+}
+
+TYPED_TEST(GeodesicPathTest, PointSourceStraightPath)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::HighAccuracyUniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{20});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const source_position = util::FilledArray<kDimension>(ScalarType{5.5});
+  auto start_position = util::FilledArray<kDimension>(ScalarType{9.5});
+  start_position[0] = ScalarType{15.5};
+  auto const step_length = ScalarType{0.25};
+  auto const arrival_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed));
+
+  // Act.
+  auto const path = fmm::GeodesicPath(
+    grid_size,
+    grid_spacing,
+    arrival_times,
+    start_position,
+    step_length);
+
+  // Assert.
+  // The path starts at the start position and ends at the source cell
+  // center, staying close to the straight line between them.
+  ASSERT_GT(path.size(), size_t{2});
+  ASSERT_EQ(start_position, path.front());
+  ASSERT_EQ(source_position, path.back());
+  auto line = array<ScalarType, kDimension>();
+  for (auto i = size_t{0}; i < kDimension; ++i) {
+    line[i] = source_position[i] - start_position[i];
+  }
+  auto const line_length_squared =
+    inner_product(begin(line), end(line), begin(line), ScalarType{0});
+  for (auto const& position : path) {
+    auto offset = array<ScalarType, kDimension>();
+    for (auto i = size_t{0}; i < kDimension; ++i) {
+      offset[i] = position[i] - start_position[i];
+    }
+    auto const s = inner_product(
+      begin(offset), end(offset), begin(line), ScalarType{0}) /
+      line_length_squared;
+    auto distance_squared = ScalarType{0};
+    for (auto i = size_t{0}; i < kDimension; ++i) {
+      auto const d = offset[i] - s * line[i];
+      distance_squared += d * d;
+    }
+    ASSERT_LE(sqrt(distance_squared), ScalarType{0.5});
+  }
+}
+
+TYPED_TEST(GeodesicPathTest, BatchMatchesSinglePaths)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{12});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{0.5});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>{
+    util::FilledArray<kDimension>(int32_t{2}),
+    util::FilledArray<kDimension>(int32_t{9})};
+  auto const boundary_times = vector<ScalarType>(2, ScalarType{0});
+  auto const arrival_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed));
+  auto const step_length = ScalarType{0.1};
+  auto start_positions = vector<array<ScalarType, kDimension>>();
+  for (auto i = int32_t{0}; i < 12; ++i) {
+    auto start_position = util::FilledArray<kDimension>(ScalarType{3});
+    start_position[0] = (i + ScalarType(0.5)) * grid_spacing[0];
+    start_positions.push_back(start_position);
+  }
+
+  // Act.
+  auto const paths = fmm::GeodesicPaths(
+    grid_size,
+    grid_spacing,
+    arrival_times,
+    start_positions,
+    step_length,
+    size_t{4});
+
+  // Assert.
+  // Paths are returned in the same order as the start positions.
+  ASSERT_EQ(start_positions.size(), paths.size());
+  for (auto i = size_t{0}; i < start_positions.size(); ++i) {
+    auto const path = fmm::GeodesicPath(
+      grid_size,
+      grid_spacing,
+      arrival_times,
+      start_positions[i],
+      step_length);
+    ASSERT_EQ(path, paths[i]);
+  }
+}
+
+
+
+// TravelTimeTable fixture.
+
+TYPED_TEST(TravelTimeTableTest, ReceiverIndexOutsideGridThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const source_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const receiver_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{10}));
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const table = fmm::TravelTimeTable(
+        grid_size,
+        source_indices,
+        receiver_indices,
+        EikonalSolverType(grid_spacing, uniform_speed),
+        size_t{1});
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  auto ss = stringstream();
+  ss << "receiver index outside grid - "
+     << "index: " << util::ToString(receiver_indices[0]) << ", "
+     << "grid size: " << util::ToString(grid_size);
+  ASSERT_EQ(ss.str(), ft.second);
+}
+
+TYPED_TEST(TravelTimeTableTest, MatchesGeodesicArrivalTime)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::VaryingSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{0.1});
+  auto speed_buffer = vector<ScalarType>(util::LinearSize(grid_size));
+  auto gen = mt19937();
+  auto dist = uniform_real_distribution<double>(0.5, 2.0);
+  for (auto& speed : speed_buffer) {
+    speed = static_cast<ScalarType>(dist(gen));
+  }
+  auto const eikonal_solver =
+    EikonalSolverType(grid_spacing, grid_size, speed_buffer);
+  auto source_indices = vector<array<int32_t, kDimension>>();
+  auto receiver_indices = vector<array<int32_t, kDimension>>();
+  for (auto i = int32_t{0}; i < 6; ++i) {
+    auto source_index = util::FilledArray<kDimension>(int32_t{0});
+    source_index[0] = i;
+    source_indices.push_back(source_index);
+    auto receiver_index = util::FilledArray<kDimension>(int32_t{9});
+    receiver_index[1] = 2 * i - 1 < 0 ? 0 : 2 * i - 1;
+    receiver_indices.push_back(receiver_index);
+  }
+  receiver_indices.push_back(source_indices[2]); // Receiver at a source.
+  receiver_indices.push_back(receiver_indices[0]); // Duplicate receiver.
+
+  // Act.
+  auto const table = fmm::TravelTimeTable(
+    grid_size,
+    source_indices,
+    receiver_indices,
+    eikonal_solver,
+    size_t{3});
+  auto const volumes = fmm::TravelTimeVolumes(
+    grid_size,
+    source_indices,
+    eikonal_solver,
+    size_t{3});
+
+  // Assert.
+  // Same times as marching each source separately.
+  ASSERT_EQ(source_indices.size(), table.size());
+  ASSERT_EQ(source_indices.size(), volumes.size());
+  for (auto i = size_t{0}; i < source_indices.size(); ++i) {
+    auto expected_times = fmm::GeodesicArrivalTime(
+      grid_size,
+      vector<array<int32_t, kDimension>>(1, source_indices[i]),
+      vector<ScalarType>(1, ScalarType{0}),
+      eikonal_solver);
+    auto const time_grid =
+      util::Grid<ScalarType, kDimension>(grid_size, expected_times.front());
+    ASSERT_EQ(expected_times, volumes[i]);
+    ASSERT_EQ(receiver_indices.size(), table[i].size());
+    for (auto j = size_t{0}; j < receiver_indices.size(); ++j) {
+      ASSERT_EQ(time_grid.Cell(receiver_indices[j]), table[i][j]);
+    }
+  }
+}
+
+
+// SparseGeodesicArrivalTime fixture.
+
+TYPED_TEST(SparseGeodesicArrivalTimeTest, InvalidMaxTimeThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const max_time = ScalarType{-1};
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const time_grid = fmm::SparseGeodesicArrivalTime(
+        grid_size,
+        boundary_indices,
+        boundary_times,
+        EikonalSolverType(grid_spacing, uniform_speed),
+        max_time);
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  auto ss = stringstream();
+  ss << "invalid max time: " << max_time;
+  ASSERT_EQ(ss.str(), ft.second);
+}
+
+TYPED_TEST(SparseGeodesicArrivalTimeTest, MatchesDenseInsideBand)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{20});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{0}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const max_time = ScalarType{4};
+
+  // Act.
+  auto const time_grid = fmm::SparseGeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    max_time);
+
+  // Assert.
+  // Cells up to max time have the same times as when marching the whole
+  // grid, all other cells are not set.
+  auto expected_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+  auto const expected_grid =
+    util::Grid<ScalarType, kDimension>(grid_size, expected_times.front());
+  auto const dense_times = time_grid.DenseBuffer();
+  auto band_cell_count = size_t{0};
+  ASSERT_EQ(expected_times.size(), dense_times.size());
+  for (auto i = size_t{0}; i < expected_times.size(); ++i) {
+    if (expected_times[i] <= max_time) {
+      ASSERT_EQ(expected_times[i], dense_times[i]);
+      ++band_cell_count;
+    }
+    else {
+      ASSERT_EQ(numeric_limits<ScalarType>::max(), dense_times[i]);
+    }
+  }
+
+  auto frozen_cell_count = size_t{0};
+  time_grid.ForEachFrozenCell(
+    [&](auto const& index, auto const time) {
+      ASSERT_EQ(expected_grid.Cell(index), time);
+      ++frozen_cell_count;
+    });
+  ASSERT_EQ(band_cell_count, frozen_cell_count);
+
+  // Only the leaf containing the band is allocated.
+  auto const leaf_origins = time_grid.LeafOrigins();
+  ASSERT_EQ(size_t{1}, time_grid.leaf_count());
+  ASSERT_EQ(size_t{1}, leaf_origins.size());
+  ASSERT_EQ(util::FilledArray<kDimension>(int32_t{0}), leaf_origins[0]);
+}
+
+} // namespace
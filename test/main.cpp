@@ -47,6 +47,21 @@ int main(int argc, char* argv[])
 #if 1
     "UnsignedArrivalTimeTest*" ":"
     "SignedArrivalTimeTest*" ":"
+    "ReinitializedSignedArrivalTimeTest*" ":"
+    "BatchSignedArrivalTimeTest*" ":"
+    "LargeGridTest*" ":"
+    "TargetArrivalTimeTest*" ":"
+    "BidirectionalArrivalTimeTest*" ":"
+    "HeuristicTargetArrivalTimeTest*" ":"
+    "GeodesicArrivalTimeTest*" ":"
+    "LabelledGeodesicArrivalTimeTest*" ":"
+    "MarcherTest*" ":"
+    "GeodesicPathTest*" ":"
+    "TravelTimeTableTest*" ":"
+    "SparseGeodesicArrivalTimeTest*" ":"
+    "MappedGridTest*" ":"
+    "MappedGridMemoryLimitTest*" ":"
+    "GridFileTest*" ":"
 #endif
 
 #if 0
@@ -0,0 +1,581 @@
+// Copyright 2017 Tommy Hinks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "../include/thinks/fast_marching_method/fast_marching_method.hpp"
+#include "util.hpp"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+
+namespace {
+
+// Fixtures.
+
+template<typename T>
+class MappedGridTest : public ::testing::Test {
+protected:
+  virtual ~MappedGridTest() {}
+};
+
+template<typename T>
+class GridFileTest : public ::testing::Test {
+protected:
+  virtual ~GridFileTest() {}
+};
+
+
+// Associate types with fixtures.
+
+typedef ::testing::Types<
+  util::ScalarDimensionPair<float, 2>,
+  util::ScalarDimensionPair<float, 3>,
+  util::ScalarDimensionPair<float, 4>,
+  util::ScalarDimensionPair<double, 2>,
+  util::ScalarDimensionPair<double, 3>,
+  util::ScalarDimensionPair<double, 4>> MappedGridTypes;
+
+TYPED_TEST_CASE(MappedGridTest, MappedGridTypes);
+TYPED_TEST_CASE(GridFileTest, MappedGridTypes);
+
+
+//! A new, empty temporary file that is removed when the object is
+//! destroyed.
+class TemporaryFile
+{
+public:
+  TemporaryFile()
+    : path_("/tmp/fast_marching_method_XXXXXX")
+  {
+    auto const file_descriptor = mkstemp(&path_[0]);
+    if (file_descriptor == -1) {
+      throw std::runtime_error("failed to create temporary file");
+    }
+    close(file_descriptor);
+  }
+
+  ~TemporaryFile()
+  {
+    std::remove(path_.c_str());
+  }
+
+  TemporaryFile(TemporaryFile const&) = delete;
+  TemporaryFile& operator=(TemporaryFile const&) = delete;
+
+  std::string const& path() const
+  {
+    return path_;
+  }
+
+private:
+  std::string path_;
+};
+
+
+// MappedGrid fixture.
+
+TYPED_TEST(MappedGridTest, SizeMismatchThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const mapped_grid_size = util::FilledArray<kDimension>(size_t{9});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  TemporaryFile const file;
+  fmm::MappedGrid<ScalarType, kDimension> arrival_times(
+    file.path(), mapped_grid_size);
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [&]() {
+      fmm::GeodesicArrivalTime(
+        grid_size,
+        boundary_indices,
+        boundary_times,
+        EikonalSolverType(grid_spacing, uniform_speed),
+        &arrival_times);
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  auto ss = stringstream();
+  ss << "grid size " << util::ToString(grid_size)
+     << " does not match cell buffer size "
+     << util::LinearSize(mapped_grid_size);
+  ASSERT_EQ(ss.str(), ft.second);
+}
+
+TYPED_TEST(MappedGridTest, SignedArrivalTimeMatchesInMemory)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType(1) / 16);
+  auto const uniform_speed = ScalarType{1};
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+  auto boundary_indices = vector<array<int32_t, kDimension>>();
+  auto boundary_times = vector<ScalarType>();
+  util::HyperSphereBoundaryCells(
+    util::FilledArray<kDimension>(ScalarType(0.5)), // Center.
+    ScalarType(0.25), // Radius.
+    grid_size,
+    grid_spacing,
+    [](ScalarType const d) { return d; },
+    0, // Dilation pass count.
+    &boundary_indices,
+    &boundary_times);
+  TemporaryFile const file;
+  fmm::MappedGrid<ScalarType, kDimension> mapped_times(
+    file.path(), grid_size);
+
+  // Act.
+  auto const expected_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+  fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    &mapped_times);
+  mapped_times.Flush();
+
+  // Assert.
+  // The mapped times are the same, also after re-opening the file.
+  ASSERT_TRUE(equal(
+    begin(expected_times),
+    end(expected_times),
+    mapped_times.data()));
+  fmm::MappedGrid<ScalarType, kDimension> const reopened_times(
+    file.path(), grid_size);
+  ASSERT_TRUE(equal(
+    begin(expected_times),
+    end(expected_times),
+    reopened_times.data()));
+}
+
+TYPED_TEST(MappedGridTest, GeodesicArrivalTimeMappedSpeed)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::VaryingSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{12});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto speed_buffer = vector<ScalarType>(util::LinearSize(grid_size));
+  auto gen = mt19937();
+  auto dist = uniform_real_distribution<double>(0.5, 2.0);
+  for (auto& speed : speed_buffer) {
+    speed = static_cast<ScalarType>(dist(gen));
+  }
+  TemporaryFile const speed_file;
+  fmm::MappedGrid<ScalarType, kDimension> mapped_speeds(
+    speed_file.path(), grid_size);
+  copy(begin(speed_buffer), end(speed_buffer), mapped_speeds.data());
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{3}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  TemporaryFile const time_file;
+  fmm::MappedGrid<ScalarType, kDimension> mapped_times(
+    time_file.path(), grid_size);
+
+  // Act.
+  auto const expected_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, grid_size, speed_buffer));
+  fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, mapped_speeds),
+    &mapped_times);
+
+  // Assert.
+  ASSERT_TRUE(equal(
+    begin(expected_times),
+    end(expected_times),
+    mapped_times.data()));
+}
+
+// GridFile fixture.
+
+TYPED_TEST(GridFileTest, WriterAsFrozenCellVisitor)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{9});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{0.5});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{4}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const tile_cell_count = size_t{7}; // Last tile is partial.
+
+  for (auto const compression : {
+         fmm::GridFileCompression::kNone,
+         fmm::GridFileCompression::kRunLength}) {
+    TemporaryFile const file;
+    fmm::GridFileWriter<ScalarType, kDimension> writer(
+      file.path(), grid_size, grid_spacing, compression, tile_cell_count);
+
+    // Act.
+    auto const expected_times = fmm::GeodesicArrivalTime(
+      grid_size,
+      boundary_indices,
+      boundary_times,
+      EikonalSolverType(grid_spacing, uniform_speed),
+      writer);
+    writer.Close();
+    auto const contents =
+      fmm::ReadGridFile<ScalarType, kDimension>(file.path());
+
+    // Assert.
+    ASSERT_EQ(grid_size, contents.grid_size);
+    ASSERT_EQ(grid_spacing, contents.grid_spacing);
+    ASSERT_EQ(expected_times, contents.cells);
+  }
+}
+
+TYPED_TEST(GridFileTest, MappedSpeedFileMatchesInMemory)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::VaryingSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{0.1});
+  auto speed_buffer = vector<ScalarType>(util::LinearSize(grid_size));
+  auto gen = mt19937();
+  auto dist = uniform_real_distribution<double>(0.5, 2.0);
+  for (auto& speed : speed_buffer) {
+    speed = static_cast<ScalarType>(dist(gen));
+  }
+  TemporaryFile const speed_file;
+  fmm::GridFileWriter<ScalarType, kDimension> writer(
+    speed_file.path(), grid_size, grid_spacing);
+  writer.Write(speed_buffer.data(), speed_buffer.size());
+  writer.Close();
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{3}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+
+  // Act.
+  fmm::GridFileView<ScalarType, kDimension> const speed_view(
+    speed_file.path());
+  auto const expected_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, grid_size, speed_buffer));
+  auto const times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(speed_view));
+
+  // Assert.
+  ASSERT_EQ(grid_size, speed_view.size());
+  ASSERT_EQ(grid_spacing, speed_view.grid_spacing());
+  ASSERT_TRUE(equal(
+    begin(speed_buffer),
+    end(speed_buffer),
+    speed_view.data()));
+  ASSERT_EQ(expected_times, times);
+}
+
+TYPED_TEST(GridFileTest, RunLengthCompression)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{32});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto speed_buffer =
+    vector<ScalarType>(util::LinearSize(grid_size), ScalarType{1});
+  fill(begin(speed_buffer), begin(speed_buffer) + 100, ScalarType{2});
+  TemporaryFile const file;
+
+  // Act.
+  fmm::GridFileWriter<ScalarType, kDimension> writer(
+    file.path(),
+    grid_size,
+    grid_spacing,
+    fmm::GridFileCompression::kRunLength);
+  writer.Write(speed_buffer.data(), speed_buffer.size());
+  writer.Close();
+  auto const contents =
+    fmm::ReadGridFile<ScalarType, kDimension>(file.path());
+  auto const ft = util::FunctionThrows<runtime_error>(
+    [&]() {
+      fmm::GridFileView<ScalarType, kDimension> const view(file.path());
+    });
+
+  // Assert.
+  ASSERT_EQ(speed_buffer, contents.cells);
+  auto file_stream = ifstream(file.path(), ios::binary | ios::ate);
+  ASSERT_LT(
+    static_cast<size_t>(file_stream.tellg()),
+    speed_buffer.size() * sizeof(ScalarType) / 10);
+
+  // Compressed files cannot be mapped.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ(
+    "invalid grid file '" + file.path() +
+      "': compressed files cannot be mapped",
+    ft.second);
+}
+
+TYPED_TEST(GridFileTest, InvalidFileThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef typename conditional<
+    is_same<ScalarType, float>::value, double, float>::type OtherScalarType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{4});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const cells =
+    vector<ScalarType>(util::LinearSize(grid_size), ScalarType{1});
+  TemporaryFile const complete_file;
+  TemporaryFile const incomplete_file;
+  {
+    fmm::GridFileWriter<ScalarType, kDimension> writer(
+      complete_file.path(), grid_size, grid_spacing);
+    writer.Write(cells.data(), cells.size());
+    writer.Close();
+  }
+
+  // Act.
+  auto const close_ft = util::FunctionThrows<runtime_error>(
+    [&]() {
+      fmm::GridFileWriter<ScalarType, kDimension> writer(
+        incomplete_file.path(), grid_size, grid_spacing);
+      writer.Write(cells.data(), cells.size() - 1);
+      writer.Close();
+    });
+  auto const incomplete_ft = util::FunctionThrows<runtime_error>(
+    [&]() {
+      fmm::ReadGridFile<ScalarType, kDimension>(incomplete_file.path());
+    });
+  auto const type_ft = util::FunctionThrows<runtime_error>(
+    [&]() {
+      fmm::ReadGridFile<OtherScalarType, kDimension>(complete_file.path());
+    });
+
+  // Assert.
+  ASSERT_TRUE(close_ft.first);
+  auto ss = stringstream();
+  ss << "incomplete grid file '" << incomplete_file.path() << "': "
+     << cells.size() - 1 << " of " << cells.size() << " cells set";
+  ASSERT_EQ(ss.str(), close_ft.second);
+  ASSERT_TRUE(incomplete_ft.first);
+  ASSERT_EQ(
+    "invalid grid file '" + incomplete_file.path() + "': incomplete",
+    incomplete_ft.second);
+  ASSERT_TRUE(type_ft.first);
+  ASSERT_EQ(
+    "invalid grid file '" + complete_file.path() + "': scalar type mismatch",
+    type_ft.second);
+}
+
+
+#if defined(__linux__)
+
+//! Returns the current size of the data segment of this process in bytes,
+//! which is what RLIMIT_DATA limits. Returns zero if unknown.
+std::size_t DataSegmentSize()
+{
+  using namespace std;
+
+  auto status = ifstream("/proc/self/status");
+  auto line = string();
+  while (getline(status, line)) {
+    if (line.compare(0, 7, "VmData:") == 0) {
+      return size_t{1024} * stoul(line.substr(7)); // Given in kB.
+    }
+  }
+  return 0;
+}
+
+
+//! Marches a grid of size @a grid_size with the speeds in the file at
+//! @a speed_path and stores the arrival times in the file at @a time_path,
+//! after limiting the memory this process may allocate to @a memory_limit
+//! bytes more than is currently used. Returns zero on success.
+int MarchWithLimitedMemory(
+  std::array<std::size_t, 3> const& grid_size,
+  std::string const& speed_path,
+  std::string const& time_path,
+  std::size_t const memory_limit)
+{
+  using namespace std;
+
+  typedef double ScalarType;
+  static constexpr auto kDimension = size_t{3};
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::VaryingSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  auto const limit = rlimit{DataSegmentSize() + memory_limit, RLIM_INFINITY};
+  if (setrlimit(RLIMIT_DATA, &limit) != 0) {
+    return 1;
+  }
+
+  // The time grid does not fit in memory. Probe by mapping memory directly,
+  // since malloc may hand out heap space freed by earlier tests in this
+  // process, which already counts towards the data segment size.
+  auto const time_byte_count =
+    util::LinearSize(grid_size) * sizeof(ScalarType);
+  auto const probe = mmap(
+    nullptr,
+    time_byte_count,
+    PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS,
+    -1,
+    0);
+  if (probe != MAP_FAILED) {
+    munmap(probe, time_byte_count);
+    return 2;
+  }
+
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{0}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  fmm::MappedGrid<ScalarType, kDimension> const mapped_speeds(
+    speed_path, grid_size);
+  fmm::MappedGrid<ScalarType, kDimension> mapped_times(time_path, grid_size);
+  fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, mapped_speeds),
+    &mapped_times);
+
+  // Along the grid axes first order times are exact.
+  auto far_index = util::FilledArray<kDimension>(int32_t{0});
+  far_index[0] = static_cast<int32_t>(grid_size[0] - 1);
+  auto const strides = fmm::detail::GridStrides(grid_size);
+  auto const far_time =
+    mapped_times.data()[fmm::detail::GridLinearIndex(far_index, strides)];
+  return far_time == static_cast<ScalarType>(grid_size[0] - 1) ? 0 : 3;
+}
+
+
+// Memory limit.
+
+TEST(MappedGridMemoryLimitTest, MarchLargerThanMemoryLimit)
+{
+  using namespace std;
+
+  typedef double ScalarType;
+  static constexpr auto kDimension = size_t{3};
+  namespace fmm = thinks::fast_marching_method;
+
+  // Arrange.
+  // The time grid and the speed grid are 16 MB each, while the process is
+  // only allowed to allocate an additional 8 MB.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{128});
+  auto const memory_limit = size_t{8} * 1024 * 1024;
+  TemporaryFile const speed_file;
+  TemporaryFile const time_file;
+  {
+    fmm::MappedGrid<ScalarType, kDimension> mapped_speeds(
+      speed_file.path(), grid_size);
+    fill(
+      mapped_speeds.data(),
+      mapped_speeds.data() + mapped_speeds.cell_count(),
+      ScalarType{1});
+  }
+
+  // Act and assert in a child process with limited memory.
+  ASSERT_EXIT(
+    exit(MarchWithLimitedMemory(
+      grid_size,
+      speed_file.path(),
+      time_file.path(),
+      memory_limit)),
+    ::testing::ExitedWithCode(0),
+    "");
+}
+
+#endif // defined(__linux__)
+
+} // namespace
+
+#endif // defined(__unix__) || defined(__APPLE__)
@@ -33,6 +33,18 @@ protected:
   virtual ~SignedArrivalTimeTest() {}
 };
 
+template<typename T>
+class ReinitializedSignedArrivalTimeTest : public ::testing::Test {
+protected:
+  virtual ~ReinitializedSignedArrivalTimeTest() {}
+};
+
+template<typename T>
+class BatchSignedArrivalTimeTest : public ::testing::Test {
+protected:
+  virtual ~BatchSignedArrivalTimeTest() {}
+};
+
 template<typename T>
 class SignedArrivalTimeAccuracyTest : public ::testing::Test {
 protected:
@@ -57,6 +69,8 @@ typedef ::testing::Types<
   util::ScalarDimensionPair<double, 3>> AccuracyTypes;
 
 TYPED_TEST_CASE(SignedArrivalTimeTest, SignedArrivalTimeTypes);
+TYPED_TEST_CASE(ReinitializedSignedArrivalTimeTest, SignedArrivalTimeTypes);
+TYPED_TEST_CASE(BatchSignedArrivalTimeTest, SignedArrivalTimeTypes);
 TYPED_TEST_CASE(SignedArrivalTimeAccuracyTest, AccuracyTypes);
 
 
@@ -102,6 +116,47 @@ TYPED_TEST(SignedArrivalTimeTest, ZeroElementInGridSizeThrows)
   }
 }
 
+TYPED_TEST(SignedArrivalTimeTest, TooLargeElementInGridSizeThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr size_t kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  for (auto i = size_t{0}; i < kDimension; ++i) {
+    auto grid_size = util::FilledArray<kDimension>(size_t{10});
+    // Too large element in i'th position.
+    grid_size[i] = fmm::detail::MaxSizeElement() + 1;
+    auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+    auto const speed = ScalarType{1};
+
+    auto boundary_indices = vector<array<int32_t, kDimension>>();
+    boundary_indices.push_back(util::FilledArray<kDimension>(int32_t{0}));
+    auto const boundary_distances = vector<ScalarType>(1, ScalarType{1});
+
+    auto expected_reason = stringstream();
+    expected_reason << "invalid size: " << util::ToString(grid_size);
+
+    // Act.
+    auto const ft = util::FunctionThrows<invalid_argument>(
+      [=]() {
+        auto const signed_times = fmm::SignedArrivalTime(
+          grid_size,
+          boundary_indices,
+          boundary_distances,
+          EikonalSolverType(grid_spacing, speed));
+      });
+
+    // Assert.
+    ASSERT_TRUE(ft.first);
+    ASSERT_EQ(expected_reason.str(), ft.second);
+  }
+}
+
 TYPED_TEST(SignedArrivalTimeTest, EmptyBoundaryThrows)
 {
   using namespace std;
@@ -814,6 +869,979 @@ TYPED_TEST(SignedArrivalTimeTest, OverlappingBoxes)
   ASSERT_LT(time14, ScalarType{0});
 }
 
+TYPED_TEST(SignedArrivalTimeTest, MixedPrecision)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::HighAccuracyUniformSpeedEikonalSolver<
+    ScalarType, kDimension, double> MixedEikonalSolverType;
+  typedef fmm::HighAccuracyUniformSpeedEikonalSolver<double, kDimension>
+    DoubleEikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const double_grid_spacing = util::FilledArray<kDimension>(double{1});
+
+  auto boundary_indices = vector<array<int32_t, kDimension>>();
+  boundary_indices.push_back(util::FilledArray<kDimension>(int32_t{8}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const double_boundary_times = vector<double>(1, double{0});
+
+  // Act.
+  auto const mixed_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    MixedEikonalSolverType(grid_spacing));
+  auto const double_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    double_boundary_times,
+    DoubleEikonalSolverType(double_grid_spacing));
+
+  // Assert.
+  // Storage is in the scalar type, but solving in double should give the
+  // double precision result up to the precision of the scalar type.
+  ASSERT_EQ(double_times.size(), mixed_times.size());
+  for (auto i = size_t{0}; i < mixed_times.size(); ++i) {
+    auto const tolerance =
+      double{16} * numeric_limits<ScalarType>::epsilon() *
+      max(double{1}, abs(double_times[i]));
+    ASSERT_NEAR(double_times[i], double{mixed_times[i]}, tolerance);
+  }
+}
+
+TYPED_TEST(SignedArrivalTimeTest, HalfPrecisionEncoding)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+  typedef fmm::HalfPrecisionEncoder<ScalarType> EncoderType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+
+  auto boundary_indices = vector<array<int32_t, kDimension>>();
+  auto boundary_times = vector<ScalarType>();
+  util::BoxBoundaryCells(
+    util::FilledArray<kDimension>(int32_t{4}),
+    util::FilledArray<kDimension>(size_t{6}),
+    grid_size,
+    &boundary_indices,
+    &boundary_times);
+
+  auto const encoder = EncoderType();
+
+  // Act.
+  auto const signed_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed));
+  auto const encoded_times = fmm::EncodedSignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    encoder);
+
+  // Assert.
+  // Half precision has a relative precision of 2^-11.
+  ASSERT_EQ(signed_times.size(), encoded_times.size());
+  for (auto i = size_t{0}; i < signed_times.size(); ++i) {
+    auto const time = signed_times[i];
+    auto const decoded_time = encoder.Decode(encoded_times[i]);
+    ASSERT_LE(abs(time - decoded_time), abs(time) * ScalarType(1. / 2048));
+  }
+}
+
+TYPED_TEST(SignedArrivalTimeTest, FixedPointEncoding)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+  typedef fmm::FixedPointEncoder<ScalarType> EncoderType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+
+  auto boundary_indices = vector<array<int32_t, kDimension>>();
+  auto boundary_times = vector<ScalarType>();
+  util::BoxBoundaryCells(
+    util::FilledArray<kDimension>(int32_t{4}),
+    util::FilledArray<kDimension>(size_t{6}),
+    grid_size,
+    &boundary_indices,
+    &boundary_times);
+
+  auto const scale = ScalarType(1e-3);
+  auto const clamp_time = ScalarType{3};
+  auto const encoder = EncoderType(scale, clamp_time);
+
+  // Act.
+  auto const signed_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed));
+  auto const encoded_times = fmm::EncodedSignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    encoder);
+
+  // Assert.
+  // Times outside the clamp band saturate, other times are within half
+  // a unit of the scale.
+  ASSERT_EQ(signed_times.size(), encoded_times.size());
+  for (auto i = size_t{0}; i < signed_times.size(); ++i) {
+    auto const clamped_time =
+      max(-clamp_time, min(clamp_time, signed_times[i]));
+    auto const decoded_time = encoder.Decode(encoded_times[i]);
+    ASSERT_LE(abs(clamped_time - decoded_time), ScalarType(0.5001) * scale);
+  }
+}
+
+TYPED_TEST(SignedArrivalTimeTest, InvalidFixedPointEncoderThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::FixedPointEncoder<ScalarType> EncoderType;
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      // 1000 / 0.001 does not fit in 16 bits.
+      EncoderType(ScalarType(1e-3), ScalarType{1000});
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ("invalid fixed point clamp time: 1000", ft.second);
+}
+
+TYPED_TEST(SignedArrivalTimeTest, MaxTime)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+
+  auto boundary_indices = vector<array<int32_t, kDimension>>();
+  auto boundary_times = vector<ScalarType>();
+  util::BoxBoundaryCells(
+    util::FilledArray<kDimension>(int32_t{4}),
+    util::FilledArray<kDimension>(size_t{6}),
+    grid_size,
+    &boundary_indices,
+    &boundary_times);
+
+  // Inside cells are at most 2.5 cells from the boundary, so some cells
+  // on both sides are not reached.
+  auto const max_time = ScalarType(1.5);
+  auto const far_time = ScalarType{100};
+
+  // Act.
+  auto const signed_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed));
+  auto const band_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    max_time,
+    far_time);
+
+  // Assert.
+  // Cells within the band are identical to the full solution, other cells
+  // are far with the sign of the full solution.
+  ASSERT_EQ(signed_times.size(), band_times.size());
+  auto inside_far_count = size_t{0};
+  auto outside_far_count = size_t{0};
+  for (auto i = size_t{0}; i < signed_times.size(); ++i) {
+    if (abs(signed_times[i]) <= max_time) {
+      ASSERT_EQ(signed_times[i], band_times[i]);
+    }
+    else if (signed_times[i] < ScalarType{0}) {
+      ASSERT_EQ(-far_time, band_times[i]);
+      ++inside_far_count;
+    }
+    else {
+      ASSERT_EQ(far_time, band_times[i]);
+      ++outside_far_count;
+    }
+  }
+  ASSERT_GT(inside_far_count, size_t{0});
+  ASSERT_GT(outside_far_count, size_t{0});
+}
+
+TYPED_TEST(SignedArrivalTimeTest, FrozenCellVisitor)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+
+  auto boundary_indices = vector<array<int32_t, kDimension>>();
+  auto boundary_times = vector<ScalarType>();
+  util::BoxBoundaryCells(
+    util::FilledArray<kDimension>(int32_t{4}),
+    util::FilledArray<kDimension>(size_t{6}),
+    grid_size,
+    &boundary_indices,
+    &boundary_times);
+
+  auto const max_time = ScalarType(1.5);
+  auto const far_time = ScalarType{100};
+
+  auto visited_times = vector<ScalarType>(
+    util::LinearSize(grid_size), numeric_limits<ScalarType>::quiet_NaN());
+  auto visited_grid = util::Grid<ScalarType, kDimension>(
+    grid_size, visited_times.front());
+  auto visit_count = size_t{0};
+  auto band_visited_times = visited_times;
+  auto band_visited_grid = util::Grid<ScalarType, kDimension>(
+    grid_size, band_visited_times.front());
+  auto band_visit_count = size_t{0};
+
+  // Act.
+  auto const signed_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    [&](array<int32_t, kDimension> const& index, ScalarType const time) {
+      visited_grid.Cell(index) = time;
+      ++visit_count;
+    });
+  auto const band_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    max_time,
+    far_time,
+    [&](array<int32_t, kDimension> const& index, ScalarType const time) {
+      band_visited_grid.Cell(index) = time;
+      ++band_visit_count;
+    });
+
+  // Assert.
+  // Every cell is visited once with its final time.
+  ASSERT_EQ(signed_times.size(), visit_count);
+  ASSERT_EQ(signed_times, visited_times);
+  ASSERT_EQ(band_times.size(), band_visit_count);
+  ASSERT_EQ(band_times, band_visited_times);
+}
+
+TYPED_TEST(SignedArrivalTimeTest, ExtensionValuesSizeMismatchThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const boundary_values = vector<ScalarType>();
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const result = fmm::ExtendedSignedArrivalTime(
+        grid_size,
+        boundary_indices,
+        boundary_times,
+        boundary_values,
+        EikonalSolverType(grid_spacing, uniform_speed));
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ("boundary indices[1] / boundary values[0] size mismatch",
+            ft.second);
+}
+
+TYPED_TEST(SignedArrivalTimeTest, ExtensionValues)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::HighAccuracyUniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const center = util::FilledArray<kDimension>(ScalarType{8});
+  auto const radius = ScalarType{4.3};
+
+  auto boundary_indices = vector<array<int32_t, kDimension>>();
+  auto boundary_times = vector<ScalarType>();
+  util::HyperSphereBoundaryCells(
+    center,
+    radius,
+    grid_size,
+    grid_spacing,
+    [](ScalarType const d) { return d; },
+    0, // dilation_pass_count
+    &boundary_indices,
+    &boundary_times);
+
+  // Boundary values only depend on direction from the center, so the
+  // values extended along the normals of the sphere are also known.
+  auto const direction_value =
+    [=](array<int32_t, kDimension> const& index) {
+      auto const position = util::CellCenter(index, grid_spacing);
+      return (position[0] - center[0]) / util::Distance(center, position);
+    };
+  auto boundary_values = vector<ScalarType>();
+  for (auto const& boundary_index : boundary_indices) {
+    boundary_values.push_back(direction_value(boundary_index));
+  }
+  auto const constant_values =
+    vector<ScalarType>(boundary_indices.size(), ScalarType{3});
+
+  // Act.
+  auto const result = fmm::ExtendedSignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    boundary_values,
+    EikonalSolverType(grid_spacing, uniform_speed));
+  auto const constant_result = fmm::ExtendedSignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    constant_values,
+    EikonalSolverType(grid_spacing, uniform_speed));
+
+  // Assert.
+  // Times are the same as without extension values. Constant values are
+  // extended exactly, other values approximately, except close to the
+  // center of the sphere where the normals converge.
+  auto const signed_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed));
+  ASSERT_EQ(signed_times, result.first);
+  ASSERT_EQ(signed_times, constant_result.first);
+  for (auto const value : constant_result.second) {
+    ASSERT_NEAR(ScalarType{3}, value, ScalarType(1e-5));
+  }
+  auto extended_values = result.second;
+  auto const value_grid =
+    util::Grid<ScalarType, kDimension>(grid_size, extended_values.front());
+  auto index_iter = util::IndexIterator<kDimension>(grid_size);
+  while (index_iter.has_next()) {
+    auto const index = index_iter.index();
+    auto const position = util::CellCenter(index, grid_spacing);
+    if (util::Distance(center, position) > ScalarType{2}) {
+      ASSERT_NEAR(direction_value(index), value_grid.Cell(index),
+                  ScalarType{0.2});
+    }
+    index_iter.Next();
+  }
+}
+
+TYPED_TEST(SignedArrivalTimeTest, InvalidMaxTimeThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+
+  // Act.
+  auto const ft_max = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const signed_times = fmm::SignedArrivalTime(
+        grid_size,
+        boundary_indices,
+        boundary_times,
+        EikonalSolverType(grid_spacing, uniform_speed),
+        ScalarType{-1}, // max_time
+        ScalarType{10}); // far_time
+    });
+  auto const ft_far = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const signed_times = fmm::SignedArrivalTime(
+        grid_size,
+        boundary_indices,
+        boundary_times,
+        EikonalSolverType(grid_spacing, uniform_speed),
+        ScalarType{5}, // max_time
+        ScalarType{4}); // far_time
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft_max.first);
+  ASSERT_EQ("invalid max time: -1", ft_max.second);
+  ASSERT_TRUE(ft_far.first);
+  ASSERT_EQ("invalid far time: 4", ft_far.second);
+}
+
+TYPED_TEST(SignedArrivalTimeTest, PhaseTimes)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+
+  auto boundary_indices = vector<array<int32_t, kDimension>>();
+  auto boundary_times = vector<ScalarType>();
+  util::BoxBoundaryCells(
+    util::FilledArray<kDimension>(int32_t{4}),
+    util::FilledArray<kDimension>(size_t{6}),
+    grid_size,
+    &boundary_indices,
+    &boundary_times);
+
+  auto stats = fmm::ArrivalTimeStats();
+
+  // Act.
+  auto const expected_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver);
+  auto const signed_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    &stats);
+
+  // Assert.
+  // Same times, and time has been spent in every phase.
+  ASSERT_EQ(expected_times, signed_times);
+  ASSERT_LT(0, stats.validation.count());
+  ASSERT_LT(0, stats.topology.count());
+  ASSERT_LT(0, stats.inside_march.count());
+  ASSERT_LT(0, stats.outside_march.count());
+}
+
+TYPED_TEST(SignedArrivalTimeTest, MarchCounts)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const eikonal_solver = EikonalSolverType(grid_spacing, uniform_speed);
+
+  auto boundary_indices = vector<array<int32_t, kDimension>>();
+  auto boundary_times = vector<ScalarType>();
+  util::BoxBoundaryCells(
+    util::FilledArray<kDimension>(int32_t{4}),
+    util::FilledArray<kDimension>(size_t{6}),
+    grid_size,
+    &boundary_indices,
+    &boundary_times);
+
+  auto stats = fmm::ArrivalTimeStats();
+
+  // Act.
+  auto const signed_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    eikonal_solver,
+    &stats);
+
+  // Assert.
+  // The box is one connected component with an outer and an inner
+  // dilation band. Every pushed value is eventually popped, either
+  // freezing a non-boundary cell or as a stale pop.
+  auto const frozen_count =
+    util::LinearSize(grid_size) - boundary_indices.size();
+  ASSERT_EQ(size_t{1}, stats.connected_component_count);
+  ASSERT_EQ(size_t{2}, stats.dilation_band_count);
+  ASSERT_EQ(stats.push_count, stats.solve_count);
+  ASSERT_EQ(frozen_count + stats.stale_pop_count, stats.push_count);
+  ASSERT_LT(size_t{0}, stats.stale_pop_count);
+  ASSERT_LT(size_t{0}, stats.peak_narrow_band_size);
+  ASSERT_LE(stats.peak_narrow_band_size, stats.push_count);
+}
+
+// ReinitializedSignedArrivalTime fixture.
+
+TYPED_TEST(ReinitializedSignedArrivalTimeTest, NoZeroCrossingThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const phi =
+    vector<ScalarType>(util::LinearSize(grid_size), ScalarType{1});
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const signed_times = fmm::ReinitializedSignedArrivalTime(
+        grid_size,
+        grid_spacing,
+        phi,
+        EikonalSolverType(grid_spacing, uniform_speed));
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ("empty boundary condition", ft.second);
+}
+
+TYPED_TEST(ReinitializedSignedArrivalTimeTest, NanPhiThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto phi = vector<ScalarType>(util::LinearSize(grid_size), ScalarType{1});
+  phi[0] = ScalarType{-1};
+  phi[1] = numeric_limits<ScalarType>::quiet_NaN();
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const signed_times = fmm::ReinitializedSignedArrivalTime(
+        grid_size,
+        grid_spacing,
+        phi,
+        EikonalSolverType(grid_spacing, uniform_speed));
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ("invalid phi: nan", ft.second);
+}
+
+TYPED_TEST(ReinitializedSignedArrivalTimeTest, Sphere)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const center = util::FilledArray<kDimension>(ScalarType{8});
+  auto const radius = ScalarType{4.3};
+
+  // A level set that is not a distance, the zero level set is a sphere.
+  auto phi = vector<ScalarType>(util::LinearSize(grid_size));
+  auto expected_times = vector<ScalarType>(phi.size());
+  auto phi_grid = util::Grid<ScalarType, kDimension>(grid_size, phi.front());
+  auto expected_grid =
+    util::Grid<ScalarType, kDimension>(grid_size, expected_times.front());
+  auto index_iter = util::IndexIterator<kDimension>(grid_size);
+  while (index_iter.has_next()) {
+    auto const index = index_iter.index();
+    auto const position = util::CellCenter(index, grid_spacing);
+    auto const distance = util::Distance(center, position) - radius;
+    phi_grid.Cell(index) = ScalarType{3} * distance;
+    expected_grid.Cell(index) = distance;
+    index_iter.Next();
+  }
+
+  // Act.
+  auto const signed_times = fmm::ReinitializedSignedArrivalTime(
+    grid_size,
+    grid_spacing,
+    phi,
+    EikonalSolverType(grid_spacing, uniform_speed));
+
+  // Assert.
+  // Times are accurate close to the zero level set, where they are given
+  // by interpolating phi. Further away the usual marching errors apply.
+  ASSERT_EQ(phi.size(), signed_times.size());
+  for (auto i = size_t{0}; i < phi.size(); ++i) {
+    ASSERT_EQ(phi[i] < ScalarType{0}, signed_times[i] < ScalarType{0});
+    auto const tolerance = abs(expected_times[i]) < ScalarType{1} ?
+      ScalarType{0.3} : ScalarType{1};
+    ASSERT_NEAR(expected_times[i], signed_times[i], tolerance);
+  }
+}
+
+TYPED_TEST(ReinitializedSignedArrivalTimeTest, MaxTime)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const center = util::FilledArray<kDimension>(ScalarType{8});
+  auto const radius = ScalarType{4.3};
+  auto const max_time = ScalarType{2};
+  auto const far_time = ScalarType{100};
+
+  auto phi = vector<ScalarType>(util::LinearSize(grid_size));
+  auto phi_grid = util::Grid<ScalarType, kDimension>(grid_size, phi.front());
+  auto index_iter = util::IndexIterator<kDimension>(grid_size);
+  while (index_iter.has_next()) {
+    auto const index = index_iter.index();
+    auto const position = util::CellCenter(index, grid_spacing);
+    phi_grid.Cell(index) = util::Distance(center, position) - radius;
+    index_iter.Next();
+  }
+
+  // Act.
+  auto const signed_times = fmm::ReinitializedSignedArrivalTime(
+    grid_size,
+    grid_spacing,
+    phi,
+    EikonalSolverType(grid_spacing, uniform_speed));
+  auto const band_times = fmm::ReinitializedSignedArrivalTime(
+    grid_size,
+    grid_spacing,
+    phi,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    max_time,
+    far_time);
+
+  // Assert.
+  // Cells within the band are identical to the full solution, other cells
+  // are far with the sign of phi.
+  ASSERT_EQ(signed_times.size(), band_times.size());
+  auto inside_far_count = size_t{0};
+  auto outside_far_count = size_t{0};
+  for (auto i = size_t{0}; i < signed_times.size(); ++i) {
+    if (abs(signed_times[i]) <= max_time) {
+      ASSERT_EQ(signed_times[i], band_times[i]);
+    }
+    else if (phi[i] < ScalarType{0}) {
+      ASSERT_EQ(-far_time, band_times[i]);
+      ++inside_far_count;
+    }
+    else {
+      ASSERT_EQ(far_time, band_times[i]);
+      ++outside_far_count;
+    }
+  }
+  ASSERT_GT(inside_far_count, size_t{0});
+  ASSERT_GT(outside_far_count, size_t{0});
+}
+
+
+// BatchSignedArrivalTime fixture.
+
+TYPED_TEST(BatchSignedArrivalTimeTest, ZeroThreadCountThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+  typedef fmm::ArrivalTimeProblem<ScalarType, kDimension, EikonalSolverType>
+    ProblemType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const problems = vector<ProblemType>(1, ProblemType{
+    grid_size,
+    vector<array<int32_t, kDimension>>(
+      1, util::FilledArray<kDimension>(int32_t{5})),
+    vector<ScalarType>(1, ScalarType{0}),
+    EikonalSolverType(grid_spacing, uniform_speed)});
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const batch_times = fmm::BatchSignedArrivalTime(
+        problems,
+        size_t{0});
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ("invalid thread count: 0", ft.second);
+}
+
+TYPED_TEST(BatchSignedArrivalTimeTest, InvalidProblemThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+  typedef fmm::ArrivalTimeProblem<ScalarType, kDimension, EikonalSolverType>
+    ProblemType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto problems = vector<ProblemType>(8, ProblemType{
+    grid_size,
+    boundary_indices,
+    vector<ScalarType>(1, ScalarType{0}),
+    EikonalSolverType(grid_spacing, uniform_speed)});
+  problems[5].boundary_times[0] = numeric_limits<ScalarType>::quiet_NaN();
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const batch_times = fmm::BatchSignedArrivalTime(
+        problems,
+        size_t{3});
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ("invalid boundary time: nan", ft.second);
+}
+
+TYPED_TEST(BatchSignedArrivalTimeTest, MatchesSignedArrivalTime)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+  typedef fmm::ArrivalTimeProblem<ScalarType, kDimension, EikonalSolverType>
+    ProblemType;
+
+  // Arrange.
+  // Problems of different sizes, with spheres of different radii.
+  auto problems = vector<ProblemType>();
+  for (auto i = size_t{0}; i < 12; ++i) {
+    auto const grid_size = util::FilledArray<kDimension>(size_t{8 + i % 4});
+    auto const grid_spacing =
+      util::FilledArray<kDimension>(ScalarType(1) / grid_size[0]);
+    auto const speed = ScalarType(1 + i % 3);
+    auto const radius = ScalarType(0.2) + ScalarType(0.02) * (i % 5);
+
+    auto problem = ProblemType{
+      grid_size,
+      vector<array<int32_t, kDimension>>(),
+      vector<ScalarType>(),
+      EikonalSolverType(grid_spacing, speed)};
+    util::HyperSphereBoundaryCells(
+      util::FilledArray<kDimension>(ScalarType(0.5)), // Center.
+      radius,
+      grid_size,
+      grid_spacing,
+      [=](ScalarType const d) { return d / speed; },
+      0, // Dilation pass count.
+      &problem.boundary_indices,
+      &problem.boundary_times);
+    problems.push_back(problem);
+  }
+
+  // Act.
+  auto const batch_times = fmm::BatchSignedArrivalTime(problems, size_t{4});
+
+  // Assert.
+  // Same times as solving the problems one at a time, in the same order.
+  ASSERT_EQ(problems.size(), batch_times.size());
+  for (auto i = size_t{0}; i < problems.size(); ++i) {
+    auto const expected_times = fmm::SignedArrivalTime(
+      problems[i].grid_size,
+      problems[i].boundary_indices,
+      problems[i].boundary_times,
+      problems[i].eikonal_solver);
+    ASSERT_EQ(expected_times, batch_times[i]);
+  }
+}
+
+
+// Large grids.
+
+TEST(LargeGridTest, CellCountOverflowThrows)
+{
+  using namespace std;
+
+  typedef float ScalarType;
+  static constexpr size_t kDimension = 3;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  // Every element is valid, but the number of cells does not fit in
+  // std::size_t.
+  auto const grid_size =
+    util::FilledArray<kDimension>(fmm::detail::MaxSizeElement());
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{0}));
+  auto const boundary_distances = vector<ScalarType>(1, ScalarType{1});
+
+  auto expected_reason = stringstream();
+  expected_reason << "invalid size: " << util::ToString(grid_size);
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const signed_times = fmm::SignedArrivalTime(
+        grid_size,
+        boundary_indices,
+        boundary_distances,
+        EikonalSolverType(grid_spacing, speed));
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ(expected_reason.str(), ft.second);
+}
+
+TEST(LargeGridTest, LinearIndices)
+{
+  using namespace std;
+
+  static constexpr size_t kDimension = 3;
+  namespace fmm = thinks::fast_marching_method;
+
+  // Arrange.
+  // A 2048^3 grid has more than 2^32 cells. Only indices are computed, no
+  // cell memory is allocated.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{2048});
+  auto const strides = fmm::detail::GridStrides(grid_size);
+  auto const last_index = util::FilledArray<kDimension>(int32_t{2047});
+  auto indices = vector<array<int32_t, kDimension>>();
+  indices.push_back(util::FilledArray<kDimension>(int32_t{0}));
+  indices.push_back(last_index);
+  indices.push_back({{2047, 0, 2047}});
+  indices.push_back({{1, 2047, 1024}});
+  auto bbox = array<pair<int32_t, int32_t>, kDimension>();
+  for (auto& b : bbox) {
+    b = {int32_t{0}, int32_t{2047}};
+  }
+
+  // Act.
+  auto const linear_size = fmm::detail::LinearSize(grid_size);
+  auto const hyper_volume = fmm::detail::HyperVolume(bbox);
+
+  // Assert.
+  ASSERT_EQ(size_t{2048} * size_t{2048} * size_t{2048}, linear_size);
+  ASSERT_GT(linear_size, size_t{numeric_limits<uint32_t>::max()});
+  ASSERT_EQ(linear_size, hyper_volume);
+  ASSERT_EQ(linear_size - 1,
+            fmm::detail::GridLinearIndex(last_index, strides));
+  for (auto const& index : indices) {
+    auto const linear_index = fmm::detail::GridLinearIndex(index, strides);
+    ASSERT_LT(linear_index, linear_size);
+    ASSERT_EQ(index, fmm::detail::GridIndex(linear_index, grid_size));
+  }
+}
+
+
+// SignedArrivalTimeAccuracy fixture.
+
 TYPED_TEST(SignedArrivalTimeAccuracyTest, PointSourceAccuracy)
 {
   using namespace std;
@@ -0,0 +1,581 @@
+// Copyright 2017 Tommy Hinks
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include "../include/thinks/fast_marching_method/fast_marching_method.hpp"
+#include "util.hpp"
+
+namespace {
+
+// Fixtures.
+
+template<typename T>
+class TargetArrivalTimeTest : public ::testing::Test {
+protected:
+  virtual ~TargetArrivalTimeTest() {}
+};
+
+template<typename T>
+class BidirectionalArrivalTimeTest : public ::testing::Test {
+protected:
+  virtual ~BidirectionalArrivalTimeTest() {}
+};
+
+template<typename T>
+class HeuristicTargetArrivalTimeTest : public ::testing::Test {
+protected:
+  virtual ~HeuristicTargetArrivalTimeTest() {}
+};
+
+
+// Associate types with fixtures.
+
+typedef ::testing::Types<
+  util::ScalarDimensionPair<float, 2>,
+  util::ScalarDimensionPair<float, 3>,
+  util::ScalarDimensionPair<float, 4>,
+  util::ScalarDimensionPair<double, 2>,
+  util::ScalarDimensionPair<double, 3>,
+  util::ScalarDimensionPair<double, 4>> TargetArrivalTimeTypes;
+
+TYPED_TEST_CASE(TargetArrivalTimeTest, TargetArrivalTimeTypes);
+TYPED_TEST_CASE(BidirectionalArrivalTimeTest, TargetArrivalTimeTypes);
+TYPED_TEST_CASE(HeuristicTargetArrivalTimeTest, TargetArrivalTimeTypes);
+
+
+// TargetArrivalTime fixture.
+
+TYPED_TEST(TargetArrivalTimeTest, TargetIndexOutsideGridThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto const target_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{10}));
+
+  auto expected_reason = stringstream();
+  expected_reason << "target index outside grid - "
+                  << "index: " << util::ToString(target_indices[0]) << ", "
+                  << "grid size: " << util::ToString(grid_size);
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const target_times = fmm::TargetArrivalTime(
+        grid_size,
+        boundary_indices,
+        boundary_times,
+        EikonalSolverType(grid_spacing, uniform_speed),
+        target_indices);
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ(expected_reason.str(), ft.second);
+}
+
+TYPED_TEST(TargetArrivalTimeTest, NegativeBoundaryTimeThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{5}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{-1});
+  auto const target_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{0}));
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      auto const target_times = fmm::TargetArrivalTime(
+        grid_size,
+        boundary_indices,
+        boundary_times,
+        EikonalSolverType(grid_spacing, uniform_speed),
+        target_indices);
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ("invalid boundary time: -1", ft.second);
+}
+
+TYPED_TEST(TargetArrivalTimeTest, MatchesFullGrid)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::HighAccuracyUniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{8}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+
+  auto target_indices = vector<array<int32_t, kDimension>>();
+  target_indices.push_back(util::FilledArray<kDimension>(int32_t{10}));
+  target_indices.push_back(util::FilledArray<kDimension>(int32_t{7}));
+  target_indices.push_back(util::FilledArray<kDimension>(int32_t{8}));
+  target_indices.push_back(util::FilledArray<kDimension>(int32_t{10}));
+
+  // Act.
+  auto signed_times = fmm::SignedArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed));
+  auto const target_times = fmm::TargetArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    target_indices);
+
+  // Assert.
+  // Targets get the same times as when marching the whole grid. Note that
+  // duplicate targets and targets on the boundary are allowed.
+  auto const signed_grid = util::Grid<ScalarType, kDimension>(
+    grid_size, signed_times.front());
+  ASSERT_EQ(target_indices.size(), target_times.size());
+  for (auto i = size_t{0}; i < target_indices.size(); ++i) {
+    auto const expected_time = signed_grid.Cell(target_indices[i]);
+    ASSERT_NEAR(
+      expected_time,
+      target_times[i],
+      ScalarType{16} * numeric_limits<ScalarType>::epsilon() *
+        max(ScalarType{1}, expected_time));
+  }
+  ASSERT_EQ(ScalarType{0}, target_times[2]);
+}
+
+TYPED_TEST(TargetArrivalTimeTest, EarlyTermination)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{8}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+
+  auto target_index = util::FilledArray<kDimension>(int32_t{8});
+  target_index[0] += 2;
+  auto const target_indices =
+    vector<array<int32_t, kDimension>>(1, target_index);
+
+  // Act.
+  auto marched_times = vector<ScalarType>();
+  auto const target_times = fmm::TargetArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    target_indices,
+    &marched_times);
+
+  // Assert.
+  // Only cells with times up to the target time are frozen.
+  ASSERT_EQ(size_t{1}, target_times.size());
+  ASSERT_EQ(ScalarType{2}, target_times[0]);
+  ASSERT_EQ(util::LinearSize(grid_size), marched_times.size());
+  auto frozen_count = size_t{0};
+  for (auto const t : marched_times) {
+    if (t < numeric_limits<ScalarType>::max()) {
+      ASSERT_LE(t, target_times[0]);
+      ++frozen_count;
+    }
+  }
+  ASSERT_LT(frozen_count, marched_times.size() / 8);
+}
+
+
+
+// BidirectionalArrivalTime fixture.
+
+TYPED_TEST(BidirectionalArrivalTimeTest, SourceIndexOutsideGridThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const source_index = util::FilledArray<kDimension>(int32_t{-1});
+  auto const target_index = util::FilledArray<kDimension>(int32_t{5});
+
+  auto expected_reason = stringstream();
+  expected_reason << "boundary index outside grid - "
+                  << "index: " << util::ToString(source_index) << ", "
+                  << "grid size: " << util::ToString(grid_size);
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      fmm::BidirectionalArrivalTime(
+        grid_size,
+        source_index,
+        target_index,
+        EikonalSolverType(grid_spacing, uniform_speed));
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ(expected_reason.str(), ft.second);
+}
+
+TYPED_TEST(BidirectionalArrivalTimeTest, SameSourceAndTarget)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{10});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const index = util::FilledArray<kDimension>(int32_t{5});
+
+  // Act.
+  auto const result = fmm::BidirectionalArrivalTime(
+    grid_size,
+    index,
+    index,
+    EikonalSolverType(grid_spacing, uniform_speed));
+
+  // Assert.
+  ASSERT_EQ(ScalarType{0}, result.first);
+  ASSERT_EQ(index, result.second);
+}
+
+TYPED_TEST(BidirectionalArrivalTimeTest, AxisAligned)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{2};
+  auto source_index = util::FilledArray<kDimension>(int32_t{8});
+  auto target_index = source_index;
+  source_index[0] = 2;
+  target_index[0] = 12;
+
+  // Act.
+  auto const result = fmm::BidirectionalArrivalTime(
+    grid_size,
+    source_index,
+    target_index,
+    EikonalSolverType(grid_spacing, uniform_speed));
+
+  // Assert.
+  // Fronts meet half way along the axis between source and target.
+  ASSERT_NEAR(ScalarType{5}, result.first, ScalarType(1e-4));
+  ASSERT_EQ(source_index[1], result.second[1]);
+  ASSERT_LE(source_index[0], result.second[0]);
+  ASSERT_GE(target_index[0], result.second[0]);
+}
+
+TYPED_TEST(BidirectionalArrivalTimeTest, MatchesTargetArrivalTime)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::HighAccuracyUniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const source_index = util::FilledArray<kDimension>(int32_t{3});
+  auto target_index = util::FilledArray<kDimension>(int32_t{11});
+  target_index[0] = 6;
+
+  // Act.
+  auto const target_times = fmm::TargetArrivalTime(
+    grid_size,
+    vector<array<int32_t, kDimension>>(1, source_index),
+    vector<ScalarType>(1, ScalarType{0}),
+    EikonalSolverType(grid_spacing, uniform_speed),
+    vector<array<int32_t, kDimension>>(1, target_index));
+  auto const result = fmm::BidirectionalArrivalTime(
+    grid_size,
+    source_index,
+    target_index,
+    EikonalSolverType(grid_spacing, uniform_speed));
+
+  // Assert.
+  // Discretization errors near point sources are accumulated at both ends
+  // for bidirectional marching, so the result is somewhat larger.
+  ASSERT_LE(target_times[0], result.first);
+  ASSERT_NEAR(target_times[0], result.first, ScalarType(0.1) * target_times[0]);
+}
+
+
+
+// HeuristicTargetArrivalTime fixture.
+
+TYPED_TEST(HeuristicTargetArrivalTimeTest, InvalidMaxSpeedThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::DistanceHeuristic<ScalarType, kDimension> HeuristicType;
+
+  // Arrange.
+  auto const target_index = util::FilledArray<kDimension>(int32_t{5});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      HeuristicType(target_index, grid_spacing, ScalarType{0});
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ("invalid speed: 0", ft.second);
+}
+
+TYPED_TEST(HeuristicTargetArrivalTimeTest, InvalidWeightThrows)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::DistanceHeuristic<ScalarType, kDimension> HeuristicType;
+
+  // Arrange.
+  auto const target_index = util::FilledArray<kDimension>(int32_t{5});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const max_speed = ScalarType{1};
+
+  // Act.
+  auto const ft = util::FunctionThrows<invalid_argument>(
+    [=]() {
+      HeuristicType(target_index, grid_spacing, max_speed, ScalarType{2});
+    });
+
+  // Assert.
+  ASSERT_TRUE(ft.first);
+  ASSERT_EQ("invalid heuristic weight: 2", ft.second);
+}
+
+TYPED_TEST(HeuristicTargetArrivalTimeTest, ZeroHeuristic)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::UniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{3}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto target_index = util::FilledArray<kDimension>(int32_t{12});
+  target_index[0] = 5;
+  auto const zero_heuristic = [](array<int32_t, kDimension> const&) {
+    return ScalarType{0};
+  };
+
+  // Act.
+  auto const target_times = fmm::TargetArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    vector<array<int32_t, kDimension>>(1, target_index));
+  auto const heuristic_time = fmm::HeuristicTargetArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    target_index,
+    zero_heuristic);
+
+  // Assert.
+  // Without a heuristic cells are frozen in the same order.
+  ASSERT_EQ(target_times[0], heuristic_time);
+}
+
+TYPED_TEST(HeuristicTargetArrivalTimeTest, DefaultWeightMatchesFullGrid)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::HighAccuracyUniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+  typedef fmm::DistanceHeuristic<ScalarType, kDimension> HeuristicType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{3}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto target_index = util::FilledArray<kDimension>(int32_t{12});
+  target_index[0] = 5;
+
+  // Act.
+  auto full_times = fmm::GeodesicArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed));
+  auto const heuristic_time = fmm::HeuristicTargetArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    target_index,
+    HeuristicType(target_index, grid_spacing, uniform_speed));
+
+  // Assert.
+  // The default weight is exact, the target gets the same time as when
+  // marching the whole grid.
+  auto const full_grid = util::Grid<ScalarType, kDimension>(
+    grid_size, full_times.front());
+  ASSERT_EQ(full_grid.Cell(target_index), heuristic_time);
+}
+
+TYPED_TEST(HeuristicTargetArrivalTimeTest, DistanceHeuristic)
+{
+  using namespace std;
+
+  typedef typename TypeParam::ScalarType ScalarType;
+  static constexpr auto kDimension = TypeParam::kDimension;
+  namespace fmm = thinks::fast_marching_method;
+  typedef fmm::HighAccuracyUniformSpeedEikonalSolver<ScalarType, kDimension>
+    EikonalSolverType;
+  typedef fmm::DistanceHeuristic<ScalarType, kDimension> HeuristicType;
+
+  // Arrange.
+  auto const grid_size = util::FilledArray<kDimension>(size_t{16});
+  auto const grid_spacing = util::FilledArray<kDimension>(ScalarType{1});
+  auto const uniform_speed = ScalarType{1};
+  auto const boundary_indices = vector<array<int32_t, kDimension>>(
+    1, util::FilledArray<kDimension>(int32_t{3}));
+  auto const boundary_times = vector<ScalarType>(1, ScalarType{0});
+  auto target_index = util::FilledArray<kDimension>(int32_t{12});
+  target_index[0] = 5;
+  auto const weight = ScalarType(0.5);
+
+  // Act.
+  auto target_marched_times = vector<ScalarType>();
+  auto const target_times = fmm::TargetArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    vector<array<int32_t, kDimension>>(1, target_index),
+    &target_marched_times);
+  auto heuristic_marched_times = vector<ScalarType>();
+  auto const heuristic_time = fmm::HeuristicTargetArrivalTime(
+    grid_size,
+    boundary_indices,
+    boundary_times,
+    EikonalSolverType(grid_spacing, uniform_speed),
+    target_index,
+    HeuristicType(target_index, grid_spacing, uniform_speed, weight),
+    &heuristic_marched_times);
+
+  // Assert.
+  // The heuristic freezes fewer cells with a result close to the one
+  // without heuristic.
+  auto const frozen = [](ScalarType const t) {
+    return t < numeric_limits<ScalarType>::max();
+  };
+  auto const target_frozen_count = count_if(
+    begin(target_marched_times), end(target_marched_times), frozen);
+  auto const heuristic_frozen_count = count_if(
+    begin(heuristic_marched_times), end(heuristic_marched_times), frozen);
+  ASSERT_LT(heuristic_frozen_count, target_frozen_count);
+  ASSERT_NEAR(
+    target_times[0], heuristic_time, ScalarType(0.02) * target_times[0]);
+}
+
+} // namespace
@@ -255,6 +255,10 @@ std::array<std::array<std::int32_t, N>, 2 * N> FaceNeighborOffsets()
 }
 
 
+template<std::size_t N>
+class IndexIterator;
+
+
 //! DOCS
 template<std::size_t N> inline
 std::array<std::array<std::int32_t, N>, static_pow(3, N) - 1>
@@ -574,7 +578,7 @@ void HyperSphereBoundaryCells(
     auto const neighbor_offset_end = end(face_neighbor_offsets);
 
     auto old_foreground_indices = foreground_indices;
-    auto new_foreground_indices = vector<array<int32_t, 2>>{};
+    auto new_foreground_indices = vector<array<int32_t, N>>{};
     for (auto i = size_t{0}; i < dilation_pass_count; ++i) {
       for (auto const foreground_index : old_foreground_indices) {
         for (auto neighbor_offset_iter = neighbor_offset_begin;
@@ -601,7 +605,7 @@ void HyperSphereBoundaryCells(
     }
 
     old_foreground_indices = new_foreground_indices;
-    new_foreground_indices = vector<array<int32_t, 2>>{};
+    new_foreground_indices = vector<array<int32_t, N>>{};
   }
 }
 